@@ -0,0 +1,187 @@
+#include "specific.h"
+
+arena* arena_init(size_t chunk_size){
+
+    short num_of_arenas;
+    arena* a;
+
+    num_of_arenas = 1;
+
+    a = (arena*) calloc(num_of_arenas, sizeof(arena));
+
+    if(a == NULL){
+        fprintf(stderr, "Memory error - cannot calloc space for arena\n");
+        exit(EXIT_FAILURE);
+    }
+
+    a->chunk_size = ARENA_ROUND_UP(chunk_size);
+    a->first = a->current = NULL;
+    a->num_chunk_allocs = 0;
+    return a;
+}
+
+void* arena_alloc(arena* a, size_t num_bytes){
+
+    void* p;
+
+    if(a == NULL){
+        return NULL;
+    }
+
+    // every size is rounded up, so replaying the same allocations after a reset uses exactly as many bytes
+    num_bytes = ARENA_ROUND_UP(num_bytes);
+
+    // move on through the chunks left over from before the last reset, then grow
+    while(a->current == NULL || a->current->size - a->current->used < num_bytes){
+        if(a->current != NULL && a->current->next != NULL){
+            a->current = a->current->next;
+            a->current->used = 0;
+        } else{
+            _arena_new_chunk(a, num_bytes > a->chunk_size ? num_bytes : a->chunk_size);
+        }
+    }
+
+    p = a->current->base + a->current->used;
+    a->current->used += num_bytes;
+    return p;
+}
+
+bool arena_owns(arena* a, void* p){
+
+    char* byte = (char*) p;
+
+    if(a == NULL || p == NULL){
+        return false;
+    }
+
+    for(arena_chunk* chunk = a->first; chunk != NULL; chunk = chunk->next){
+        if(byte >= chunk->base && byte < chunk->base + chunk->size){
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+    If the last round spilled into more than one chunk, they're swapped for a
+    single chunk big enough for all of them, so the next round (making the same
+    allocations) fits without calling malloc().
+*/
+void arena_reset(arena* a){
+
+    size_t total;
+
+    if(a == NULL || a->first == NULL){
+        return;
+    }
+
+    if(a->first->next != NULL){
+        total = 0;
+        for(arena_chunk* chunk = a->first; chunk != NULL; chunk = chunk->next){
+            total += chunk->size;
+        }
+        _arena_free_chunks(a->first);
+        a->first = a->current = NULL;
+        _arena_new_chunk(a, total);
+    }
+
+    a->current = a->first;
+    a->current->used = 0;
+}
+
+void arena_reserve(arena* a, size_t num_bytes){
+
+    if(a == NULL){
+        return;
+    }
+
+    num_bytes = ARENA_ROUND_UP(num_bytes > a->chunk_size ? num_bytes : a->chunk_size);
+    if(a->first != NULL && a->first->next == NULL && a->first->size >= num_bytes){
+        return;
+    }
+    // anything already bumped would go with the chunks
+    for(arena_chunk* chunk = a->first; chunk != NULL; chunk = chunk->next){
+        if(chunk->used > 0){
+            return;
+        }
+    }
+
+    _arena_free_chunks(a->first);
+    a->first = a->current = NULL;
+    _arena_new_chunk(a, num_bytes);
+}
+
+size_t arena_num_chunk_allocs(arena* a){
+    if(a == NULL){
+        return 0;
+    }
+    return a->num_chunk_allocs;
+}
+
+size_t arena_num_bytes(arena* a){
+
+    size_t num_bytes = 0;
+
+    if(a == NULL){
+        return 0;
+    }
+    for(arena_chunk* chunk = a->first; chunk != NULL; chunk = chunk->next){
+        num_bytes += chunk->size;
+    }
+    return num_bytes;
+}
+
+bool arena_free(arena* a){
+    if(a == NULL){
+        return false;
+    }
+
+    _arena_free_chunks(a->first);
+    FREE_AND_NULL(a);
+    return true;
+}
+
+// appends a chunk of at least size bytes after the current (last) one, and makes it current
+arena_chunk* _arena_new_chunk(arena* a, size_t size){
+
+    arena_chunk* chunk;
+    uintptr_t misalignment;
+    char* first_byte;
+
+    size = ARENA_ROUND_UP(size);
+
+    // the chunk header and its bytes are one allocation, over-sized so the bytes can be aligned by hand
+    chunk = (arena_chunk*) malloc(sizeof(arena_chunk) + ARENA_ALIGNMENT + size);
+
+    if(chunk == NULL){
+        fprintf(stderr, "Memory error - cannot malloc space for arena\n");
+        exit(EXIT_FAILURE);
+    }
+
+    first_byte = (char*) chunk + sizeof(arena_chunk);
+    misalignment = (uintptr_t) first_byte % ARENA_ALIGNMENT;
+    chunk->base = first_byte + (misalignment == 0 ? 0 : ARENA_ALIGNMENT - misalignment);
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->next = NULL;
+
+    if(a->current == NULL){
+        a->first = chunk;
+    } else{
+        a->current->next = chunk;
+    }
+    a->current = chunk;
+    a->num_chunk_allocs++;
+    return chunk;
+}
+
+void _arena_free_chunks(arena_chunk* chunk){
+
+    arena_chunk* next;
+
+    while(chunk != NULL){
+        next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../general.h"
+
+/*
+    A bump-pointer allocator. Allocations are never freed one at a time;
+    arena_reset() takes the whole arena back in one go, keeping its memory for
+    the next round, so a workload that repeats (e.g. a LOOP body) stops calling
+    malloc after its first pass.
+*/
+typedef struct arena arena;
+
+arena* arena_init(size_t chunk_size);
+/* aligned to ARENA_ALIGNMENT */
+void* arena_alloc(arena* a, size_t num_bytes);
+bool arena_owns(arena* a, void* p);
+void arena_reset(arena* a);
+/* sizes the arena so a round of up to num_bytes needs one chunk - only while nothing's allocated from it */
+void arena_reserve(arena* a, size_t num_bytes);
+/* how many times the arena has had to call malloc() */
+size_t arena_num_chunk_allocs(arena* a);
+/* usable bytes in the arena's chunks - it keeps them until it's freed */
+size_t arena_num_bytes(arena* a);
+bool arena_free(arena* a);
@@ -0,0 +1,27 @@
+#include "arena.h"
+
+#pragma once
+
+#define ARENA_ALIGNMENT 64
+#define ARENA_ROUND_UP(N) ((((N) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT) * ARENA_ALIGNMENT)
+
+typedef struct arena_chunk arena_chunk;
+
+struct arena_chunk {
+    arena_chunk* next;
+    // start of the usable (aligned) bytes, and how many there are
+    char* base;
+    size_t size;
+    size_t used;
+};
+
+struct arena {
+    // chunks are filled in order; current is the one being bumped
+    arena_chunk* first;
+    arena_chunk* current;
+    size_t chunk_size;
+    size_t num_chunk_allocs;
+};
+
+arena_chunk* _arena_new_chunk(arena* a, size_t size);
+void _arena_free_chunks(arena_chunk* chunk);
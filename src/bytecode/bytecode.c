@@ -0,0 +1,152 @@
+#include "specific.h"
+
+bytecode* bytecode_init(void){
+
+    short num_of_bytecodes;
+    bytecode* bc;
+
+    num_of_bytecodes = 1;
+
+    bc = (bytecode*) calloc(num_of_bytecodes, sizeof(bytecode));
+
+    if(bc == NULL){
+        fprintf(stderr, "Memory error - cannot calloc space for bytecode\n");
+        exit(EXIT_FAILURE);
+    }
+
+    bc->code = (instruction*) calloc(FIXEDSIZE_CODE, sizeof(instruction));
+
+    if(bc->code == NULL){
+        fprintf(stderr, "Memory error - cannot calloc space for bytecode\n");
+        exit(EXIT_FAILURE);
+    }
+
+    bc->size = 0;
+    bc->capacity = FIXEDSIZE_CODE;
+    return bc;
+}
+
+// appends a blank instruction and returns it for the caller to fill in. The
+// pointer is only valid until the next emit, so keep indices, not pointers
+instruction* bytecode_emit(bytecode* bc, opcode op, int token){
+
+    instruction* instr;
+
+    if(bc == NULL){
+        return NULL;
+    }
+
+    if(bc->size >= bc->capacity){
+        bc->code = (instruction*) realloc(bc->code, sizeof(instruction)*bc->capacity*SCALEFACTOR_CODE);
+
+        if(bc->code == NULL){
+            fprintf(stderr, "Memory error - cannot realloc space for bytecode\n");
+            exit(EXIT_FAILURE);
+        }
+        bc->capacity = bc->capacity*SCALEFACTOR_CODE;
+    }
+
+    instr = &bc->code[bc->size];
+    instr->op = op;
+    instr->token = token;
+    instr->slot = NO_SLOT;
+    instr->operand = 0;
+    instr->operand2 = 0;
+    instr->jump = NO_JUMP;
+    instr->loop = NO_JUMP;
+    instr->constant = NULL;
+    instr->copies = NULL;
+    bc->size = bc->size + 1;
+    return instr;
+}
+
+// as bytecode_emit(), but shifts the instructions from index onwards up one. Jumps
+// past index follow the instructions they pointed at; jumps to index itself now
+// land on the new instruction. A loop field names the op_loop_begin itself rather
+// than somewhere to land, so follows it even from index
+instruction* bytecode_insert(bytecode* bc, int index, opcode op, int token){
+
+    instruction blank;
+
+    if(bc == NULL || index < 0 || index > bc->size){
+        return NULL;
+    }
+
+    blank = *bytecode_emit(bc, op, token);
+    memmove(&bc->code[index + 1], &bc->code[index], sizeof(instruction)*(bc->size - 1 - index));
+    bc->code[index] = blank;
+
+    for(int i = 0; i < bc->size; i++){
+        bc->code[i].jump = _bytecode_shift(bc->code[i].jump, index, 1);
+        if(bc->code[i].loop != NO_JUMP && bc->code[i].loop >= index){
+            bc->code[i].loop++;
+        }
+    }
+    return &bc->code[index];
+}
+
+// drops count instructions from index onwards (and their constants). Jumps into
+// them now land on whatever follows
+bool bytecode_remove(bytecode* bc, int index, int count){
+
+    if(bc == NULL || index < 0 || count < 0 || index + count > bc->size){
+        return false;
+    }
+
+    for(int i = index; i < index + count; i++){
+        nlab_array_free(bc->code[i].constant);
+        bytecode_free_copies(&bc->code[i]);
+    }
+    memmove(&bc->code[index], &bc->code[index + count], sizeof(instruction)*(bc->size - index - count));
+    bc->size = bc->size - count;
+
+    for(int i = 0; i < bc->size; i++){
+        bc->code[i].jump = _bytecode_shift(bc->code[i].jump, index, -count);
+        bc->code[i].loop = _bytecode_shift(bc->code[i].loop, index, -count);
+    }
+    return true;
+}
+
+// where a jump to target goes once instructions are inserted (by > 0) or removed at index
+int _bytecode_shift(int target, int index, int by){
+    if(target == NO_JUMP || target <= index){
+        return target;
+    }
+    if(by < 0 && target < index - by){
+        return index;
+    }
+    return target + by;
+}
+
+instruction* bytecode_at(bytecode* bc, int index){
+    if(bc == NULL || index < 0 || index >= bc->size){
+        return NULL;
+    }
+    return &bc->code[index];
+}
+
+bool bytecode_free(bytecode* bc){
+    if(bc == NULL){
+        return false;
+    }
+
+    for(int i = 0; i < bc->size; i++){
+        nlab_array_free(bc->code[i].constant);
+        bytecode_free_copies(&bc->code[i]);
+    }
+    FREE_AND_NULL(bc->code);
+
+    FREE_AND_NULL(bc);
+    return true;
+}
+
+void bytecode_free_copies(instruction* instr){
+    if(instr == NULL || instr->copies == NULL){
+        return;
+    }
+
+    for(int slot = 0; slot < NUM_OF_VARS; slot++){
+        nlab_array_free(instr->copies[slot]);
+    }
+    FREE_AND_NULL(instr->copies);
+}
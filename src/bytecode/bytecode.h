@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../nlab_array/nlab_array.h"
+#include "../nlab_array/specific.h"
+
+/*
+    A program is compiled once into a flat list of instructions, then run by
+    interp_execute(). Variables are resolved to their map slot and integer
+    literals to ready-made 1x1 arrays at compile time, so executing an
+    instruction (e.g. each pass of a LOOP body) never re-reads a token.
+*/
+typedef enum opcode {
+    op_print_var,
+    op_print_string,
+    op_push_var,
+    op_push_int,
+    op_unary,
+    op_binary,
+    op_set_end,
+    op_create_ones,
+    op_create_read,
+    op_loop_begin,
+    op_loop_end,
+    op_fused,
+    op_invariant,
+    op_cache_store,
+    op_cache_load,
+    op_in_place,
+    op_move,
+    op_registers,
+    op_release,
+    op_until_stable
+} opcode;
+
+typedef struct instruction instruction;
+
+typedef struct bytecode bytecode;
+
+bytecode* bytecode_init(void);
+instruction* bytecode_emit(bytecode* bc, opcode op, int token);
+instruction* bytecode_insert(bytecode* bc, int index, opcode op, int token);
+bool bytecode_remove(bytecode* bc, int index, int count);
+instruction* bytecode_at(bytecode* bc, int index);
+bool bytecode_free(bytecode* bc);
+/* drops an op_until_stable's copies of its variables */
+void bytecode_free_copies(instruction* instr);
+int _bytecode_shift(int target, int index, int by);
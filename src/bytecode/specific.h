@@ -0,0 +1,45 @@
+#include "bytecode.h"
+#include "../map/map.h"
+
+#pragma once
+
+#define FIXEDSIZE_CODE 64
+#define SCALEFACTOR_CODE 2
+#define NO_SLOT -1
+#define NO_JUMP -1
+
+/*
+    operand holds the instruction's integer argument: the operator for
+    op_unary/op_binary, rows for op_create_ones, the loop limit for
+    op_loop_begin/op_loop_end, the filename token for op_create_read, the
+    number of values taken off the stack for op_fused, the cached value for
+    op_cache_store/op_cache_load, the target an op_move's source swaps with,
+    the number of registers an op_registers SET uses and a bit per variable
+    an op_until_stable watches. operand2 is cols for op_create_ones, the
+    number of times an op_loop_begin has been reached, and the last of those
+    an op_invariant's SET was run in or an op_until_stable last checked in.
+*/
+struct instruction {
+    opcode op;
+    // token the instruction was compiled from - used for error messages
+    int token;
+    short slot;
+    int operand;
+    int operand2;
+    // index of the instruction to continue from, for op_loop_begin/op_loop_end/op_fused/op_invariant/op_in_place/op_registers
+    int jump;
+    // index of the op_loop_begin an op_invariant's SET only needs running once per entry of,
+    // or whose LOOP an op_until_stable stops
+    int loop;
+    // pre-built value pushed by op_push_int, owned by the instruction
+    nlab_array* constant;
+    // an op_until_stable's variables as the last pass left them, by slot - they share
+    // the variables' buffers until those are written. Owned by the instruction
+    nlab_array** copies;
+};
+
+struct bytecode {
+    instruction* code;
+    int size;
+    int capacity;
+};
@@ -0,0 +1,277 @@
+#include "specific.h"
+
+/*
+    A GotoBLAS-style tiled multiply. Each thread takes whole blocks of GEMM_MC
+    rows of C. For every GEMM_NC-wide block of columns it packs GEMM_KC deep
+    panels of A and B into contiguous slivers, then the micro-kernel builds
+    GEMM_MR x GEMM_NR pieces of a 64-bit accumulator tile from them. Edge
+    slivers are zero-padded, so the micro-kernel only ever sees whole blocks.
+*/
+void gemm_int(const int* a, size_t lda, const int* b, size_t ldb, int* c, size_t ldc,
+              unsigned int m, unsigned int n, unsigned int k){
+    _gemm_run(a, lda, b, ldb, c, ldc, m, n, k, 0);
+}
+
+void gemm_int_mod(const int* a, size_t lda, const int* b, size_t ldb, int* c, size_t ldc,
+                  unsigned int m, unsigned int n, unsigned int k, unsigned int modulus){
+    assert(modulus > 0 && modulus <= INT_MAX);
+    _gemm_run(a, lda, b, ldb, c, ldc, m, n, k, modulus);
+}
+
+void _gemm_run(const int* a, size_t lda, const int* b, size_t ldb, int* c, size_t ldc,
+               unsigned int m, unsigned int n, unsigned int k, unsigned int modulus){
+
+    gemm_job jobs[GEMM_MAX_THREADS];
+    pthread_t threads[GEMM_MAX_THREADS];
+    unsigned int num_threads, started;
+    simd_level level;
+
+    if(m == 0 || n == 0){
+        return;
+    }
+
+    num_threads = _gemm_num_threads(m, n, k);
+    level = simd_get_level();
+
+    for(unsigned int t = 0; t < num_threads; t++){
+        jobs[t].a = a;
+        jobs[t].lda = lda;
+        jobs[t].b = b;
+        jobs[t].ldb = ldb;
+        jobs[t].c = c;
+        jobs[t].ldc = ldc;
+        jobs[t].m = m;
+        jobs[t].n = n;
+        jobs[t].k = k;
+        jobs[t].first_block = t;
+        jobs[t].block_step = num_threads;
+        jobs[t].level = level;
+        jobs[t].modulus = modulus;
+        jobs[t].depth = modulus == 0 ? GEMM_KC : _gemm_mod_depth(modulus);
+    }
+
+    // this thread does job 0 itself. If a thread can't be started, its rows
+    // are done here too rather than failing the multiply
+    started = 1;
+    for(unsigned int t = 1; t < num_threads; t++){
+        if(pthread_create(&threads[t], NULL, _gemm_worker, &jobs[t]) != 0){
+            break;
+        }
+        started++;
+    }
+    for(unsigned int t = started; t < num_threads; t++){
+        _gemm_worker(&jobs[t]);
+    }
+    _gemm_worker(&jobs[0]);
+
+    for(unsigned int t = 1; t < started; t++){
+        pthread_join(threads[t], NULL);
+    }
+}
+
+void* _gemm_worker(void* job){
+
+    gemm_job* j = (gemm_job*) job;
+    int* packed_a;
+    int* packed_b;
+    uint64_t* acc;
+    unsigned int ic, jc, pc, mc, nc, kc, nc_padded;
+    size_t num_blocks;
+
+    packed_a = (int*) _gemm_alloc(sizeof(int) * GEMM_MC * GEMM_KC);
+    packed_b = (int*) _gemm_alloc(sizeof(int) * GEMM_KC * GEMM_NC);
+    acc = (uint64_t*) _gemm_alloc(sizeof(uint64_t) * GEMM_MC * GEMM_NC);
+
+    num_blocks = (j->m + GEMM_MC - 1) / GEMM_MC;
+
+    for(size_t block = j->first_block; block < num_blocks; block += j->block_step){
+        ic = (unsigned int) block * GEMM_MC;
+        mc = (j->m - ic) < GEMM_MC ? (j->m - ic) : GEMM_MC;
+
+        for(jc = 0; jc < j->n; jc += GEMM_NC){
+            nc = (j->n - jc) < GEMM_NC ? (j->n - jc) : GEMM_NC;
+            nc_padded = ((nc + GEMM_NR - 1) / GEMM_NR) * GEMM_NR;
+            memset(acc, 0, sizeof(uint64_t) * GEMM_MC * nc_padded);
+
+            for(pc = 0; pc < j->k; pc += kc){
+                kc = (j->k - pc) < j->depth ? (j->k - pc) : j->depth;
+                _gemm_pack_a(j->a + ic * j->lda + pc, j->lda, mc, kc, j->modulus, packed_a);
+                _gemm_pack_b(j->b + pc * j->ldb + jc, j->ldb, kc, nc, j->modulus, packed_b);
+
+                for(unsigned int jr = 0; jr < nc; jr += GEMM_NR){
+                    for(unsigned int ir = 0; ir < mc; ir += GEMM_MR){
+                        #ifdef SIMD_X86
+                        if(j->level == simd_avx2){
+                            _gemm_micro_kernel_avx2(kc, packed_a + (size_t) ir * kc, packed_b + (size_t) jr * kc,
+                                                    acc + (size_t) ir * nc_padded + jr, nc_padded);
+                            continue;
+                        }
+                        #endif
+                        _gemm_micro_kernel(kc, packed_a + (size_t) ir * kc, packed_b + (size_t) jr * kc,
+                                           acc + (size_t) ir * nc_padded + jr, nc_padded);
+                    }
+                }
+
+                if(j->modulus != 0){
+                    for(size_t i = 0; i < (size_t) mc * nc_padded; i++){
+                        acc[i] %= j->modulus;
+                    }
+                }
+            }
+
+            // the low 32 bits of a wrapped 64-bit sum are the low 32 bits of the true sum
+            for(unsigned int i = 0; i < mc; i++){
+                int* c_row = j->c + (ic + i) * j->ldc + jc;
+                uint64_t* acc_row = acc + (size_t) i * nc_padded;
+                for(unsigned int x = 0; x < nc; x++){
+                    c_row[x] = (int) (uint32_t) acc_row[x];
+                }
+            }
+        }
+    }
+
+    free(packed_a);
+    free(packed_b);
+    free(acc);
+    return NULL;
+}
+
+/*
+    How many products of two values below modulus can be added to an
+    accumulator that's already below modulus without it wrapping.
+*/
+unsigned int _gemm_mod_depth(unsigned int modulus){
+
+    uint64_t largest, depth;
+
+    largest = (uint64_t) modulus - 1;
+    if(largest == 0){
+        return GEMM_KC;
+    }
+    depth = (UINT64_MAX - largest) / (largest * largest);
+    return depth < GEMM_KC ? (unsigned int) depth : GEMM_KC;
+}
+
+// value in 0 .. modulus-1, or unchanged when modulus is 0
+int _gemm_reduce(int value, unsigned int modulus){
+
+    int64_t reduced;
+
+    if(modulus == 0){
+        return value;
+    }
+    reduced = (int64_t) value % modulus;
+    return (int) (reduced < 0 ? reduced + modulus : reduced);
+}
+
+// mc x kc of A as GEMM_MR-row slivers, each laid out column by column
+void _gemm_pack_a(const int* a, size_t lda, unsigned int mc, unsigned int kc, unsigned int modulus, int* packed){
+
+    for(unsigned int ir = 0; ir < mc; ir += GEMM_MR){
+        for(unsigned int p = 0; p < kc; p++){
+            for(unsigned int i = 0; i < GEMM_MR; i++){
+                *packed++ = ir + i < mc ? _gemm_reduce(a[(size_t) (ir + i) * lda + p], modulus) : 0;
+            }
+        }
+    }
+}
+
+// kc x nc of B as GEMM_NR-column slivers, each laid out row by row
+void _gemm_pack_b(const int* b, size_t ldb, unsigned int kc, unsigned int nc, unsigned int modulus, int* packed){
+
+    for(unsigned int jr = 0; jr < nc; jr += GEMM_NR){
+        for(unsigned int p = 0; p < kc; p++){
+            const int* b_row = b + (size_t) p * ldb + jr;
+            for(unsigned int x = 0; x < GEMM_NR; x++){
+                *packed++ = jr + x < nc ? _gemm_reduce(b_row[x], modulus) : 0;
+            }
+        }
+    }
+}
+
+// acc (GEMM_MR x GEMM_NR, rows ldacc apart) += a sliver * b sliver, wrapping
+// at 64 bits. Each product fits in an int64_t, so only the sums need to wrap
+void _gemm_micro_kernel(unsigned int kc, const int* a, const int* b, uint64_t* acc, size_t ldacc){
+
+    uint64_t sums[GEMM_MR][GEMM_NR];
+
+    memset(sums, 0, sizeof(sums));
+
+    for(unsigned int p = 0; p < kc; p++){
+        for(unsigned int i = 0; i < GEMM_MR; i++){
+            int64_t a_value = a[p * GEMM_MR + i];
+            for(unsigned int x = 0; x < GEMM_NR; x++){
+                sums[i][x] += (uint64_t) (a_value * b[p * GEMM_NR + x]);
+            }
+        }
+    }
+
+    for(unsigned int i = 0; i < GEMM_MR; i++){
+        for(unsigned int x = 0; x < GEMM_NR; x++){
+            acc[i * ldacc + x] += sums[i][x];
+        }
+    }
+}
+
+#ifdef SIMD_X86
+/*
+    The same block with AVX2: each row of the block is two registers of four
+    64-bit sums. B's ints are sign-extended to 64-bit lanes once per step, and
+    _mm256_mul_epi32 multiplies the low 32 bits of each lane into a full 64.
+*/
+__attribute__((target("avx2")))
+void _gemm_micro_kernel_avx2(unsigned int kc, const int* a, const int* b, uint64_t* acc, size_t ldacc){
+
+    __m256i sums[GEMM_MR][2];
+    __m256i b_lo, b_hi, a_value;
+    uint64_t* acc_row;
+
+    for(unsigned int i = 0; i < GEMM_MR; i++){
+        sums[i][0] = _mm256_setzero_si256();
+        sums[i][1] = _mm256_setzero_si256();
+    }
+
+    for(unsigned int p = 0; p < kc; p++){
+        b_lo = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*) (b + p * GEMM_NR)));
+        b_hi = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*) (b + p * GEMM_NR + 4)));
+        for(unsigned int i = 0; i < GEMM_MR; i++){
+            a_value = _mm256_set1_epi64x(a[p * GEMM_MR + i]);
+            sums[i][0] = _mm256_add_epi64(sums[i][0], _mm256_mul_epi32(a_value, b_lo));
+            sums[i][1] = _mm256_add_epi64(sums[i][1], _mm256_mul_epi32(a_value, b_hi));
+        }
+    }
+
+    for(unsigned int i = 0; i < GEMM_MR; i++){
+        acc_row = acc + i * ldacc;
+        _mm256_storeu_si256((__m256i*) acc_row, _mm256_add_epi64(_mm256_loadu_si256((__m256i*) acc_row), sums[i][0]));
+        _mm256_storeu_si256((__m256i*) (acc_row + 4), _mm256_add_epi64(_mm256_loadu_si256((__m256i*) (acc_row + 4)), sums[i][1]));
+    }
+}
+#endif
+
+unsigned int _gemm_num_threads(unsigned int m, unsigned int n, unsigned int k){
+
+    long num_cpus;
+    unsigned int num_blocks, num_threads;
+
+    if((double) m * n * k < GEMM_MIN_PARALLEL_WORK){
+        return 1;
+    }
+
+    num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    num_blocks = (m + GEMM_MC - 1) / GEMM_MC;
+    num_threads = num_cpus < 1 ? 1 : (unsigned int) num_cpus;
+    num_threads = num_threads < num_blocks ? num_threads : num_blocks;
+    return num_threads < GEMM_MAX_THREADS ? num_threads : GEMM_MAX_THREADS;
+}
+
+void* _gemm_alloc(size_t num_bytes){
+
+    void* p = malloc(num_bytes);
+
+    if(p == NULL){
+        fprintf(stderr, "Memory error - cannot malloc space for dot-product\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
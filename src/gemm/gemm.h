@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../general.h"
+
+/*
+    C = A * B for row-major int matrices, A being m x k and B k x n. lda, ldb
+    and ldc are the distances between rows, in ints. Products are summed in 64
+    bits and truncated to int when stored, so results match plain int
+    arithmetic wherever that doesn't overflow (and wrap like it where it does).
+*/
+void gemm_int(const int* a, size_t lda, const int* b, size_t ldb, int* c, size_t ldc,
+              unsigned int m, unsigned int n, unsigned int k);
+/* as gemm_int(), but every element of C is reduced into 0 .. modulus-1 (modulus <= INT_MAX).
+   A and B may hold any ints - they're reduced as they're packed */
+void gemm_int_mod(const int* a, size_t lda, const int* b, size_t ldb, int* c, size_t ldc,
+                  unsigned int m, unsigned int n, unsigned int k, unsigned int modulus);
@@ -0,0 +1,53 @@
+#include "gemm.h"
+
+#pragma once
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../simd/specific.h"
+
+// register block computed by the micro-kernel
+#define GEMM_MR 4
+#define GEMM_NR 8
+// cache blocks: an MC x KC panel of A stays in L2, a KC x NR sliver of B in L1
+#define GEMM_MC 64
+#define GEMM_KC 256
+#define GEMM_NC 512
+#define GEMM_MAX_THREADS 64
+// below this many multiply-adds, starting threads costs more than it saves
+#define GEMM_MIN_PARALLEL_WORK (1u << 21)
+
+typedef struct gemm_job gemm_job;
+
+struct gemm_job {
+    const int* a;
+    size_t lda;
+    const int* b;
+    size_t ldb;
+    int* c;
+    size_t ldc;
+    unsigned int m, n, k;
+    // this job takes row blocks first_block, first_block + block_step, ...
+    unsigned int first_block;
+    unsigned int block_step;
+    simd_level level;
+    // 0 for plain int arithmetic. Otherwise the accumulators are reduced after
+    // every depth-deep panel, before they could overflow
+    unsigned int modulus;
+    unsigned int depth;
+};
+
+void _gemm_run(const int* a, size_t lda, const int* b, size_t ldb, int* c, size_t ldc,
+               unsigned int m, unsigned int n, unsigned int k, unsigned int modulus);
+void* _gemm_worker(void* job);
+unsigned int _gemm_mod_depth(unsigned int modulus);
+int _gemm_reduce(int value, unsigned int modulus);
+void _gemm_pack_a(const int* a, size_t lda, unsigned int mc, unsigned int kc, unsigned int modulus, int* packed);
+void _gemm_pack_b(const int* b, size_t ldb, unsigned int kc, unsigned int nc, unsigned int modulus, int* packed);
+void _gemm_micro_kernel(unsigned int kc, const int* a, const int* b, uint64_t* acc, size_t ldacc);
+#ifdef SIMD_X86
+void _gemm_micro_kernel_avx2(unsigned int kc, const int* a, const int* b, uint64_t* acc, size_t ldacc);
+#endif
+unsigned int _gemm_num_threads(unsigned int m, unsigned int n, unsigned int k);
+void* _gemm_alloc(size_t num_bytes);
@@ -9,6 +9,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <limits.h>
+#include <stdint.h>
 #include <string.h>
 
 #define MAX_STRING_LENGTH 1000
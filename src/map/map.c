@@ -25,18 +25,25 @@ map* map_init(void){
 
 bool map_add(map* map, char* key, nlab_array* value){
     
-    short code;
-
     if(map != NULL && key != NULL && value != NULL){
-        if(map_contains_key(map, key)){
-            nlab_array_free(map_get_key_value(map, key));
-        }
+        return map_add_by_code(map, map_get_keycode(key), value);
+    }
+
+    return false;
+}
+
+// as map_add(), for callers that resolved the variable's slot up front
+bool map_add_by_code(map* map, short code, nlab_array* value){
 
+    if(map != NULL && code >= 0 && code < NUM_OF_VARS && value != NULL){
+        // shares value's buffer; take it before freeing the old value in case they're the same
         nlab_array* copy_val = nlab_array_copy(value);
 
-        code = map_get_keycode(key);
+        nlab_array_free(map->variablemap[code].value);
 
-        strcpy(map->variablemap[code].key, key);
+        map->variablemap[code].key[0] = '$';
+        map->variablemap[code].key[1] = (char) ('A' + code);
+        map->variablemap[code].key[2] = '\0';
         map->variablemap[code].value = copy_val;
         return true;
     }
@@ -72,6 +79,46 @@ nlab_array* map_get_key_value(map* map,  char* key){
     return NULL;
 }
 
+nlab_array* map_get_by_code(map* map, short code){
+    if(map == NULL || code < 0 || code >= NUM_OF_VARS){
+        return NULL;
+    }
+    return map->variablemap[code].value;
+}
+
+nlab_array** map_slot_by_code(map* map, short code){
+    if(map == NULL || code < 0 || code >= NUM_OF_VARS){
+        return NULL;
+    }
+    return &map->variablemap[code].value;
+}
+
+bool map_remove_by_code(map* map, short code){
+    if(map == NULL || code < 0 || code >= NUM_OF_VARS || map->variablemap[code].value == NULL){
+        return false;
+    }
+
+    nlab_array_free(map->variablemap[code].value);
+    map->variablemap[code].value = NULL;
+    map->variablemap[code].key[0] = '\0';
+    return true;
+}
+
+bool map_swap_by_code(map* map, short code1, short code2){
+
+    nlab_array* value;
+
+    if(map == NULL || code1 < 0 || code1 >= NUM_OF_VARS || code2 < 0 || code2 >= NUM_OF_VARS
+    || map->variablemap[code1].value == NULL || map->variablemap[code2].value == NULL){
+        return false;
+    }
+
+    value = map->variablemap[code1].value;
+    map->variablemap[code1].value = map->variablemap[code2].value;
+    map->variablemap[code2].value = value;
+    return true;
+}
+
 bool map_free(map* map){
 
     if(map == NULL){
@@ -80,14 +127,9 @@ bool map_free(map* map){
 
     for(int i = 0; i < NUM_OF_VARS; i++){
         if(map->variablemap[i].value != NULL){
-            for(unsigned int j = 0; j < map->variablemap[i].value->rows; j++){
-                if(map->variablemap[i].value->array[j] != NULL){
-                    FREE_AND_NULL(map->variablemap[i].value->array[j]);
-                }
-            }
-            FREE_AND_NULL(map->variablemap[i].value->array);
+            nlab_array_free(map->variablemap[i].value);
+            map->variablemap[i].value = NULL;
         }
-        FREE_AND_NULL(map->variablemap[i].value);
     }
 
     FREE_AND_NULL(map->variablemap);
@@ -15,5 +15,13 @@ map* map_init(void);
 bool map_add(map* map, char* key, nlab_array* value);
 bool map_contains_key(map* map,  char* key);
 struct nlab_array* map_get_key_value(map* map,  char* key);
+nlab_array* map_get_by_code(map* map, short code);
+/* where the map keeps a variable's value, for reading it without a lookup each
+   time. The value there is NULL while the variable isn't set */
+nlab_array** map_slot_by_code(map* map, short code);
+bool map_add_by_code(map* map, short code, nlab_array* value);
+bool map_remove_by_code(map* map, short code);
+/* exchanges the values of two set variables */
+bool map_swap_by_code(map* map, short code1, short code2);
 bool map_free(map* map);
 short map_get_keycode(char* key);
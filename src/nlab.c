@@ -1,4 +1,7 @@
 #include "nlab.h"
+#ifdef NLABC
+#include "nlabc/nlabc.h"
+#endif
 
 #ifdef TESTMODE
 int main(void){
@@ -7,7 +10,36 @@ int main(void){
     return EXIT_SUCCESS;
     }
 
-#else
+#elif defined(NLABC)
+// writes the program out as C, to stdout, rather than running it
+int main(int argc, char* argv[]){
+
+    short prog_arg, file_arg, num_of_cmd_line_args;
+    Program* prog;
+    bool compiled;
+
+    prog_arg = 0;
+    file_arg = 1;
+    num_of_cmd_line_args = 2;
+
+    if(argc != num_of_cmd_line_args){
+        fprintf(stderr, "IO error - usage: %s <filename.nlb>\n.", argv[prog_arg]);
+        exit(EXIT_FAILURE);
+    }
+
+    prog = program_builder_init();
+    prog->compile_only = true;
+    prog->release_dead_variables = true;
+    prog->remove_dead_stores = true;
+
+    readfile(argv[file_arg], prog);
+
+    compiled = program(prog);
+    nlabc_emit(prog, compiled, argv[file_arg], stdout);
+    program_builder_free(prog);
+    exit(EXIT_SUCCESS);
+}
+#elif !defined(NLABC_PROGRAM)
 int main(int argc, char* argv[]){
 
     short prog_arg, file_arg, num_of_cmd_line_args;
@@ -23,10 +55,22 @@ int main(int argc, char* argv[]){
     }
 
     prog = program_builder_init();
+    prog->release_dead_variables = true;
+    prog->remove_dead_stores = true;
 
     readfile(argv[file_arg], prog);
 
-    if(program(prog)){
+    finish_program(prog, program(prog));
+}
+#endif
+
+// reports how the run went, frees prog and exits - shared with programs compiled by nlabc
+void finish_program(Program* prog, bool ran){
+
+    if(ran){
+        #ifdef ALLOC_REPORT
+        print_alloc_report(prog);
+        #endif
         program_builder_free(prog);
         exit(EXIT_SUCCESS);
     } else{
@@ -40,7 +84,6 @@ int main(int argc, char* argv[]){
         exit(EXIT_FAILURE);
     }
 }
-#endif
 
 #ifdef TESTMODE
 void test(void){
@@ -48,6 +91,11 @@ void test(void){
     test_stack();
     test_map();
     test_nlab_array();
+    test_bytecode();
+    test_simd();
+    test_gemm();
+    test_arena();
+    test_nlabc();
 }
 #endif
 
@@ -108,6 +156,21 @@ bool set_error_msg(Program* prog, const char* msg){
     return false;
 }
 
+// built with -DALLOC_REPORT (make interp_report/extension_report) to have this written to stderr after a run
+void print_alloc_report(Program* prog){
+
+    nlab_alloc_counts counts = nlab_array_alloc_counts();
+
+    fprintf(stderr, "nlab arrays: %zu heap allocations, %zu from arenas (%zu arena chunks)\n",
+            counts.heap, counts.arena,
+            arena_num_chunk_allocs(prog->program_arena) + arena_num_chunk_allocs(prog->scratch_arena));
+    fprintf(stderr, "buffer pool: %zu hits, %zu misses\n", counts.pool_hits, counts.pool_misses);
+    fprintf(stderr, "heap allocations in the last LOOP iteration: %zu\n", prog->last_iteration_heap_allocs);
+    fprintf(stderr, "peak array memory: %zu bytes in use, %zu held with the pool, %zu in arenas\n",
+            counts.peak_live_bytes, counts.peak_held_bytes,
+            arena_num_bytes(prog->program_arena) + arena_num_bytes(prog->scratch_arena));
+}
+
 void process_error_msg(Program* prog, char* message){
 
     char dummystr[MAX_STRING_LENGTH];
@@ -225,13 +288,45 @@ bool _format_filename(char* filename){
 bool program(Program* prog){
     CHECK_PROG_FOR_NULL(prog);
 
+    #ifdef INTERP
+    int first_instruction;
+    bool compiled;
+    shape_check shapes;
+    #endif
+
     if(STRINGS_EQUAL(CURRENT_WORD, "BEGIN")){
         INCR_CURRENT_WORD;
         if(STRINGS_EQUAL(CURRENT_WORD, LBRACE)){
             INCR_CURRENT_WORD;
+
+            #ifndef INTERP
             if(instrc_list(prog)){
                 return true;
             }
+            #else
+            // compile the whole program before running any of it
+            first_instruction = prog->bytecode->size;
+            prog->compile_depth++;
+            compiled = instrc_list(prog);
+            prog->compile_depth--;
+
+            // shapes that can't fit are reported before anything has run
+            shapes = compiled ? _interp_check_shapes(prog, first_instruction) : shapes_mismatch;
+            if(shapes != shapes_mismatch){
+                // a SET is only dropped if the check followed the whole run, so it can't have failed
+                if(prog->remove_dead_stores && shapes == shapes_ok){
+                    _interp_remove_dead_stores(prog, first_instruction);
+                }
+                _interp_move_dead_copies(prog, first_instruction);
+                if(prog->release_dead_variables){
+                    _interp_release_dead_variables(prog, first_instruction);
+                }
+            }
+
+            if(shapes != shapes_mismatch && _interp_run_if_top_level(prog, first_instruction)){
+                return true;
+            }
+            #endif
         }
     }
     SET_ERROR_STATE(error_parse);
@@ -283,44 +378,26 @@ bool print(Program* prog){
         INCR_CURRENT_WORD;
 
         #ifdef INTERP
-        char* temp;
+        int first_instruction = prog->bytecode->size;
+        instruction* instr;
         #endif
 
         if(varname(prog)){
 
             #ifdef INTERP
-            char message[MAX_STRING_LENGTH];
-            
-            // varname() increments word counter, so look back one
-            temp = interp_print_variable(prog, LOOK_AT_PREV_WORD);
-            strcpy(message, temp);
-            if(prog->error_state == error_interp){
-                strcat(message, "illegal use of uninitialized variable: \'");
-                strcat(message, LOOK_AT_PREV_WORD);
-                strcat(message, "\'");
-                set_error_msg(prog, message);
-                free(temp);
-                return false; 
-            } else{
-                #ifndef TESTMODE
-                printf("%s", message);
-                #endif
-                free(temp);
-            }
+            // varname() increments word counter, so look back one - the slot is resolved now, as for a push
+            instr = bytecode_emit(prog->bytecode, op_print_var, prog->current_token - 1);
+            instr->slot = map_get_keycode(LOOK_AT_PREV_WORD);
+            return _interp_run_if_top_level(prog, first_instruction);
             #endif
 
             return true;
         } else if(string(prog)){
 
             #ifdef INTERP
-            // string() increments word counter, so look back one    
-            temp = interp_print_string(LOOK_AT_PREV_WORD);
-
-            #ifndef TESTMODE
-            printf("%s\n", temp);
-            #endif
-
-            free(temp);
+            // string() increments word counter, so look back one
+            bytecode_emit(prog->bytecode, op_print_string, prog->current_token - 1);
+            return _interp_run_if_top_level(prog, first_instruction);
             #endif
 
             return true;
@@ -401,28 +478,36 @@ bool set(Program* prog){
     CHECK_PROG_FOR_NULL(prog);
 
     #ifdef INTERP
-        char* variable_context;
+    int first_instruction, target_token;
+    instruction* instr;
     #endif
 
     if(STRINGS_EQUAL(CURRENT_WORD, "SET")){
         INCR_CURRENT_WORD;
+
+        #ifdef INTERP
+        first_instruction = prog->bytecode->size;
+        #endif
+
         if(varname(prog)){
             #ifdef INTERP
-                variable_context = LOOK_AT_PREV_WORD;
+            target_token = prog->current_token - 1;
             #endif
 
             if(STRINGS_EQUAL(CURRENT_WORD, ":=")){
                 INCR_CURRENT_WORD;
                 if(polish_list(prog)){
 
-                    short stack_sz_only_with_result = 1;
-                    
-                    if(prog->polish_stack->size == stack_sz_only_with_result){
-                        char* var = _interp_get_var_context(prog);
-                        nlab_array* top = stack_peek(prog->polish_stack);
-                        map_add(prog->variable_map, var, top);
-                        stack_pop(prog->polish_stack);
-                    }
+                    #ifdef INTERP
+                    _interp_fold_constants(prog, first_instruction);
+                    _interp_share_subexpressions(prog, first_instruction);
+                    _interp_fuse_elementwise(prog, first_instruction);
+                    _interp_update_in_place(prog, first_instruction, map_get_keycode(prog->tokens[target_token]));
+                    _interp_assign_registers(prog, first_instruction);
+                    instr = bytecode_emit(prog->bytecode, op_set_end, target_token);
+                    instr->slot = map_get_keycode(prog->tokens[target_token]);
+                    return _interp_run_if_top_level(prog, first_instruction);
+                    #endif
 
                 return true;
                 }
@@ -464,30 +549,14 @@ bool polish(Program* prog){
     } else if(unaryop(prog)){
 
         #ifdef INTERP
-
-        if(!interp_set(prog)){
-            SET_ERROR_STATE(error_interp);
-            char dummy[MAX_STRING_LENGTH];
-            dummy[0] = '\0';
-            strcat(dummy, "unable to interpret expression during SET");
-            set_error_msg(prog, dummy);
-            return false;
-        }
+        _interp_emit_operator(prog, op_unary, prog->token_codes[prog->current_token - 1].operation_type);
         #endif
 
         return  true;
     } else if(binaryop(prog)){
 
         #ifdef INTERP
-
-        if(!interp_set(prog)){
-            SET_ERROR_STATE(error_interp);
-            char dummy[MAX_STRING_LENGTH];
-            dummy[0] = '\0';
-            strcat(dummy, "unable to interpret expression during SET");
-            set_error_msg(prog, dummy);
-            return false;
-        }
+        _interp_emit_operator(prog, op_binary, prog->token_codes[prog->current_token - 1].operation_type);
         #endif
         return true;
     }
@@ -499,14 +568,16 @@ bool polish(Program* prog){
 bool pushdown(Program* prog){
     CHECK_PROG_FOR_NULL(prog);
 
+    #ifdef INTERP
+    instruction* instr;
+    arena* previous_arena;
+    #endif
+
     if(varname(prog)){
 
         #ifdef INTERP
-            if(interp_pushdown_variable(prog)){
-                return true;
-            } else{
-                return false;
-            }
+        instr = bytecode_emit(prog->bytecode, op_push_var, prog->current_token - 1);
+        instr->slot = map_get_keycode(LOOK_AT_PREV_WORD);
         #endif
 
         return true;
@@ -514,12 +585,11 @@ bool pushdown(Program* prog){
     } else if(integer(prog)){
 
         #ifdef INTERP
-        nlab_array* arr = nlab_array_create_1d(word_to_integer(LOOK_AT_PREV_WORD));
-        if(stack_push(prog->polish_stack, arr)){
-            // pass-by-value, so free the pointer on this side of the pushdown
-            nlab_array_free(arr);
-            return true;
-        }
+        // the literal is built once here, and shared with the stack each time it's pushed
+        instr = bytecode_emit(prog->bytecode, op_push_int, prog->current_token - 1);
+        previous_arena = nlab_array_use_arena(prog->program_arena);
+        instr->constant = nlab_array_create_1d(word_to_integer(LOOK_AT_PREV_WORD));
+        nlab_array_use_arena(previous_arena);
         #endif
 
         return true;
@@ -550,27 +620,11 @@ bool integer(Program* prog){
 bool unaryop(Program* prog){
     CHECK_PROG_FOR_NULL(prog);
 
-    if(STRINGS_EQUAL(CURRENT_WORD, "U-NOT")){
-        INCR_CURRENT_WORD;
-        return true;
-
-    } else if (STRINGS_EQUAL(CURRENT_WORD, "U-EIGHTCOUNT")){
-        INCR_CURRENT_WORD;
-        return true;
-    }
-    #ifdef EXTENSION
-    else if (STRINGS_EQUAL(CURRENT_WORD, "U-TRACE")){
-        INCR_CURRENT_WORD;
-        return true;
-    } else if (STRINGS_EQUAL(CURRENT_WORD, "U-TRANSPOSE")){
-        INCR_CURRENT_WORD;
-        return true;
-    } else if (STRINGS_EQUAL(CURRENT_WORD, "U-SUBMATRIX")){
+    if(prog->token_codes[prog->current_token].kind == token_unary){
         INCR_CURRENT_WORD;
         return true;
     }
-    #endif
-    
+
     return false;
 }
 
@@ -579,39 +633,11 @@ bool unaryop(Program* prog){
 bool binaryop(Program* prog){
     CHECK_PROG_FOR_NULL(prog);
 
-    if(STRINGS_EQUAL(CURRENT_WORD, "B-AND")){
-        INCR_CURRENT_WORD;
-        return true;
-    } else if (STRINGS_EQUAL(CURRENT_WORD, "B-OR")){
-        INCR_CURRENT_WORD;
-        return true;
-    } else if (STRINGS_EQUAL(CURRENT_WORD, "B-GREATER")){
-        INCR_CURRENT_WORD;
-        return true;
-    } else if (STRINGS_EQUAL(CURRENT_WORD, "B-LESS")){
-        INCR_CURRENT_WORD;
-        return true;
-    } else if (STRINGS_EQUAL(CURRENT_WORD, "B-ADD")){
-        INCR_CURRENT_WORD;
-        return true;
-    } else if (STRINGS_EQUAL(CURRENT_WORD, "B-TIMES")){
-        INCR_CURRENT_WORD;
-        return true;
-    } else if (STRINGS_EQUAL(CURRENT_WORD, "B-EQUALS")){
-        INCR_CURRENT_WORD;
-        return true;
-    }
-    #ifdef EXTENSION
-    else if(STRINGS_EQUAL(CURRENT_WORD,"B-DOTPRODUCT")){
-        INCR_CURRENT_WORD;
-        return true;
-    }
-    else if(STRINGS_EQUAL(CURRENT_WORD,"B-POWER")){
+    if(prog->token_codes[prog->current_token].kind == token_binary){
         INCR_CURRENT_WORD;
         return true;
     }
-    #endif
-    
+
     return false;
 }
 
@@ -623,9 +649,9 @@ bool create(Program* prog){
         INCR_CURRENT_WORD;
 
         #ifdef INTERP
-        unsigned int num_rows, num_cols;
-        nlab_array* ones = NULL;
-        char* variable_context;
+        int num_rows, num_cols, first_instruction;
+        instruction* instr;
+        first_instruction = prog->bytecode->size;
         #endif
 
         if(rows(prog)){
@@ -638,27 +664,21 @@ bool create(Program* prog){
 
                 #ifdef INTERP
                 num_cols = atoi(LOOK_AT_PREV_WORD);
-                ones = nlab_array_create_ones(num_rows, num_cols);
                 #endif
 
                 if(varname(prog)){
 
                     // varname() incr. word count, so have to look back one word
                     #ifdef INTERP
-                    variable_context = LOOK_AT_PREV_WORD;
-                    if(interp_create_ones(prog, LOOK_AT_PREV_WORD, ones)){
-                        return true;
-                    }
+                    instr = bytecode_emit(prog->bytecode, op_create_ones, prog->current_token - 1);
+                    instr->slot = map_get_keycode(LOOK_AT_PREV_WORD);
+                    instr->operand = num_rows;
+                    instr->operand2 = num_cols;
+                    return _interp_run_if_top_level(prog, first_instruction);
                     #else
                     return true;
                     #endif
                 }
-
-                #ifdef INTERP
-                if(ones != NULL){
-                    nlab_array_free(ones);
-                }
-                #endif
             }
         }
         SET_ERROR_STATE(error_parse);
@@ -669,30 +689,22 @@ bool create(Program* prog){
         INCR_CURRENT_WORD;
 
         #ifdef INTERP
-        char* fname, *variable_context;
-        nlab_array* read_arr = NULL;
+        int fname_token, first_instruction;
+        instruction* instr;
+        first_instruction = prog->bytecode->size;
         #endif
 
         if(filename(prog)){
             #ifdef INTERP
-            fname = LOOK_AT_PREV_WORD;
+            fname_token = prog->current_token - 1;
             #endif
 
             if(varname(prog)){
                 #ifdef INTERP
-                variable_context = LOOK_AT_PREV_WORD;
-
-                if(!interp_create_read(prog, variable_context, read_arr, fname)){
-                    SET_ERROR_STATE(error_io);
-                    
-                    char errmsg[MAX_STRING_LENGTH];
-                    errmsg[0] = '\0';
-                    strcat(errmsg,"unable to open file ");
-                    strcat(errmsg, fname);
-                    set_error_msg(prog, errmsg);
-                    process_error_msg(prog, errmsg);
-                    return false;
-                }
+                instr = bytecode_emit(prog->bytecode, op_create_read, prog->current_token - 1);
+                instr->slot = map_get_keycode(LOOK_AT_PREV_WORD);
+                instr->operand = fname_token;
+                return _interp_run_if_top_level(prog, first_instruction);
                 #endif
 
                 return true;
@@ -737,46 +749,36 @@ bool filename(Program* prog){
     return false;
 }
 
-// <LOOP> ::= "LOOP" <VARNAME> <INTEGER> "{" <INSTRCLIST>
+// <LOOP> ::= "LOOP" <VARNAME> <INTEGER> <STABLE> "{" <INSTRCLIST>
 bool loop(Program* prog){
     CHECK_PROG_FOR_NULL(prog);
 
-    int condition_int;
+    int condition_int, watched;
     char* condition_str;
 
     #ifdef INTERP
-    int jump_to;
-    char* variablename;
-    nlab_array* counter_arr = NULL;
+    int first_instruction, loop_begin, loop_end, counter_token;
+    bool compiled;
+    instruction* instr;
     #endif
 
     if(STRINGS_EQUAL(CURRENT_WORD, "LOOP")){
         INCR_CURRENT_WORD;
+
+        #ifdef INTERP
+        first_instruction = prog->bytecode->size;
+        #endif
+
         if(varname(prog)){
 
             #ifdef INTERP
-            variablename = LOOK_AT_PREV_WORD;
-            jump_to = 0;
-
-            if(map_contains_key(prog->variable_map, variablename)){
-                SET_ERROR_STATE(error_interp);
-                char dummy[MAX_STRING_LENGTH];
-                dummy[0] = '\0';
-                strcat(dummy, "variale already declared: ");
-                strcat(dummy, variablename);
-                set_error_msg(prog, dummy);
-                return false;
-            } else {
-                counter_arr = nlab_array_create_1d(1);
-                map_add(prog->variable_map, variablename, counter_arr);
-                nlab_array_free(counter_arr);
-            }
+            counter_token = prog->current_token - 1;
             #endif
 
             if(integer(prog)){
                 condition_str = LOOK_AT_PREV_WORD;
                 condition_int = atoi(condition_str);
-                if((condition_int != 0)){
+                if((condition_int != 0) && until_stable(prog, &watched)){
                     if(STRINGS_EQUAL(CURRENT_WORD, LBRACE)){
                         INCR_CURRENT_WORD;
 
@@ -787,39 +789,34 @@ bool loop(Program* prog){
                         }
                         #endif
 
-                        // Interp version
+                        // Interp version - the body is compiled once, between a
+                        // begin and end instruction that jump over/back to it
                         #ifdef INTERP
-                        jump_to = prog->current_token;
-                        counter_arr = map_get_key_value(prog->variable_map, variablename); 
-                        while(counter_arr->array[0][0] <= condition_int){
-                            
-                            counter_arr = map_get_key_value(prog->variable_map, variablename); 
-                            int store = counter_arr->array[0][0];
-                            int tempcounter;
-
-                            if(instrc_list(prog)){
-                                counter_arr = map_get_key_value(prog->variable_map, variablename);
-                                
-                                if(counter_arr == NULL && counter_arr->array==NULL){
-                                    tempcounter = store;
-                                } else{
-                                    tempcounter = counter_arr->array[0][0];
-                                }
-                                
-                                if(tempcounter >= condition_int){
-                                    short key = map_get_keycode(variablename);
-                                    strcpy(prog->variable_map->variablemap[key].key, "\0\0\0");
-                                    nlab_array_free(counter_arr);
-                                    counter_arr = NULL;
-                                    prog->variable_map->variablemap[key].value=NULL;
-                                    return true;
-                                }
+                        loop_begin = prog->bytecode->size;
+                        instr = bytecode_emit(prog->bytecode, op_loop_begin, counter_token);
+                        instr->slot = map_get_keycode(prog->tokens[counter_token]);
+                        instr->operand = condition_int;
+
+                        prog->compile_depth++;
+                        compiled = instrc_list(prog);
+                        prog->compile_depth--;
+
+                        if(compiled){
+                            _interp_hoist_invariants(prog, loop_begin);
+                            // checked once the body has run, just before the counter is
+                            if(watched != 0){
+                                instr = bytecode_emit(prog->bytecode, op_until_stable, counter_token);
+                                instr->operand = watched;
+                                instr->loop = loop_begin;
                             }
-                            counter_arr->array[0][0] = counter_arr->array[0][0] + 1;
-                            prog->current_token = jump_to;
+                            loop_end = prog->bytecode->size;
+                            instr = bytecode_emit(prog->bytecode, op_loop_end, counter_token);
+                            instr->slot = map_get_keycode(prog->tokens[counter_token]);
+                            instr->operand = condition_int;
+                            instr->jump = loop_begin + 1;
+                            bytecode_at(prog->bytecode, loop_begin)->jump = loop_end + 1;
+                            return _interp_run_if_top_level(prog, first_instruction);
                         }
-                    
-                        return true;
                         #endif
                     }
                 }
@@ -833,6 +830,32 @@ bool loop(Program* prog){
     return false;
 }
 
+/*
+    <STABLE> ::= "" | "UNTIL-STABLE" <VARNAME> <VARNAMES>, where <VARNAMES>
+    are any more <VARNAME>s before the LOOP's "{". The LOOP stops early once
+    a pass leaves the variables as it found them - see _interp_until_stable().
+    watched gets a bit per variable's slot. "UNTIL-STABLE" is an extension.
+*/
+bool until_stable(Program* prog, int* watched){
+    CHECK_PROG_FOR_NULL(prog);
+
+    *watched = 0;
+
+    #ifdef EXTENSION
+    if(CURRENT_WORD != NULL && STRINGS_EQUAL(CURRENT_WORD, "UNTIL-STABLE")){
+        INCR_CURRENT_WORD;
+        if(!varname(prog)){
+            return false;
+        }
+        do{
+            *watched |= 1 << map_get_keycode(LOOK_AT_PREV_WORD);
+        } while(varname(prog));
+    }
+    #endif
+
+    return true;
+}
+
 
 /* --- INTERPRETER FUNCTIONS --- */
 
@@ -856,14 +879,14 @@ char* interp_print_variable(Program* prog, char* current_token){
         char int_to_str[MAX_STRING_LENGTH];
 
         if(arr->rows == single_dim && arr->cols == single_dim){
-            sprintf(int_to_str, "%d", arr->array[0][0]);
+            sprintf(int_to_str, "%d", nlab_array_get(arr, 0, 0));
             strcat(tostring, int_to_str);
 
         } else {
             for(unsigned int y = 0; y < arr->rows; y++){
                 for(unsigned int x = 0; x < arr->cols; x++){
 
-                    sprintf(int_to_str, "%d", arr->array[y][x]);
+                    sprintf(int_to_str, "%d", nlab_array_get(arr, y, x));
                     strcat(tostring, int_to_str);
 
                     if(x != (arr->cols - zero_offset)){
@@ -903,171 +926,1906 @@ char* interp_print_string(char* word){
     return print_stmt;
 }
 
-bool interp_set(Program* prog){
+const operator_entry UNARY_OPERATORS[unop_count] = {
+    [unop_not] = {"U-NOT", interp_u_not, 1, false, _apply_not},
+    [unop_eightcount] = {"U-EIGHTCOUNT", interp_u_eightcount, 1, false, _apply_eightcount},
+    #ifdef EXTENSION
+    [unop_trace] = {"U-TRACE", extension_u_trace, 1, false, _apply_trace},
+    [unop_transpose] = {"U-TRANSPOSE", extension_u_transpose, 1, false, _apply_transpose},
+    [unop_submatrix] = {"U-SUBMATRIX", extension_u_submatrix, 3, true, NULL},
+    [unop_lifestep] = {"U-LIFESTEP", extension_u_lifestep, 1, false, _apply_lifestep},
+    #endif
+};
+
+const operator_entry BINARY_OPERATORS[binop_count] = {
+    [binop_and] = {"B-AND", interp_b_and, 2, false, _apply_binary},
+    [binop_or] = {"B-OR", interp_b_or, 2, false, _apply_binary},
+    [binop_greater] = {"B-GREATER", interp_b_greater, 2, false, _apply_binary},
+    [binop_less] = {"B-LESS", interp_b_less, 2, false, _apply_binary},
+    [binop_add] = {"B-ADD", interp_b_add, 2, false, _apply_binary},
+    [binop_times] = {"B-TIMES", interp_b_times, 2, false, _apply_binary},
+    [binop_equals] = {"B-EQUALS", interp_b_equals, 2, false, _apply_binary},
+    #ifdef EXTENSION
+    [binop_dotproduct] = {"B-DOTPRODUCT", extension_b_dotproduct, 2, false, _apply_binary},
+    [binop_power] = {"B-POWER", extension_b_power, 2, false, _apply_power},
+    #endif
+};
 
-    char* word = prog->tokens[prog->current_token-1];
-    nlab_array* result;
+// looks word up in the operator tables - done once per token, as it's read
+token_code _intern_token(char* word){
 
-    char* variable_context = _interp_get_var_context(prog);
+    token_code code = {token_other, -1};
 
-    if(STRINGS_EQUAL(word, "U-NOT")){
-        if(!interp_u_not(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "U-EIGHTCOUNT")){
-        if(!interp_u_eightcount(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "B-AND")){
-        if(!interp_b_and(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "B-OR")){
-        if(!interp_b_or(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "B-GREATER")){
-        if(!interp_b_greater(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "B-LESS")){
-        if(!interp_b_less(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "B-ADD")){
-        if(!interp_b_add(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "B-TIMES")){
-        if(!interp_b_times(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "B-EQUALS")){
-        if(!interp_b_equals(prog)){
-            return false;
-        }
+    if(word == NULL){
+        return code;
     }
-    #ifdef EXTENSION
-    else if(STRINGS_EQUAL(word, "U-TRACE")){
-        if(!extension_u_trace(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "U-TRANSPOSE")){
-        if(!extension_u_transpose(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "U-SUBMATRIX")){
-        if(!extension_u_submatrix(prog)){
-            return false;
-        }
-    } else if(STRINGS_EQUAL(word, "B-DOTPRODUCT")){
-        if(!extension_b_dotproduct(prog)){
-            return false;
+
+    for(short i = 0; i < unop_count; i++){
+        if(UNARY_OPERATORS[i].word != NULL && STRINGS_EQUAL(word, UNARY_OPERATORS[i].word)){
+            code.kind = token_unary;
+            code.operation_type = i;
+            return code;
         }
-    } else if(STRINGS_EQUAL(word, "B-POWER")){
-        if(!extension_b_power(prog)){
-            return false;
+    }
+    for(short i = 0; i < binop_count; i++){
+        if(BINARY_OPERATORS[i].word != NULL && STRINGS_EQUAL(word, BINARY_OPERATORS[i].word)){
+            code.kind = token_binary;
+            code.operation_type = i;
+            return code;
         }
     }
-#endif
-    // add result currently on the top of stack into variable map
-    result = stack_peek(prog->polish_stack);
+    return code;
+}
 
-    if(!map_add(prog->variable_map, variable_context, result)){
-        SET_ERROR_STATE(error_interp);
+bool _interp_unary(Program* prog, unary_op operation_type){
 
-        char dummy[MAX_STRING_LENGTH];
-        dummy[0] = '\0';
-        strcat(dummy, "unable to add token ");
-        strcat(dummy, LOOK_AT_PREV_WORD);
-        strcat(dummy, " into variable map");
-        set_error_msg(prog, dummy);
+    if(operation_type >= unop_count || UNARY_OPERATORS[operation_type].kernel == NULL){
         return false;
     }
-
-    return true;
+    return UNARY_OPERATORS[operation_type].kernel(prog);
 }
 
-bool interp_pushdown_variable(Program* prog){
-    if(map_contains_key(prog->variable_map, LOOK_AT_PREV_WORD)){
-        
-        nlab_array* value = map_get_key_value(prog->variable_map,LOOK_AT_PREV_WORD);
-        if(stack_push(prog->polish_stack, value)){
-            return true;
-        } else{
-            SET_ERROR_STATE(error_interp);
-
-            char dummy[MAX_STRING_LENGTH];
-            dummy[0] = '\0';
-            strcat(dummy, "Unable to add variable ");
-            strcat(dummy, LOOK_AT_PREV_WORD);
-            strcat(dummy, "into stack");
-            set_error_msg(prog, dummy);
-            return false;
-        }
+bool _interp_binary(Program* prog, binary_op operation_type){
 
-    } else {
-        SET_ERROR_STATE(error_interp);
-        char message[MAX_STRING_LENGTH];
-        message[0] = '\0';
-        strcat(message, "illegal use of uninitialized variable 2: \'");
-        strcat(message, LOOK_AT_PREV_WORD);
-        strcat(message, "\'");
-        set_error_msg(prog, message);
+    if(operation_type >= binop_count || BINARY_OPERATORS[operation_type].kernel == NULL){
         return false;
     }
+    return BINARY_OPERATORS[operation_type].kernel(prog);
+}
 
-    return true;
+void _interp_emit_operator(Program* prog, opcode op, int operation_type){
+
+    instruction* instr;
+
+    instr = bytecode_emit(prog->bytecode, op, prog->current_token - 1);
+    instr->operand = operation_type;
 }
 
-bool _add_value_to_map(Program* prog, char* key, nlab_array* array){
-    if(map_add(prog->variable_map, key, array)){
-        // pass-by-value, so free pointer on this side
-        nlab_array_free(array);
+// grammar functions nested in a LOOP or program only compile - the outermost one runs the lot
+bool _interp_run_if_top_level(Program* prog, int first_instruction){
+    if(prog->compile_depth > 0 || prog->compile_only){
         return true;
-    } else {
-        if(array != NULL){
-            nlab_array_free(array);
+    }
+    return interp_execute(prog, first_instruction);
+}
 
-            SET_ERROR_STATE(error_interp);
+/*
+    Ends each pass of a LOOP ... UNTIL-STABLE. The variables it watches are
+    compared with the copies it kept of them at the end of the last pass, and
+    if none has changed the counter is dropped, so the op_loop_end next ends
+    the LOOP, and the iteration it stopped at is reported. A copy shares its
+    variable's buffer until the variable is written, so one the pass didn't
+    touch costs nothing to check; one it did is compared element by element,
+    up to the first that differs. The first pass after the LOOP is entered
+    has nothing to compare with.
+*/
+void _interp_until_stable(Program* prog, instruction* instr){
+
+    instruction* loop_begin;
+    nlab_array* counter;
+    nlab_array* var;
+    arena* previous_arena;
+    bool stable, last_pass;
+
+    loop_begin = bytecode_at(prog->bytecode, instr->loop);
+    if(instr->copies == NULL){
+        instr->copies = (nlab_array**) calloc(NUM_OF_VARS, sizeof(nlab_array*));
+        if(instr->copies == NULL){
+            fprintf(stderr, "Memory error - cannot calloc space for UNTIL-STABLE\n");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-            char dummy[MAX_STRING_LENGTH];
-            dummy[0] = '\0';
-            strcat(dummy, "unable to add token ");
-            strcat(dummy, LOOK_AT_PREV_WORD);
-            strcat(dummy, " into variable map");
-            set_error_msg(prog, dummy);
-            
+    // copies outlive the scratch arena
+    previous_arena = nlab_array_use_arena(NULL);
+    stable = instr->operand2 == loop_begin->operand2;
+    for(short slot = 0; slot < NUM_OF_VARS; slot++){
+        if(!(instr->operand & (1 << slot))){
+            continue;
         }
+        var = map_get_by_code(prog->variable_map, slot);
+        stable = stable && nlab_array_equal(var, instr->copies[slot]);
+        nlab_array_free(instr->copies[slot]);
+        instr->copies[slot] = nlab_array_in_arena(var, prog->scratch_arena) ? nlab_array_clone(var) : nlab_array_copy(var);
     }
-    return false;
+    nlab_array_use_arena(previous_arena);
+
+    counter = map_get_by_code(prog->variable_map, loop_begin->slot);
+    last_pass = counter == NULL || nlab_array_get(counter, 0, 0) >= loop_begin->operand;
+    if(stable && !last_pass){
+        #ifndef TESTMODE
+        fprintf(stderr, "LOOP %s stable - stopped at iteration %d of %d\n", prog->tokens[loop_begin->token],
+                nlab_array_get(counter, 0, 0), loop_begin->operand);
+        #endif
+        map_remove_by_code(prog->variable_map, loop_begin->slot);
+        last_pass = true;
+    }
+    // the LOOP is done with, so the copies needn't hold on to its variables' buffers
+    if(last_pass){
+        bytecode_free_copies(instr);
+    }
+    instr->operand2 = loop_begin->operand2;
 }
 
-bool interp_u_not(Program* prog){
+/*
+    Runs the compiled instructions from first_instruction to the end. Each one
+    points prog->current_token just past the token it was compiled from, so the
+    interp_ functions it calls report errors against the same word as before.
+*/
+bool interp_execute(Program* prog, int first_instruction){
 
-    if(prog == NULL){
-        return false;
+    bool ok;
+
+    ok = _interp_execute_instructions(prog, first_instruction);
+    // however the run ended, later allocations come from the heap again
+    nlab_array_use_arena(NULL);
+    return ok;
+}
+
+bool _interp_execute_instructions(Program* prog, int first_instruction){
+
+    int pc, end_of_program;
+
+    if(prog == NULL || prog->bytecode == NULL){
+        return false;
+    }
+
+    end_of_program = prog->current_token;
+    pc = first_instruction;
+
+    while(pc < prog->bytecode->size){
+        pc = _interp_step(prog, pc);
+        if(pc == NO_JUMP){
+            return false;
+        }
+    }
+
+    prog->current_token = end_of_program;
+    return true;
+}
+
+// runs the instruction at pc, and returns the index of the next one to run - NO_JUMP if it failed
+int _interp_step(Program* prog, int pc){
+
+    instruction* instr;
+    nlab_array* value;
+    char* temp;
+    char message[MAX_STRING_LENGTH];
+    short stack_sz_only_with_result = 1;
+
+    instr = bytecode_at(prog->bytecode, pc);
+    prog->current_token = instr->token + 1;
+    pc++;
+
+    // temporaries are bumped from the scratch arena. Anything that can outlive
+    // the SET (a variable, a loop counter) comes from the heap
+    nlab_array_use_arena(_is_expression_op(instr->op) ? prog->scratch_arena : NULL);
+
+    switch(instr->op){
+        case op_print_var:
+            temp = interp_print_variable(prog, LOOK_AT_PREV_WORD);
+            strcpy(message, temp);
+            free(temp);
+            if(prog->error_state == error_interp){
+                strcat(message, "illegal use of uninitialized variable: \'");
+                strcat(message, LOOK_AT_PREV_WORD);
+                strcat(message, "\'");
+                set_error_msg(prog, message);
+                return NO_JUMP;
+            }
+            #ifndef TESTMODE
+            printf("%s", message);
+            #endif
+            break;
+
+        case op_print_string:
+            temp = interp_print_string(LOOK_AT_PREV_WORD);
+            #ifndef TESTMODE
+            printf("%s\n", temp);
+            #endif
+            free(temp);
+            break;
+
+        case op_move:
+            // the target takes the source's value and gives its own back, so both keep a buffer
+            // of their own. If either isn't set, the value is copied as a plain push would
+            if(prog->polish_stack->size == 0 && map_swap_by_code(prog->variable_map, instr->slot, instr->operand)){
+                break;
+            }
+            // fall through
+        case op_push_var:
+            value = map_get_by_code(prog->variable_map, instr->slot);
+            // a variable holding a view is laid out the first time it's read, not every time
+            _interp_materialize_variable(value);
+            // the slow path only runs to report the error
+            if(value == NULL || !stack_push(prog->polish_stack, value)){
+                return interp_pushdown_variable(prog) ? prog->bytecode->size : NO_JUMP;
+            }
+            break;
+
+        case op_push_int:
+            stack_push(prog->polish_stack, instr->constant);
+            break;
+
+        case op_unary:
+        case op_binary:
+            // intermediate results stay on the stack - only op_set_end writes the target
+            if((instr->op == op_unary && !_interp_unary(prog, instr->operand))
+            || (instr->op == op_binary && !_interp_binary(prog, instr->operand))){
+                SET_ERROR_STATE(error_interp);
+                set_error_msg(prog, "unable to interpret expression during SET");
+                return NO_JUMP;
+            }
+            break;
+
+        case op_set_end:
+            if(prog->polish_stack->size == stack_sz_only_with_result){
+                _interp_store_result(prog, instr->slot);
+            }
+            _interp_reset_scratch(prog);
+            break;
+
+        case op_create_ones:
+            if(!interp_create_ones(prog, LOOK_AT_PREV_WORD, nlab_array_create_ones(instr->operand, instr->operand2))){
+                SET_ERROR_STATE(error_parse);
+                set_error_msg(prog, "<CREATE> ::= \"ONES\" <ROWS> <COLS> <VARNAME>");
+                return NO_JUMP;
+            }
+            break;
+
+        case op_create_read:
+            // interp_create_read() strips the quotes in place, so hand it a copy of the token
+            strcpy(message, prog->tokens[instr->operand]);
+            if(!interp_create_read(prog, LOOK_AT_PREV_WORD, NULL, message)){
+                SET_ERROR_STATE(error_io);
+
+                char errmsg[MAX_STRING_LENGTH];
+                errmsg[0] = '\0';
+                strcat(errmsg,"unable to open file ");
+                strcat(errmsg, message);
+                set_error_msg(prog, errmsg);
+                process_error_msg(prog, errmsg);
+                return NO_JUMP;
+            }
+            break;
+
+        case op_loop_begin:
+            if(map_get_by_code(prog->variable_map, instr->slot) != NULL){
+                SET_ERROR_STATE(error_interp);
+                char dummy[MAX_STRING_LENGTH];
+                dummy[0] = '\0';
+                strcat(dummy, "variale already declared: ");
+                strcat(dummy, LOOK_AT_PREV_WORD);
+                set_error_msg(prog, dummy);
+                return NO_JUMP;
+            }
+            value = nlab_array_create_1d(1);
+            map_add_by_code(prog->variable_map, instr->slot, value);
+            nlab_array_free(value);
+            instr->operand2++;
+            break;
+
+        case op_loop_end:
+            // the body may have changed the counter, so read it back from the map
+            value = map_get_by_code(prog->variable_map, instr->slot);
+            if(value == NULL || nlab_array_get(value, 0, 0) >= instr->operand){
+                map_remove_by_code(prog->variable_map, instr->slot);
+            } else{
+                nlab_array_set(value, 0, 0, nlab_array_get(value, 0, 0) + 1);
+                pc = instr->jump;
+            }
+            _interp_end_iteration(prog);
+            break;
+
+        case op_until_stable:
+            _interp_until_stable(prog, instr);
+            break;
+
+        case op_fused:
+            // if the operands don't suit it, fall through to the chain's own instructions
+            if(_interp_run_fused(prog, pc - 1, NULL)){
+                pc = instr->jump;
+            }
+            break;
+
+        case op_in_place:
+            // on to the op_set_end, which has nothing left to store
+            if(prog->polish_stack->size == 0
+            && _interp_run_fused(prog, pc - 1, map_get_by_code(prog->variable_map, instr->slot))){
+                pc = instr->jump;
+            }
+            break;
+
+        case op_registers:
+            // as for op_in_place, the op_set_end is left nothing to store
+            if(prog->polish_stack->size == 0 && _interp_run_registers(prog, pc - 1)){
+                pc = instr->jump;
+            }
+            break;
+
+        case op_release:
+            map_remove_by_code(prog->variable_map, instr->slot);
+            break;
+
+        case op_invariant:
+            // run once each time the loop is entered - the target still holds the value after that
+            if(instr->operand2 == bytecode_at(prog->bytecode, instr->loop)->operand2){
+                pc = instr->jump;
+            } else{
+                instr->operand2 = bytecode_at(prog->bytecode, instr->loop)->operand2;
+            }
+            break;
+
+        case op_cache_store:
+            stack_push(prog->cse_values, stack_peek(prog->polish_stack));
+            break;
+
+        case op_cache_load:
+            stack_push(prog->polish_stack, &prog->cse_values->a[instr->operand]);
+            break;
+
+    }
+
+    return pc;
+}
+
+// the instructions that make up a SET's expression, and so only make temporaries
+bool _is_expression_op(opcode op){
+    return op == op_push_var || op == op_push_int || op == op_unary || op == op_binary || op == op_fused
+        || op == op_cache_store || op == op_cache_load || op == op_in_place || op == op_move || op == op_registers;
+}
+
+// variables outlive the scratch arena, so a view held by one is laid out on the heap
+void _interp_materialize_variable(nlab_array* value){
+
+    arena* previous = nlab_array_use_arena(NULL);
+
+    nlab_array_materialize(value);
+    nlab_array_use_arena(previous);
+}
+
+/*
+    Stores the result on top of the stack into slot. Inside a LOOP the target
+    usually has the same shape every time round, so its buffer is reused;
+    otherwise the result is moved out of the scratch arena first, as the map
+    keeps it after the arena is reset.
+*/
+void _interp_store_result(Program* prog, short slot){
+
+    nlab_array* result;
+
+    // popped slots (and cached values) may still hold a reference to the target's buffer
+    _interp_drop_cached(prog);
+    stack_release_popped(prog->polish_stack);
+
+    result = stack_peek(prog->polish_stack);
+    if(!nlab_array_assign(map_get_by_code(prog->variable_map, slot), result)){
+        nlab_array_move_out_of(result, prog->scratch_arena);
+        map_add_by_code(prog->variable_map, slot, result);
+    }
+    stack_pop(prog->polish_stack);
+}
+
+// nothing reachable may still point into the scratch arena once it's reset
+void _interp_reset_scratch(Program* prog){
+
+    for(int i = 0; i < prog->polish_stack->size; i++){
+        nlab_array_move_out_of(&prog->polish_stack->a[i], prog->scratch_arena);
+    }
+    stack_release_popped(prog->polish_stack);
+    _interp_drop_cached(prog);
+    arena_reset(prog->scratch_arena);
+}
+
+// after each pass of a LOOP - its heap allocations are counted for the report
+void _interp_end_iteration(Program* prog){
+
+    _interp_reset_scratch(prog);
+    prog->last_iteration_heap_allocs = nlab_array_alloc_counts().heap - prog->iteration_heap_mark;
+    prog->iteration_heap_mark = nlab_array_alloc_counts().heap;
+}
+
+// cached values only live for one SET
+void _interp_drop_cached(Program* prog){
+
+    while(stack_pop(prog->cse_values) != NULL){}
+    stack_release_popped(prog->cse_values);
+}
+
+/* LOOP-INVARIANT SETS AND COMMON SUBEXPRESSIONS */
+
+// how many values instr takes off the stack, and puts back. False if that depends
+// on more than the instruction, i.e. for a U-SUBMATRIX
+bool _stack_effect(instruction* instr, int* pops, int* pushes){
+
+    const operator_entry* entry = NULL;
+
+    *pops = *pushes = 0;
+    switch(instr->op){
+        case op_push_var:
+        case op_push_int:
+        case op_cache_load:
+        case op_move:
+            *pushes = 1;
+            return true;
+        case op_unary:
+            if(instr->operand >= 0 && instr->operand < unop_count){
+                entry = &UNARY_OPERATORS[instr->operand];
+            }
+            break;
+        case op_binary:
+            if(instr->operand >= 0 && instr->operand < binop_count){
+                entry = &BINARY_OPERATORS[instr->operand];
+            }
+            break;
+        default:
+            // op_fused, op_in_place, op_registers and op_cache_store leave the stack as the instructions after them would
+            return true;
+    }
+
+    if(entry == NULL || entry->kernel == NULL || entry->needs_whole_stack){
+        return false;
+    }
+    *pops = entry->operands;
+    *pushes = 1;
+    return true;
+}
+
+// whether the expression in [first_instruction, end) leaves exactly one value on an empty stack
+bool _interp_set_is_balanced(Program* prog, int first_instruction, int end){
+
+    int depth, pops, pushes;
+
+    depth = 0;
+    for(int i = first_instruction; i < end; i++){
+        if(!_stack_effect(bytecode_at(prog->bytecode, i), &pops, &pushes) || depth < pops){
+            return false;
+        }
+        depth = depth - pops + pushes;
+    }
+    return depth == 1;
+}
+
+// the first instruction of the expression stored by the op_set_end at set_end
+int _interp_set_start(Program* prog, int set_end){
+
+    int start = set_end;
+
+    while(start > 0 && _is_expression_op(bytecode_at(prog->bytecode, start - 1)->op)){
+        start--;
+    }
+    return start;
+}
+
+// an unbalanced SET leaves values behind on the stack, which every later SET then sees
+bool _interp_sets_balanced(Program* prog, int end){
+
+    for(int i = 0; i < end; i++){
+        if(bytecode_at(prog->bytecode, i)->op == op_set_end && !_interp_set_is_balanced(prog, _interp_set_start(prog, i), i)){
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    A SET in the body of the LOOP at loop_begin whose expression reads nothing
+    the body writes, and whose target nothing else in the body writes, stores
+    the same value every time round. It still runs where it is on the first
+    pass, so output and errors come in the same order, but an op_invariant in
+    front of it skips it on later passes until the loop is next entered. Nested
+    loops are compiled (and marked) first, so a SET marked for an inner loop is
+    moved out to this one if it can be.
+*/
+void _interp_hoist_invariants(Program* prog, int loop_begin){
+
+    int writes[NUM_OF_VARS];
+    int start, end;
+    bool invariant;
+    instruction* instr;
+    instruction* marker;
+
+    end = prog->bytecode->size;
+    if(!_interp_sets_balanced(prog, end)){
+        return;
+    }
+
+    // the counter's written by op_loop_end, and inner counters by their op_loop_begin
+    memset(writes, 0, sizeof(writes));
+    writes[bytecode_at(prog->bytecode, loop_begin)->slot]++;
+    for(int i = loop_begin + 1; i < end; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if((instr->op == op_set_end || instr->op == op_create_ones || instr->op == op_create_read
+        || instr->op == op_loop_begin) && instr->slot >= 0 && instr->slot < NUM_OF_VARS){
+            writes[instr->slot]++;
+        }
+    }
+
+    for(int i = loop_begin + 1; i < end; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if(instr->op != op_set_end || instr->slot < 0 || instr->slot >= NUM_OF_VARS || writes[instr->slot] != 1){
+            continue;
+        }
+
+        start = _interp_set_start(prog, i);
+        invariant = true;
+        for(int j = start; j < i; j++){
+            instr = bytecode_at(prog->bytecode, j);
+            if(instr->op == op_push_var && (instr->slot < 0 || instr->slot >= NUM_OF_VARS || writes[instr->slot] > 0)){
+                invariant = false;
+            }
+        }
+        if(!invariant){
+            continue;
+        }
+
+        marker = bytecode_at(prog->bytecode, start - 1);
+        if(marker->op != op_invariant){
+            marker = bytecode_insert(prog->bytecode, start, op_invariant, bytecode_at(prog->bytecode, i)->token);
+            i++;
+            end++;
+        }
+        marker->loop = loop_begin;
+        marker->jump = i + 1;
+    }
+}
+
+/*
+    Value-numbers the SET expression compiled from first_instruction onwards.
+    Where a subtree with an operator in it computes the same thing as an
+    earlier one (e.g. two "$A U-EIGHTCOUNT"s), the earlier one's result is
+    kept by an op_cache_store, and the later subtree is replaced with an
+    op_cache_load of it. Largest repeats are replaced first.
+*/
+void _interp_share_subexpressions(Program* prog, int first_instruction){
+
+    int n, depth, pops, pushes, num_cached, covered_from;
+    int* ids;
+    int* canon;
+    int* cache_slot;
+    bool* replaced;
+    expression_node* nodes;
+    instruction* instr;
+
+    n = prog->bytecode->size - first_instruction;
+    if(n < 2 || !_interp_set_is_balanced(prog, first_instruction, prog->bytecode->size)){
+        return;
+    }
+
+    nodes = (expression_node*) calloc(n, sizeof(expression_node));
+    ids = (int*) calloc(n, sizeof(int));
+    canon = (int*) calloc(n, sizeof(int));
+    cache_slot = (int*) calloc(n, sizeof(int));
+    replaced = (bool*) calloc(n, sizeof(bool));
+    if(nodes == NULL || ids == NULL || canon == NULL || cache_slot == NULL || replaced == NULL){
+        fprintf(stderr, "Memory error - cannot calloc space for expression\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // build the tree (ids is the stack of nodes), giving each node the first one it's equal to
+    depth = 0;
+    for(int k = 0; k < n; k++){
+        instr = bytecode_at(prog->bytecode, first_instruction + k);
+        _stack_effect(instr, &pops, &pushes);
+        nodes[k].op = instr->op;
+        nodes[k].operand = instr->op == op_push_var ? instr->slot
+                         : instr->op == op_push_int ? nlab_array_get(instr->constant, 0, 0) : instr->operand;
+        nodes[k].lhs = nodes[k].rhs = -1;
+        nodes[k].start = k;
+        if(pops == 2){
+            nodes[k].rhs = ids[--depth];
+        }
+        if(pops >= 1){
+            nodes[k].lhs = ids[--depth];
+            nodes[k].start = nodes[nodes[k].lhs].start;
+        }
+        ids[depth++] = k;
+
+        canon[k] = k;
+        for(int j = 0; j < k; j++){
+            if(canon[j] == j && _same_expression(nodes, canon, j, k)){
+                canon[k] = j;
+                break;
+            }
+        }
+        cache_slot[k] = -1;
+    }
+
+    // outermost repeats first - anything inside one that's replaced goes with it. The
+    // first copy is never inside a replaced repeat, as that would hold an earlier copy
+    covered_from = n;
+    for(int k = n - 1; k >= 0; k--){
+        if(k < covered_from && (nodes[k].op == op_unary || nodes[k].op == op_binary) && canon[k] != k){
+            replaced[k] = true;
+            cache_slot[canon[k]] = 0;
+            covered_from = nodes[k].start;
+        }
+    }
+
+    // first copies are stored in the order they're computed, so slots are pushed in order
+    num_cached = 0;
+    for(int k = 0; k < n; k++){
+        if(cache_slot[k] == 0){
+            cache_slot[k] = num_cached++;
+        }
+    }
+
+    // edit from the back, so the positions still to be edited don't move
+    for(int k = n - 1; k >= 0; k--){
+        if(replaced[k]){
+            bytecode_remove(prog->bytecode, first_instruction + nodes[k].start + 1, k - nodes[k].start);
+            instr = bytecode_at(prog->bytecode, first_instruction + nodes[k].start);
+            nlab_array_free(instr->constant);
+            instr->constant = NULL;
+            instr->op = op_cache_load;
+            instr->slot = NO_SLOT;
+            instr->operand = cache_slot[canon[k]];
+        } else if(cache_slot[k] >= 0){
+            instr = bytecode_insert(prog->bytecode, first_instruction + k + 1, op_cache_store,
+                                    bytecode_at(prog->bytecode, first_instruction + k)->token);
+            instr->operand = cache_slot[k];
+        }
+    }
+
+    free(nodes);
+    free(ids);
+    free(canon);
+    free(cache_slot);
+    free(replaced);
+}
+
+// whether nodes a and b compute the same value - operands are compared by the first node equal to them
+bool _same_expression(expression_node* nodes, int* canon, int a, int b){
+
+    if(nodes[a].op != nodes[b].op || nodes[a].operand != nodes[b].operand){
+        return false;
+    }
+    if((nodes[a].lhs == -1) != (nodes[b].lhs == -1) || (nodes[a].rhs == -1) != (nodes[b].rhs == -1)){
+        return false;
+    }
+    if(nodes[a].lhs != -1 && canon[nodes[a].lhs] != canon[nodes[b].lhs]){
+        return false;
+    }
+    if(nodes[a].rhs != -1 && canon[nodes[a].rhs] != canon[nodes[b].rhs]){
+        return false;
+    }
+    return true;
+}
+
+/* CONSTANT FOLDING AND SHAPE CHECKING */
+
+/*
+    Replaces each operator in the SET compiled from first_instruction onwards
+    whose operands are all literals (e.g. "2 3 B-ADD") with a literal of its
+    result, computed by the same kernel the run would have used. Only
+    operators that can't fail on two scalars are folded.
+*/
+void _interp_fold_constants(Program* prog, int first_instruction){
+
+    instruction* instr;
+    instruction* lhs;
+    instruction* rhs;
+    nlab_array* folded;
+    nlab_array* widened;
+    arena* previous_arena;
+    int num_operands;
+
+    for(int i = first_instruction; i < prog->bytecode->size; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        folded = NULL;
+        num_operands = instr->op == op_unary ? 1 : 2;
+        if(i - num_operands < first_instruction){
+            continue;
+        }
+        lhs = bytecode_at(prog->bytecode, i - num_operands);
+        rhs = bytecode_at(prog->bytecode, i - 1);
+        if(lhs->op != op_push_int || rhs->op != op_push_int){
+            continue;
+        }
+
+        previous_arena = nlab_array_use_arena(prog->program_arena);
+        if(instr->op == op_unary && instr->operand == unop_not){
+            folded = _unop_not(lhs->constant);
+        } else if(instr->op == op_binary && _is_fusable(instr)){
+            folded = _binop_scalar_scalar(lhs->constant, rhs->constant, instr->operand);
+        }
+        // literals are always unpacked, as pushdown() makes them
+        if(folded != NULL){
+            widened = nlab_array_to_int(folded);
+            nlab_array_free(folded);
+            folded = widened;
+        }
+        nlab_array_use_arena(previous_arena);
+
+        if(folded == NULL){
+            continue;
+        }
+        nlab_array_free(lhs->constant);
+        lhs->constant = folded;
+        bytecode_remove(prog->bytecode, i - num_operands + 1, num_operands);
+        i = i - num_operands;
+    }
+}
+
+/*
+    Runs the compiled program on shapes alone, before it's run for real, and
+    reports the first operator whose operand shapes can't fit. It follows the
+    run exactly - a LOOP body is checked once per pass until its shapes stop
+    changing - up to the first thing whose outcome it can't know from shapes
+    (an uninitialised variable, an unreadable file, U-SUBMATRIX...), and
+    stops there, so nothing is reported that the run wouldn't reach. The
+    largest SET it saw sizes the scratch arena up front. shapes_ok means it
+    followed the run to the end.
+*/
+shape_check _interp_check_shapes(Program* prog, int first_instruction){
+
+    static_state* st;
+    shape_check result;
+
+    if(prog == NULL || prog->bytecode == NULL){
+        return shapes_unsure;
+    }
+
+    st = (static_state*) calloc(1, sizeof(static_state));
+    if(st == NULL){
+        fprintf(stderr, "Memory error - cannot calloc space for shape check\n");
+        exit(EXIT_FAILURE);
+    }
+    for(short code = 0; code < NUM_OF_VARS; code++){
+        if(map_get_by_code(prog->variable_map, code) != NULL){
+            st->is_set[code] = true;
+            st->vars[code].rows = map_get_by_code(prog->variable_map, code)->rows;
+            st->vars[code].cols = map_get_by_code(prog->variable_map, code)->cols;
+        }
+    }
+
+    result = _shapes_run(prog, st, first_instruction, prog->bytecode->size);
+    if(result != shapes_mismatch){
+        arena_reserve(prog->scratch_arena, st->max_set_bytes);
+    }
+
+    free(st);
+    return result;
+}
+
+shape_check _shapes_run(Program* prog, static_state* st, int from, int to){
+
+    shape_check result;
+    instruction* instr;
+    int pc;
+
+    pc = from;
+    while(pc < to){
+        instr = bytecode_at(prog->bytecode, pc);
+        if(instr->op == op_loop_begin){
+            result = _shapes_loop(prog, st, instr, pc + 1);
+            pc = instr->jump;
+        } else{
+            result = _shapes_step(prog, st, instr);
+            pc++;
+        }
+        if(result != shapes_ok){
+            return result;
+        }
+    }
+    return shapes_ok;
+}
+
+// the body runs from body to just before the op_loop_end, at loop_begin->jump - 1
+shape_check _shapes_loop(Program* prog, static_state* st, instruction* loop_begin, int body){
+
+    static_state* before;
+    shape_check result;
+    int passes;
+    bool stops_early;
+
+    // an existing variable can't be the counter
+    if(st->is_set[loop_begin->slot]){
+        return shapes_unsure;
+    }
+    st->is_set[loop_begin->slot] = true;
+    st->vars[loop_begin->slot] = (static_value) {1, 1, false, 0};
+
+    before = (static_state*) malloc(sizeof(static_state));
+    if(before == NULL){
+        fprintf(stderr, "Memory error - cannot malloc space for shape check\n");
+        exit(EXIT_FAILURE);
+    }
+
+    stops_early = false;
+    for(int pc = body; pc < loop_begin->jump - 1; pc++){
+        stops_early = stops_early || (bytecode_at(prog->bytecode, pc)->op == op_until_stable
+                                      && bytecode_at(prog->bytecode, pc)->loop == body - 1);
+    }
+
+    // each pass is one iteration. Once one leaves the shapes as it found them, so will the rest
+    result = shapes_ok;
+    for(passes = 1; passes <= loop_begin->operand && result == shapes_ok; passes++){
+        memcpy(before->is_set, st->is_set, sizeof(st->is_set));
+        memcpy(before->vars, st->vars, sizeof(st->vars));
+        before->stack_size = st->stack_size;
+
+        result = _shapes_run(prog, st, body, loop_begin->jump - 1);
+        if(result == shapes_ok && _static_vars_equal(before, st)){
+            break;
+        }
+        if(result == shapes_ok && passes == SHAPE_MAX_PASSES && loop_begin->operand > SHAPE_MAX_PASSES){
+            result = shapes_unsure;
+        }
+        // a LOOP ... UNTIL-STABLE can stop after its second pass, so later ones mightn't be reached
+        if(result == shapes_ok && passes == 2 && loop_begin->operand > 2 && stops_early){
+            result = shapes_unsure;
+        }
+    }
+
+    free(before);
+    st->is_set[loop_begin->slot] = false;
+    return result;
+}
+
+shape_check _shapes_step(Program* prog, static_state* st, instruction* instr){
+
+    unsigned int rows, cols;
+    static_value value;
+
+    // unbalanced SETs in nested LOOPs can leave more values than the stack holds
+    if(st->stack_size >= MAX_NUM_OF_TOKENS || st->num_cached >= MAX_NUM_OF_TOKENS){
+        return shapes_unsure;
+    }
+
+    switch(instr->op){
+        case op_move:
+            if(st->stack_size == 0 && instr->slot >= 0 && instr->slot < NUM_OF_VARS
+            && st->is_set[instr->slot] && st->is_set[instr->operand]){
+                value = st->vars[instr->slot];
+                st->vars[instr->slot] = st->vars[instr->operand];
+                st->vars[instr->operand] = value;
+                return shapes_ok;
+            }
+            // fall through
+        case op_print_var:
+        case op_push_var:
+            if(instr->slot < 0 || instr->slot >= NUM_OF_VARS || !st->is_set[instr->slot]){
+                return shapes_unsure;
+            }
+            if(instr->op != op_print_var){
+                st->stack[st->stack_size] = st->vars[instr->slot];
+                st->stack[st->stack_size++].is_literal = false;
+            }
+            return shapes_ok;
+
+        case op_push_int:
+            st->stack[st->stack_size++] = (static_value) {1, 1, true, nlab_array_get(instr->constant, 0, 0)};
+            return shapes_ok;
+
+        case op_cache_store:
+            st->cached[st->num_cached++] = st->stack[st->stack_size - 1];
+            return shapes_ok;
+
+        case op_cache_load:
+            st->stack[st->stack_size++] = st->cached[instr->operand];
+            return shapes_ok;
+
+        case op_unary:
+        case op_binary:
+            return _shapes_operator(prog, st, instr);
+
+        case op_set_end:
+            if(st->stack_size == 1){
+                st->is_set[instr->slot] = true;
+                st->vars[instr->slot] = st->stack[--st->stack_size];
+            }
+            st->num_cached = 0;
+            st->max_set_bytes = st->set_bytes > st->max_set_bytes ? st->set_bytes : st->max_set_bytes;
+            st->set_bytes = 0;
+            return shapes_ok;
+
+        case op_create_ones:
+            if(instr->operand <= 0 || instr->operand2 <= 0){
+                return shapes_unsure;
+            }
+            st->is_set[instr->slot] = true;
+            st->vars[instr->slot] = (static_value) {(unsigned int) instr->operand, (unsigned int) instr->operand2, false, 0};
+            return shapes_ok;
+
+        case op_release:
+            st->is_set[instr->slot] = false;
+            return shapes_ok;
+
+        case op_create_read:
+            if(!_arr_file_shape(prog->tokens[instr->operand], &rows, &cols)){
+                return shapes_unsure;
+            }
+            st->is_set[instr->slot] = true;
+            st->vars[instr->slot] = (static_value) {rows, cols, false, 0};
+            return shapes_ok;
+
+        default:
+            // op_print_string, and op_fused/op_invariant/op_registers - the instructions after them are followed instead
+            return shapes_ok;
+    }
+}
+
+shape_check _shapes_operator(Program* prog, static_state* st, instruction* instr){
+
+    int pops, pushes;
+    static_value* a;
+    static_value* b;
+    static_value result;
+    bool a_scalar, b_scalar;
+
+    if(!_stack_effect(instr, &pops, &pushes) || st->stack_size < pops){
+        return shapes_unsure;
+    }
+    st->stack_size = st->stack_size - pops;
+    a = &st->stack[st->stack_size];
+    b = &st->stack[st->stack_size + 1];
+    result = (static_value) {a->rows, a->cols, false, 0};
+    a_scalar = a->rows == 1 && a->cols == 1;
+    b_scalar = pops == 2 && b->rows == 1 && b->cols == 1;
+
+    if(instr->op == op_unary){
+        switch(instr->operand){
+            case unop_trace:
+                if(a->rows != a->cols){
+                    return _shapes_mismatch(prog, instr, "needs a square array", a, NULL);
+                }
+                result.rows = result.cols = 1;
+                break;
+            case unop_transpose:
+                result.rows = a->cols;
+                result.cols = a->rows;
+                break;
+            default:
+                break;
+        }
+    } else if(instr->operand == binop_dotproduct){
+        if(a_scalar || b_scalar || a->cols != b->rows){
+            return _shapes_mismatch(prog, instr, "can't multiply", a, b);
+        }
+        result.cols = b->cols;
+    } else if(instr->operand == binop_power){
+        if(!b_scalar){
+            return _shapes_mismatch(prog, instr, "needs a 1x1 power, not", b, NULL);
+        }
+        if(a->rows != a->cols){
+            return _shapes_mismatch(prog, instr, "needs a square array", a, NULL);
+        }
+        // a negative power fails on its value, which only the run reports
+        if(!b->is_literal || b->literal < 0){
+            return shapes_unsure;
+        }
+    } else if(!a_scalar && !b_scalar && (a->rows != b->rows || a->cols != b->cols)){
+        return _shapes_mismatch(prog, instr, "can't combine", a, b);
+    } else if(a_scalar){
+        result.rows = b->rows;
+        result.cols = b->cols;
+    }
+
+    st->stack[st->stack_size++] = result;
+    st->set_bytes += nlab_array_arena_bytes(result.rows, result.cols);
+    return shapes_ok;
+}
+
+shape_check _shapes_mismatch(Program* prog, instruction* instr, const char* why, static_value* a, static_value* b){
+
+    char message[MAX_LEN_OF_ERROR_MESSAGE];
+
+    if(b == NULL){
+        snprintf(message, sizeof(message), "%s %s %ux%u", prog->tokens[instr->token], why, a->rows, a->cols);
+    } else{
+        snprintf(message, sizeof(message), "%s %s %ux%u and %ux%u arrays",
+                 prog->tokens[instr->token], why, a->rows, a->cols, b->rows, b->cols);
+    }
+    SET_ERROR_STATE(error_interp);
+    set_error_msg(prog, message);
+    return shapes_mismatch;
+}
+
+bool _static_vars_equal(static_state* a, static_state* b){
+
+    if(a->stack_size != b->stack_size){
+        return false;
+    }
+    for(int i = 0; i < NUM_OF_VARS; i++){
+        if(a->is_set[i] != b->is_set[i]
+        || (a->is_set[i] && (a->vars[i].rows != b->vars[i].rows || a->vars[i].cols != b->vars[i].cols))){
+            return false;
+        }
+    }
+    return true;
+}
+
+// the shape READ would give the file named by token - false wherever interp_create_read() would fail
+bool _arr_file_shape(char* token, unsigned int* rows, unsigned int* cols){
+
+    char filename[MAX_TOKEN_SIZE];
+    FILE* fp;
+    int element;
+    unsigned int num_elements;
+    bool ok;
+
+    strcpy(filename, token);
+    if(!_format_filename(filename) || !_is_correct_file_extention(filename, ".arr")){
+        return false;
+    }
+    fp = fopen(filename, "rt");
+    if(fp == NULL){
+        return false;
+    }
+
+    ok = fscanf(fp, "%u %u\n", rows, cols) == 2 && *rows > 0 && *cols > 0;
+    num_elements = 0;
+    while(ok && fscanf(fp, "%d", &element) == 1){
+        ok = element >= 0 && num_elements < *rows * *cols;
+        num_elements++;
+    }
+    fclose(fp);
+    return ok && num_elements == *rows * *cols;
+}
+
+/* MOVES BETWEEN VARIABLES */
+
+/*
+    A "SET $X := $Y ;" whose source is overwritten (or never read again)
+    before anything next reads it needn't leave $Y's value in $Y. Its push is
+    replaced by an op_move, which swaps the two variables' values instead of
+    copying one into the other, e.g. the "SET $A := $E ;" at the end of a Life
+    generation hands $E the old $A's buffer to overwrite next time round.
+    Only run once the whole program is compiled, as that's when every later
+    read is known.
+*/
+void _interp_move_dead_copies(Program* prog, int first_instruction){
+
+    instruction* push;
+    instruction* set_end;
+
+    // an unbalanced SET stores nothing, so wouldn't overwrite its target
+    if(!_interp_sets_balanced(prog, prog->bytecode->size)){
+        return;
+    }
+
+    for(int i = first_instruction + 1; i < prog->bytecode->size; i++){
+        set_end = bytecode_at(prog->bytecode, i);
+        push = bytecode_at(prog->bytecode, i - 1);
+        if(set_end->op != op_set_end || push->op != op_push_var || _interp_set_start(prog, i) != i - 1
+        || push->slot == set_end->slot || push->slot < 0 || push->slot >= NUM_OF_VARS
+        || set_end->slot < 0 || set_end->slot >= NUM_OF_VARS){
+            continue;
+        }
+        if(_interp_is_dead_after(prog, push->slot, i + 1)){
+            push->op = op_move;
+            push->operand = set_end->slot;
+        }
+    }
+}
+
+/*
+    Frees each variable as soon as nothing can read it again, rather than when
+    the program ends: an op_release follows the statement that last uses it on
+    every path through the bytecode - or that sets it, if it's never read. Its
+    buffer goes back to the pool for the next array of that size, so a
+    program's peak memory is that of the variables live at the same time,
+    e.g. a Life LOOP's neighbour counts are gone before the next board is
+    made. A variable every pass of a LOOP needs is released after the LOOP
+    instead. Only run once the whole program is compiled.
+*/
+void _interp_release_dead_variables(Program* prog, int first_instruction){
+
+    bool used[NUM_OF_VARS];
+    instruction* instr;
+    int start, token;
+
+    // an unbalanced SET stores nothing, so wouldn't overwrite its target
+    if(!_interp_sets_balanced(prog, prog->bytecode->size)){
+        return;
+    }
+
+    for(int i = first_instruction; i < prog->bytecode->size; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if(instr->op == op_set_end){
+            start = _interp_set_start(prog, i);
+        } else if(instr->op == op_print_var || instr->op == op_create_ones || instr->op == op_create_read){
+            start = i;
+        } else if(instr->op == op_loop_end){
+            // the body, which might have needed a variable on every pass but not after
+            start = instr->jump;
+        } else{
+            continue;
+        }
+
+        token = instr->token;
+        _statement_uses(prog, start, i + 1, used);
+        if(instr->op == op_loop_end){
+            // counters are removed by their own LOOP, and a variable dead at the top of the body
+            // was already released after its last use in it
+            for(int j = start - 1; j < i; j++){
+                if(bytecode_at(prog->bytecode, j)->op == op_loop_begin){
+                    used[bytecode_at(prog->bytecode, j)->slot] = false;
+                }
+            }
+            for(short slot = 0; slot < NUM_OF_VARS; slot++){
+                used[slot] = used[slot] && !_interp_is_dead_after(prog, slot, start);
+            }
+        }
+        for(short slot = 0; slot < NUM_OF_VARS; slot++){
+            if(used[slot] && _interp_is_dead_after(prog, slot, i + 1)){
+                instr = bytecode_insert(prog->bytecode, i + 1, op_release, token);
+                instr->slot = slot;
+                i++;
+            }
+        }
+    }
+}
+
+/*
+    Drops each SET whose value nothing reads: its target is written again, or
+    the program ends, before any path through the bytecode reads it - e.g. a
+    scratch variable left over from generated code. An op_invariant in front
+    goes with it, and jumps past it land on what follows. Dropping one can
+    leave the SET that fed it unread too, so it goes round until nothing more
+    is dropped. Only run once the whole program is compiled.
+*/
+void _interp_remove_dead_stores(Program* prog, int first_instruction){
+
+    instruction* instr;
+    int start;
+    bool removed;
+
+    // an unbalanced SET stores nothing, so wouldn't overwrite its target
+    if(!_interp_sets_balanced(prog, prog->bytecode->size)){
+        return;
+    }
+
+    do{
+        removed = false;
+        // from the end, so a SET read only by a later dead one is dropped in the same round
+        for(int i = prog->bytecode->size - 1; i >= first_instruction; i--){
+            instr = bytecode_at(prog->bytecode, i);
+            if(instr->op != op_set_end || instr->slot < 0 || instr->slot >= NUM_OF_VARS
+            || !_interp_is_dead_after(prog, instr->slot, i + 1)){
+                continue;
+            }
+            start = _interp_set_start(prog, i);
+            if(start > first_instruction && bytecode_at(prog->bytecode, start - 1)->op == op_invariant){
+                start--;
+            }
+            bytecode_remove(prog->bytecode, start, i + 1 - start);
+            i = start;
+            removed = true;
+        }
+    } while(removed);
+}
+
+// the variables the instructions in [start, end) read or write
+void _statement_uses(Program* prog, int start, int end, bool* used){
+
+    instruction* instr;
+    short slot;
+
+    memset(used, 0, sizeof(bool) * NUM_OF_VARS);
+    for(int i = start; i < end; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        slot = instr->slot;
+        if(instr->op == op_move && instr->operand >= 0 && instr->operand < NUM_OF_VARS){
+            used[instr->operand] = true;
+        }
+        for(short watched = 0; instr->op == op_until_stable && watched < NUM_OF_VARS; watched++){
+            used[watched] = used[watched] || _reads_variable(instr, watched);
+        }
+        if((instr->op == op_push_var || instr->op == op_move || instr->op == op_set_end || instr->op == op_print_var
+         || instr->op == op_create_ones || instr->op == op_create_read) && slot >= 0 && slot < NUM_OF_VARS){
+            used[slot] = true;
+        }
+    }
+}
+
+/*
+    Whether no path through the bytecode from instruction from onwards reads
+    slot before writing it. A LOOP body runs at least once, and may run
+    again from its op_loop_end; an op_invariant's SET may be skipped.
+*/
+bool _interp_is_dead_after(Program* prog, short slot, int from){
+
+    bool* visited;
+    int* pending;
+    int num_pending, pc, size;
+    bool dead;
+    instruction* instr;
+
+    size = prog->bytecode->size;
+    visited = (bool*) calloc(size + 1, sizeof(bool));
+    // each instruction is queued at most once per way into it, and has at most two
+    pending = (int*) malloc(sizeof(int) * (2 * size + 2));
+    if(visited == NULL || pending == NULL){
+        fprintf(stderr, "Memory error - cannot malloc space for liveness\n");
+        exit(EXIT_FAILURE);
+    }
+
+    dead = true;
+    num_pending = 0;
+    pending[num_pending++] = from;
+    while(dead && num_pending > 0){
+        pc = pending[--num_pending];
+        if(pc >= size || visited[pc]){
+            continue;
+        }
+        visited[pc] = true;
+        instr = bytecode_at(prog->bytecode, pc);
+
+        if(_reads_variable(instr, slot)){
+            dead = false;
+        } else if((instr->op == op_set_end || instr->op == op_create_ones || instr->op == op_create_read)
+               && instr->slot == slot){
+            continue;
+        }
+
+        pending[num_pending++] = pc + 1;
+        if(instr->op == op_loop_end || instr->op == op_invariant){
+            pending[num_pending++] = instr->jump;
+        }
+    }
+
+    free(visited);
+    free(pending);
+    return dead;
+}
+
+// LOOP reads its counter's slot too - it mustn't already be set
+bool _reads_variable(instruction* instr, short slot){
+
+    switch(instr->op){
+        case op_push_var:
+        case op_move:
+        case op_loop_begin:
+        case op_loop_end:
+        case op_print_var:
+            return instr->slot == slot;
+        case op_until_stable:
+            return (instr->operand & (1 << slot)) != 0;
+        default:
+            return false;
+    }
+}
+
+/* FUSED ELEMENTWISE EXPRESSIONS */
+
+bool _is_fusable(instruction* instr){
+
+    if(instr->op == op_push_var || instr->op == op_push_int){
+        return true;
+    } else if(instr->op == op_unary){
+        return instr->operand == unop_not;
+    } else if(instr->op == op_binary){
+        return instr->operand != binop_dotproduct && instr->operand != binop_power;
+    }
+    return false;
+}
+
+/*
+    Finds runs of elementwise instructions in the SET compiled from
+    first_instruction onwards that reduce to a single value, and puts an
+    op_fused in front of each. At run time that evaluates the whole run a
+    block of elements at a time, rather than building an array per operator.
+    A run may start by taking values already on the stack, e.g. the
+    "3 B-EQUALS" after a U-EIGHTCOUNT.
+*/
+void _interp_fuse_elementwise(Program* prog, int first_instruction){
+
+    int i, j, end, depth, borrowed, max_depth, num_ops, best_end, best_borrowed;
+    instruction* instr;
+
+    i = first_instruction;
+    end = prog->bytecode->size;
+
+    while(i < end){
+        best_end = -1;
+        best_borrowed = depth = borrowed = max_depth = num_ops = 0;
+
+        for(j = i; j < end && _is_fusable(bytecode_at(prog->bytecode, j)); j++){
+            instr = bytecode_at(prog->bytecode, j);
+
+            if(instr->op == op_push_var || instr->op == op_push_int){
+                depth++;
+            } else{
+                // operands missing from the run come off the stack beneath it
+                while(depth < (instr->op == op_unary ? 1 : 2)){
+                    borrowed++;
+                    depth++;
+                }
+                depth = depth - (instr->op == op_unary ? 0 : 1);
+                num_ops++;
+            }
+            max_depth = depth > max_depth ? depth : max_depth;
+
+            if(max_depth > FUSED_MAX_DEPTH){
+                break;
+            }
+            // one operator is already a single pass, so only chains are worth fusing
+            if(instr->op != op_push_var && instr->op != op_push_int && depth == 1 && num_ops > 1){
+                best_end = j + 1;
+                best_borrowed = borrowed;
+            }
+        }
+
+        if(best_end == -1){
+            i++;
+            continue;
+        }
+
+        instr = bytecode_insert(prog->bytecode, i, op_fused, bytecode_at(prog->bytecode, best_end - 1)->token);
+        instr->operand = best_borrowed;
+        instr->jump = best_end + 1;
+        end++;
+        i = best_end + 1;
+    }
+}
+
+/*
+    Puts an op_in_place in front of a SET whose whole expression is one
+    elementwise chain reading its own target and giving an int result, e.g.
+    "SET $A := $A 2 B-ADD ;". At run time that writes the chain's result
+    straight into the target's buffer, rather than making a new array and
+    copying it back. Each block of the target is read before it's written, so
+    the target may be read any number of times in the chain.
+*/
+void _interp_update_in_place(Program* prog, int first_instruction, short slot){
+
+    int start, end, depth, max_depth, num_ops;
+    bool reads_target;
+    instruction* instr;
+
+    end = prog->bytecode->size;
+    start = first_instruction;
+    if(start < end && bytecode_at(prog->bytecode, start)->op == op_fused){
+        instr = bytecode_at(prog->bytecode, start);
+        if(instr->operand != 0 || instr->jump != end){
+            return;
+        }
+        start++;
+    }
+
+    depth = max_depth = num_ops = 0;
+    reads_target = false;
+    for(int i = start; i < end; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if(!_is_fusable(instr)){
+            return;
+        }
+        if(instr->op == op_push_var || instr->op == op_push_int){
+            reads_target = reads_target || (instr->op == op_push_var && instr->slot == slot);
+            depth++;
+        } else if(depth < (instr->op == op_unary ? 1 : 2)){
+            // values from before the SET would be on the stack too
+            return;
+        } else{
+            depth = depth - (instr->op == op_unary ? 0 : 1);
+            num_ops++;
+        }
+        max_depth = depth > max_depth ? depth : max_depth;
+    }
+
+    // the logical operators' results are bool arrays, which can't go in an int buffer
+    instr = bytecode_at(prog->bytecode, end - 1);
+    if(!reads_target || depth != 1 || num_ops == 0 || max_depth > FUSED_MAX_DEPTH
+    || instr->op != op_binary || (instr->operand != binop_add && instr->operand != binop_times)){
+        return;
+    }
+
+    instr = bytecode_insert(prog->bytecode, first_instruction, op_in_place, instr->token);
+    instr->slot = slot;
+    // the op_set_end about to be emitted
+    instr->jump = end + 1;
+}
+
+/*
+    Runs the chain after fused_instruction in one pass over the result. Scalar
+    operands are broadcast as in _do_binary_operation(), including computing
+    vector OP scalar whichever way round they were pushed. Returns false, having
+    changed nothing, if there's no array operand or their shapes differ - the
+    chain's own instructions then run (and report any error). Given a dest
+    (for an op_in_place), the result is written into it instead of pushed, as
+    long as it's an int array of the result's shape.
+*/
+bool _interp_run_fused(Program* prog, int fused_instruction, nlab_array* dest){
+
+    instruction* fused;
+    instruction* instr;
+    nlab_array* sources[FUSED_MAX_DEPTH + MAX_NUM_OF_TOKENS];
+    nlab_array* shape;
+    nlab_array* result;
+    int values[FUSED_MAX_DEPTH][FUSED_BLOCK];
+    int scalars[FUSED_MAX_DEPTH];
+    bool is_vector[FUSED_MAX_DEPTH];
+    int num_sources, top, n, lhs, rhs, last_op;
+    bool is_bool;
+    uint64_t word;
+
+    if(bytecode_at(prog->bytecode, fused_instruction)->op == op_in_place){
+        if(dest == NULL){
+            return false;
+        }
+        // its chain may have been fused as well
+        if(bytecode_at(prog->bytecode, fused_instruction + 1)->op == op_fused){
+            fused_instruction++;
+        }
+    }
+    fused = bytecode_at(prog->bytecode, fused_instruction);
+    num_sources = 0;
+    shape = NULL;
+
+    if(prog->polish_stack->size < fused->operand){
+        return false;
+    }
+
+    // values already on the stack, then each push in the order it happens
+    for(int i = prog->polish_stack->size - fused->operand; i < prog->polish_stack->size; i++){
+        sources[num_sources++] = &prog->polish_stack->a[i];
+    }
+    for(int pc = fused_instruction + 1; pc < fused->jump; pc++){
+        instr = bytecode_at(prog->bytecode, pc);
+        if(instr->op == op_push_var){
+            sources[num_sources] = map_get_by_code(prog->variable_map, instr->slot);
+            if(sources[num_sources] == NULL){
+                return false;
+            }
+            num_sources++;
+        } else if(instr->op == op_push_int){
+            sources[num_sources++] = instr->constant;
+        }
+    }
+
+    for(int i = 0; i < num_sources; i++){
+        _interp_materialize_variable(sources[i]);
+        if(sources[i]->rows != 1 || sources[i]->cols != 1){
+            if(shape != NULL && (shape->rows != sources[i]->rows || shape->cols != sources[i]->cols)){
+                return false;
+            }
+            shape = sources[i];
+        }
+    }
+
+    last_op = bytecode_at(prog->bytecode, fused->jump - 1)->operand;
+    is_bool = bytecode_at(prog->bytecode, fused->jump - 1)->op == op_unary
+           || (last_op != binop_add && last_op != binop_times);
+
+    if(dest != NULL){
+        // an all-scalar chain can update a 1x1 target
+        shape = shape == NULL ? dest : shape;
+        if(is_bool || dest->kind != nlab_int || dest->rows != shape->rows || dest->cols != shape->cols){
+            return false;
+        }
+        // a buffer shared with another variable is copied first - on the heap, as dest outlives the SET
+        arena* previous = nlab_array_use_arena(NULL);
+        nlab_array_make_writable(dest);
+        nlab_array_use_arena(previous);
+    }
+
+    if(shape == NULL){
+        return false;
+    }
+
+    if(dest != NULL){
+        result = dest;
+    } else if(is_bool){
+        result = nlab_array_create_bool(shape->rows, shape->cols);
+    } else{
+        result = nlab_array_create_uninit(shape->rows, shape->cols);
+    }
+
+    for(unsigned int y = 0; y < shape->rows; y++){
+        for(unsigned int first_col = 0; first_col < shape->cols; first_col += FUSED_BLOCK){
+            n = (shape->cols - first_col) < FUSED_BLOCK ? (int) (shape->cols - first_col) : FUSED_BLOCK;
+            top = -1;
+            num_sources = 0;
+
+            for(int i = 0; i < fused->operand; i++){
+                top++;
+                is_vector[top] = sources[num_sources]->rows != 1 || sources[num_sources]->cols != 1;
+                if(is_vector[top]){
+                    _fused_load(sources[num_sources], y, first_col, n, values[top]);
+                } else{
+                    scalars[top] = nlab_array_get(sources[num_sources], 0, 0);
+                }
+                num_sources++;
+            }
+
+            for(int pc = fused_instruction + 1; pc < fused->jump; pc++){
+                instr = bytecode_at(prog->bytecode, pc);
+
+                if(instr->op == op_push_var || instr->op == op_push_int){
+                    top++;
+                    is_vector[top] = sources[num_sources]->rows != 1 || sources[num_sources]->cols != 1;
+                    if(is_vector[top]){
+                        _fused_load(sources[num_sources], y, first_col, n, values[top]);
+                    } else{
+                        scalars[top] = nlab_array_get(sources[num_sources], 0, 0);
+                    }
+                    num_sources++;
+
+                } else if(instr->op == op_unary){
+                    if(is_vector[top]){
+                        for(int i = 0; i < n; i++){
+                            values[top][i] = values[top][i] == false;
+                        }
+                    } else{
+                        scalars[top] = scalars[top] == false;
+                    }
+
+                } else{
+                    lhs = top - 1;
+                    rhs = top;
+                    if(is_vector[lhs] && is_vector[rhs]){
+                        _fused_binop(instr->operand, values[lhs], values[lhs], values[rhs], n);
+                    } else if(is_vector[lhs]){
+                        _fused_binop_scalar(instr->operand, values[lhs], values[lhs], scalars[rhs], n);
+                    } else if(is_vector[rhs]){
+                        _fused_binop_scalar(instr->operand, values[lhs], values[rhs], scalars[lhs], n);
+                        is_vector[lhs] = true;
+                    } else{
+                        _fused_binop_scalar(instr->operand, &scalars[lhs], &scalars[lhs], scalars[rhs], 1);
+                    }
+                    top--;
+                }
+            }
+
+            if(!is_vector[0]){
+                for(int i = 0; i < n; i++){
+                    values[0][i] = scalars[0];
+                }
+            }
+
+            if(is_bool){
+                // FUSED_BLOCK is a whole number of words, so blocks start on a word
+                for(int first = 0; first < n; first += NLAB_BITS_PER_WORD){
+                    word = 0;
+                    for(int x = first; x < n && x < first + NLAB_BITS_PER_WORD; x++){
+                        word |= (uint64_t) (values[0][x] != 0) << (x - first);
+                    }
+                    NLAB_BITS_ROW(result, y)[(first_col + first) / NLAB_BITS_PER_WORD] = word;
+                }
+            } else{
+                memcpy(NLAB_ROW(result, y) + first_col, values[0], sizeof(int) * n);
+            }
+        }
+
+        if(!is_bool){
+            memset(NLAB_ROW(result, y) + shape->cols, 0, sizeof(int) * (result->stride - shape->cols));
+        }
+    }
+
+    if(dest != NULL){
+        return true;
+    }
+
+    for(int i = 0; i < fused->operand; i++){
+        stack_pop(prog->polish_stack);
+    }
+    stack_push(prog->polish_stack, result);
+    // pass-by-value
+    nlab_array_free(result);
+    return true;
+}
+
+/* REGISTERS */
+
+/*
+    Puts an op_registers in front of a SET that the fused and in-place paths
+    leave to the stack, e.g. "SET $B := $A U-EIGHTCOUNT ;". Each value the
+    expression makes is given the register numbered by the depth it would
+    have on the polish stack, so the SET needs as many registers as its
+    deepest point. At run time a push names the variable or literal where it
+    is, rather than copying it onto the stack, each operator reads its
+    operands' registers and leaves its result in the first of them, and the
+    last result is stored straight into the target.
+*/
+void _interp_assign_registers(Program* prog, int first_instruction){
+
+    int end, depth, max_depth, num_ops, pops, pushes;
+    const operator_entry* entry;
+    instruction* instr;
+
+    end = prog->bytecode->size;
+    depth = max_depth = num_ops = 0;
+
+    for(int i = first_instruction; i < end; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if(instr->op == op_push_var || instr->op == op_push_int){
+            depth++;
+        } else if(instr->op == op_unary || instr->op == op_binary){
+            // values from before the SET would be on the stack too
+            if(!_stack_effect(instr, &pops, &pushes) || depth < pops){
+                return;
+            }
+            entry = instr->op == op_unary ? &UNARY_OPERATORS[instr->operand] : &BINARY_OPERATORS[instr->operand];
+            if(entry->apply == NULL){
+                return;
+            }
+            depth = depth - pops + pushes;
+            num_ops++;
+        } else{
+            // fused chains, cached values and moves have paths of their own
+            return;
+        }
+        max_depth = depth > max_depth ? depth : max_depth;
+    }
+
+    if(depth != 1 || num_ops == 0){
+        return;
+    }
+
+    _interp_reserve_registers(prog, max_depth);
+    instr = bytecode_insert(prog->bytecode, first_instruction, op_registers, bytecode_at(prog->bytecode, end - 1)->token);
+    instr->operand = max_depth;
+    // the op_set_end about to be emitted
+    instr->jump = end + 1;
+}
+
+// the register file is sized as SETs are compiled, so running one never allocates it
+void _interp_reserve_registers(Program* prog, int count){
+
+    if(count <= prog->num_registers){
+        return;
+    }
+
+    prog->registers = (nlab_register*) realloc(prog->registers, sizeof(nlab_register) * count);
+    if(prog->registers == NULL){
+        fprintf(stderr, "Memory error - cannot realloc space for registers\n");
+        exit(EXIT_FAILURE);
+    }
+    prog->num_registers = count;
+}
+
+/*
+    Runs the SET after the op_registers at header, and stores its result.
+    Returns false, having changed nothing but laying out a variable that
+    holds a view (as a push would), if a variable isn't set or an operator
+    can't be applied - the SET's own instructions then run, and report it.
+*/
+bool _interp_run_registers(Program* prog, int header){
+
+    instruction* registers_instr;
+    instruction* instr;
+    nlab_register* registers;
+    nlab_array* operands[OPERATOR_MAX_OPERANDS];
+    nlab_array* result;
+    arena* previous_arena;
+    const operator_entry* entry;
+    int top, first;
+    short slot;
+
+    registers_instr = bytecode_at(prog->bytecode, header);
+    registers = prog->registers;
+    top = 0;
+
+    for(int pc = header + 1; pc < registers_instr->jump; pc++){
+        instr = bytecode_at(prog->bytecode, pc);
+
+        if(instr->op == op_push_var){
+            registers[top].value = map_get_by_code(prog->variable_map, instr->slot);
+            if(registers[top].value == NULL){
+                _release_registers(registers, top);
+                return false;
+            }
+            _interp_materialize_variable(registers[top].value);
+            registers[top++].owned = false;
+
+        } else if(instr->op == op_push_int){
+            registers[top].value = instr->constant;
+            registers[top++].owned = false;
+
+        } else{
+            entry = instr->op == op_unary ? &UNARY_OPERATORS[instr->operand] : &BINARY_OPERATORS[instr->operand];
+            first = top - entry->operands;
+            for(int i = 0; i < entry->operands; i++){
+                operands[i] = registers[first + i].value;
+            }
+            result = entry->apply(operands, instr->operand);
+            if(result == NULL){
+                _release_registers(registers, top);
+                return false;
+            }
+            _release_registers(&registers[first], entry->operands);
+            registers[first].value = result;
+            registers[first].owned = true;
+            top = first + 1;
+        }
+    }
+
+    // popped slots may still hold a reference to the target's buffer
+    stack_release_popped(prog->polish_stack);
+    _interp_drop_cached(prog);
+
+    // the target outlives the SET, so is stored as op_set_end would store it - from the heap
+    previous_arena = nlab_array_use_arena(NULL);
+    slot = bytecode_at(prog->bytecode, registers_instr->jump)->slot;
+    result = registers[0].value;
+    if(!nlab_array_assign(map_get_by_code(prog->variable_map, slot), result)){
+        nlab_array_move_out_of(result, prog->scratch_arena);
+        map_add_by_code(prog->variable_map, slot, result);
+    }
+    _release_registers(registers, 1);
+    nlab_array_use_arena(previous_arena);
+    return true;
+}
+
+// variables and literals are only borrowed
+void _release_registers(nlab_register* registers, int count){
+
+    for(int i = 0; i < count; i++){
+        if(registers[i].owned){
+            nlab_array_free(registers[i].value);
+        }
+        registers[i].value = NULL;
+        registers[i].owned = false;
+    }
+}
+
+// n elements of row y, from first_col, widened to ints
+void _fused_load(nlab_array* source, unsigned int y, unsigned int first_col, int n, int* out){
+
+    uint64_t* bits;
+
+    if(source->kind == nlab_bool){
+        bits = NLAB_BITS_ROW(source, y);
+        for(int i = 0; i < n; i++){
+            out[i] = (int) ((bits[(first_col + i) / NLAB_BITS_PER_WORD] >> ((first_col + i) % NLAB_BITS_PER_WORD)) & 1u);
+        }
+    } else{
+        memcpy(out, NLAB_ROW(source, y) + first_col, sizeof(int) * n);
+    }
+}
+
+// B-ADD and B-TIMES wrap, as unfused SETs' do - worked in unsigned ints, so it's defined
+void _fused_binop(binary_op operation_type, int* out, int* lhs, int* rhs, int n){
+
+    switch(operation_type){
+        case binop_and:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] && rhs[i]; }
+            break;
+        case binop_or:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] || rhs[i]; }
+            break;
+        case binop_greater:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] > rhs[i]; }
+            break;
+        case binop_less:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] < rhs[i]; }
+            break;
+        case binop_equals:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] == rhs[i]; }
+            break;
+        case binop_add:
+            for(int i = 0; i < n; i++){ out[i] = (int) ((unsigned int) lhs[i] + (unsigned int) rhs[i]); }
+            break;
+        case binop_times:
+            for(int i = 0; i < n; i++){ out[i] = (int) ((unsigned int) lhs[i] * (unsigned int) rhs[i]); }
+            break;
+        default:
+            break;
+    }
+}
+
+void _fused_binop_scalar(binary_op operation_type, int* out, int* lhs, int value, int n){
+
+    switch(operation_type){
+        case binop_and:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] && value; }
+            break;
+        case binop_or:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] || value; }
+            break;
+        case binop_greater:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] > value; }
+            break;
+        case binop_less:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] < value; }
+            break;
+        case binop_equals:
+            for(int i = 0; i < n; i++){ out[i] = lhs[i] == value; }
+            break;
+        case binop_add:
+            for(int i = 0; i < n; i++){ out[i] = (int) ((unsigned int) lhs[i] + (unsigned int) value); }
+            break;
+        case binop_times:
+            for(int i = 0; i < n; i++){ out[i] = (int) ((unsigned int) lhs[i] * (unsigned int) value); }
+            break;
+        default:
+            break;
+    }
+}
+
+bool interp_pushdown_variable(Program* prog){
+    if(map_contains_key(prog->variable_map, LOOK_AT_PREV_WORD)){
+        
+        nlab_array* value = map_get_key_value(prog->variable_map,LOOK_AT_PREV_WORD);
+        if(stack_push(prog->polish_stack, value)){
+            return true;
+        } else{
+            SET_ERROR_STATE(error_interp);
+
+            char dummy[MAX_STRING_LENGTH];
+            dummy[0] = '\0';
+            strcat(dummy, "Unable to add variable ");
+            strcat(dummy, LOOK_AT_PREV_WORD);
+            strcat(dummy, "into stack");
+            set_error_msg(prog, dummy);
+            return false;
+        }
+
+    } else {
+        SET_ERROR_STATE(error_interp);
+        char message[MAX_STRING_LENGTH];
+        message[0] = '\0';
+        strcat(message, "illegal use of uninitialized variable 2: \'");
+        strcat(message, LOOK_AT_PREV_WORD);
+        strcat(message, "\'");
+        set_error_msg(prog, message);
+        return false;
+    }
+
+    return true;
+}
+
+bool _add_value_to_map(Program* prog, char* key, nlab_array* array){
+    if(map_add(prog->variable_map, key, array)){
+        // pass-by-value, so free pointer on this side
+        nlab_array_free(array);
+        return true;
+    } else {
+        if(array != NULL){
+            nlab_array_free(array);
+
+            SET_ERROR_STATE(error_interp);
+
+            char dummy[MAX_STRING_LENGTH];
+            dummy[0] = '\0';
+            strcat(dummy, "unable to add token ");
+            strcat(dummy, LOOK_AT_PREV_WORD);
+            strcat(dummy, " into variable map");
+            set_error_msg(prog, dummy);
+            
+        }
+    }
+    return false;
+}
+
+bool interp_u_not(Program* prog){
+
+    if(prog == NULL){
+        return false;
     }
 
     if(prog->polish_stack->size > 0){
         nlab_array* pop = stack_pop(prog->polish_stack);
+        nlab_array_materialize(pop);
 
-        nlab_array* result = nlab_array_copy(pop);
+        nlab_array* result = _unop_not(pop);
 
         if(result == NULL){
             return false;
         }
 
-        for(int y = 0; y < (int) pop->rows; y++){
-            for(int x = 0; x < (int) pop->cols; x++){
-                if(pop->array[y][x] == false){
-                    result->array[y][x] = true;
-                } else {
-                    result->array[y][x] = false;
-                }
-            }
-        }
-
         stack_push(prog->polish_stack, result);
         // pass-by-value, so free result on this side as a copy is passed to stack
         nlab_array_free(result);
@@ -1077,6 +2835,23 @@ bool interp_u_not(Program* prog){
     return false;
 }
 
+// the stack kernels lay their operand out in place. Registers may be borrowed, so a
+// laid-out copy is made instead - NULL if the operand is fine as it is
+nlab_array* _laid_out(nlab_array* operand){
+    return nlab_array_is_view(operand) ? nlab_array_to_int(operand) : NULL;
+}
+
+nlab_array* _apply_not(nlab_array** operands, int operation_type){
+
+    nlab_array* copy = _laid_out(operands[0]);
+    nlab_array* result;
+
+    (void) operation_type;
+    result = _unop_not(copy == NULL ? operands[0] : copy);
+    nlab_array_free(copy);
+    return result;
+}
+
 bool interp_u_eightcount(Program* prog){
 
     if(prog == NULL || prog->polish_stack == NULL){
@@ -1085,18 +2860,13 @@ bool interp_u_eightcount(Program* prog){
 
     if(prog->polish_stack->size > 0){
         nlab_array* pop = stack_pop(prog->polish_stack);
-        nlab_array* result = nlab_array_copy(pop);
+        nlab_array_materialize(pop);
+        nlab_array* result = _eightcount(pop);
 
         if(result == NULL){
             return false;
         }
 
-        for(int y = 0; y < (int) pop->rows; y++){
-            for(int x = 0; x < (int) pop->cols; x++){
-                result->array[y][x] = _calc_moore_neighbourhood(pop, x, y);
-            }
-        }
-
         stack_push(prog->polish_stack, result);
         // pass-by-value, so free result on this side as a copy is passed to stack
         nlab_array_free(result);
@@ -1107,6 +2877,17 @@ bool interp_u_eightcount(Program* prog){
     return false;
 }
 
+nlab_array* _apply_eightcount(nlab_array** operands, int operation_type){
+
+    nlab_array* copy = _laid_out(operands[0]);
+    nlab_array* result;
+
+    (void) operation_type;
+    result = _eightcount(copy == NULL ? operands[0] : copy);
+    nlab_array_free(copy);
+    return result;
+}
+
 /* UNARY EXTENTION OPERATIONS */
 #ifdef EXTENSION
 
@@ -1130,8 +2911,9 @@ bool extension_u_trace(Program* prog){
                 trace_count = 0;
                 pop = stack_pop(prog->polish_stack);
 
+                // only the diagonal is read, so packed arrays and views are read where they are
                 for(unsigned int diagonal = 0; diagonal < pop->rows; diagonal++){
-                    trace_count += pop->array[diagonal][diagonal];
+                    trace_count += nlab_array_get(pop, diagonal, diagonal);
                 }
 
                 result = nlab_array_create_1d(trace_count);
@@ -1152,6 +2934,20 @@ bool extension_u_trace(Program* prog){
     return false;
 }
 
+nlab_array* _apply_trace(nlab_array** operands, int operation_type){
+
+    unsigned int trace_count = 0;
+
+    (void) operation_type;
+    if(operands[0]->rows != operands[0]->cols){
+        return NULL;
+    }
+    for(unsigned int diagonal = 0; diagonal < operands[0]->rows; diagonal++){
+        trace_count += nlab_array_get(operands[0], diagonal, diagonal);
+    }
+    return nlab_array_create_1d(trace_count);
+}
+
 bool extension_u_transpose(Program* prog){
 
 
@@ -1164,15 +2960,9 @@ bool extension_u_transpose(Program* prog){
 
     if(prog->polish_stack->size > 0){
 
+        // O(1) - the elements are only moved if something needs them laid out
         pop = stack_pop(prog->polish_stack);
-
-        result = nlab_array_create_ones(pop->cols, pop->rows);
-
-        for(unsigned int y = 0; y < pop->rows; y++){
-            for(unsigned int x = 0; x < pop->cols; x++){
-                result->array[x][y] = pop->array[y][x];
-            }
-        }
+        result = nlab_array_transpose_view(pop);
 
         stack_push(prog->polish_stack, result);
         // pass-by-value, so free result on this side as a copy is passed to stack
@@ -1188,6 +2978,11 @@ bool extension_u_transpose(Program* prog){
     return false;
 }
 
+nlab_array* _apply_transpose(nlab_array** operands, int operation_type){
+    (void) operation_type;
+    return nlab_array_transpose_view(operands[0]);
+}
+
 bool extension_u_submatrix(Program* prog){
     nlab_array* popped_arr;
     nlab_array* cols;
@@ -1195,7 +2990,7 @@ bool extension_u_submatrix(Program* prog){
     nlab_array* result;
     unsigned int rm_row;
     unsigned int rm_col;
-    unsigned int new_rows, new_cols, zero_based_rm_row, zero_based_rm_col, current_row, current_col;
+    unsigned int zero_based_rm_row, zero_based_rm_col;
 
     if(prog == NULL || prog->polish_stack == NULL){
         return false;
@@ -1208,53 +3003,269 @@ bool extension_u_submatrix(Program* prog){
         popped_arr = stack_pop(prog->polish_stack);
         cols = stack_pop(prog->polish_stack);
         rows = stack_pop(prog->polish_stack);
+        nlab_array_unpack(cols);
+        nlab_array_unpack(rows);
+
+        rm_row = rows->data[0];
+        rm_col = cols->data[0];
+
+        if(!(rm_row > popped_arr->rows) && (rm_row > 0) 
+        && !(rm_col > popped_arr->cols) && (rm_col > 0)){
+
+            zero_based_rm_row = rm_row - 1;
+            zero_based_rm_col = rm_col - 1;
+
+            // a view over popped_arr that steps over the removed row and column.
+            // NULL (and nothing pushed) for a single row or column, as before
+            result = nlab_array_submatrix_view(popped_arr, zero_based_rm_row, zero_based_rm_col);
+
+            stack_push(prog->polish_stack, result);
+            // pass-by-value, so free result on this side as a copy is passed to stack
+            nlab_array_free(result);
+            return true;
+        }
+    }
+
+    SET_ERROR_STATE(error_interp);
+    char dummy[MAX_STRING_LENGTH];
+    dummy[0] = '\0';
+    strcat(dummy, "unable to interpret submatrix");
+    set_error_msg(prog, dummy);
+    return false;
+
+}
+
+
+bool extension_u_lifestep(Program* prog){
+
+    nlab_array* pop;
+    nlab_array* result;
+
+    if(prog == NULL || prog->polish_stack == NULL){
+        return false;
+    }
+
+    if(prog->polish_stack->size > 0){
+        pop = stack_pop(prog->polish_stack);
+        nlab_array_materialize(pop);
+        result = _lifestep(pop, LIFE_BIRTH_B3, LIFE_SURVIVE_S23);
+
+        stack_push(prog->polish_stack, result);
+        // pass-by-value, so free result on this side as a copy is passed to stack
+        nlab_array_free(result);
+        return true;
+    }
+
+    SET_ERROR_STATE(error_interp);
+    set_error_msg(prog, "unable to interpret life step of matrix");
+    return false;
+}
+
+nlab_array* _apply_lifestep(nlab_array** operands, int operation_type){
+
+    nlab_array* copy = _laid_out(operands[0]);
+    nlab_array* result;
+
+    (void) operation_type;
+    result = _lifestep(copy == NULL ? operands[0] : copy, LIFE_BIRTH_B3, LIFE_SURVIVE_S23);
+    nlab_array_free(copy);
+    return result;
+}
+
+#endif
+
+/*
+    One generation of a Life-like rule, 64 cells at a time on a packed board
+    (an int board is packed first, a cell being alive when it's 1, as for
+    U-EIGHTCOUNT). The eight neighbour words are summed bit-sliced into a
+    four-bit count per cell, and bit n of birth/survive says whether a dead/live
+    cell with n neighbours is alive next generation. Cells past the edges are dead.
+*/
+nlab_array* _lifestep(nlab_array* source, unsigned int birth, unsigned int survive){
+
+    nlab_array* board;
+    nlab_array* result;
+    nlab_array* one;
+    uint64_t *up, *mid, *down, *out;
+    uint64_t neighbours[8];
+    uint64_t count[4];
+    uint64_t alive, next, carry, equal;
+    unsigned int num_words;
+
+    if(source == NULL){
+        return NULL;
+    }
+
+    if(source->kind == nlab_bool){
+        board = nlab_array_copy(source);
+    } else{
+        one = nlab_array_create_1d(1);
+        board = _binop_scalar_vector(one, source, binop_equals);
+        nlab_array_free(one);
+    }
+
+    result = nlab_array_create_bool(board->rows, board->cols);
+    num_words = (board->cols + NLAB_BITS_PER_WORD - 1) / NLAB_BITS_PER_WORD;
+
+    for(unsigned int y = 0; y < board->rows; y++){
+        up = y > 0 ? NLAB_BITS_ROW(board, y - 1) : NULL;
+        mid = NLAB_BITS_ROW(board, y);
+        down = y + 1 < board->rows ? NLAB_BITS_ROW(board, y + 1) : NULL;
+        out = NLAB_BITS_ROW(result, y);
+
+        for(unsigned int w = 0; w < num_words; w++){
+            _life_shifted(up, w, num_words, &neighbours[0], &neighbours[1], &neighbours[2]);
+            _life_shifted(down, w, num_words, &neighbours[3], &neighbours[4], &neighbours[5]);
+            // the cell's own row only contributes its west and east neighbours
+            _life_shifted(mid, w, num_words, &neighbours[6], &alive, &neighbours[7]);
+
+            // ripple-carry add each neighbour word into the four count bit-planes
+            count[0] = count[1] = count[2] = count[3] = 0;
+            for(int n = 0; n < 8; n++){
+                carry = neighbours[n];
+                for(int bit = 0; bit < 4 && carry != 0; bit++){
+                    next = count[bit] & carry;
+                    count[bit] ^= carry;
+                    carry = next;
+                }
+            }
+
+            next = 0;
+            for(unsigned int n = 0; n <= LIFE_MAX_NEIGHBOURS; n++){
+                if(((birth | survive) >> n) & 1u){
+                    equal = ~(uint64_t) 0;
+                    for(int bit = 0; bit < 4; bit++){
+                        equal &= ((n >> bit) & 1u) ? count[bit] : ~count[bit];
+                    }
+                    if((birth >> n) & 1u){
+                        next |= equal & ~alive;
+                    }
+                    if((survive >> n) & 1u){
+                        next |= equal & alive;
+                    }
+                }
+            }
+            out[w] = next;
+        }
+    }
+
+    // births just past the last column land in the padding
+    _nlab_array_clear_bit_padding(result);
+    nlab_array_free(board);
+    return result;
+}
+
+// word w of a packed row, and the same cells' west and east neighbours (none for a NULL row)
+void _life_shifted(uint64_t* row, unsigned int w, unsigned int num_words, uint64_t* west, uint64_t* centre, uint64_t* east){
+
+    if(row == NULL){
+        *west = *centre = *east = 0;
+        return;
+    }
+
+    *centre = row[w];
+    *west = (row[w] << 1) | (w > 0 ? row[w - 1] >> (NLAB_BITS_PER_WORD - 1) : 0);
+    *east = (row[w] >> 1) | (w + 1 < num_words ? row[w + 1] << (NLAB_BITS_PER_WORD - 1) : 0);
+}
+
+/*
+    Moore neighbour counts for the whole array, from running sums: each row's
+    "is one" cells are summed across (x-1, x, x+1) once, and each output row is
+    then the sum of three of those rows less the cell itself. Only the first
+    and last row/column need special cases, so the inner loops are plain
+    column-wise adds the compiler can vectorise.
+*/
+nlab_array* _eightcount(nlab_array* source){
+
+    nlab_array* result;
+    int* buffer;
+    int *ind[3], *hsum[3];
+    int *up, *mid, *down, *centre, *out;
+    unsigned int rows, cols;
+
+    if(source == NULL){
+        return NULL;
+    }
+
+    rows = source->rows;
+    cols = source->cols;
+    result = nlab_array_create_zeros(rows, cols);
 
-        rm_row = rows->array[0][0];
-        rm_col = cols->array[0][0];
+    // three rolling rows each of indicators and horizontal sums
+    buffer = (int*) malloc(sizeof(int) * 6 * cols);
+    if(buffer == NULL){
+        fprintf(stderr, "Memory error - cannot malloc space for eightcount\n");
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i < 3; i++){
+        ind[i] = buffer + (size_t) i * cols;
+        hsum[i] = buffer + (size_t) (3 + i) * cols;
+    }
+
+    _eightcount_load_row(source, 0, ind[0], hsum[0]);
+
+    for(unsigned int y = 0; y < rows; y++){
+        // the row after this one takes the slot of the one before the previous
+        if(y + 1 < rows){
+            _eightcount_load_row(source, y + 1, ind[(y + 1) % 3], hsum[(y + 1) % 3]);
+        }
+
+        out = NLAB_ROW(result, y);
+        mid = hsum[y % 3];
+        centre = ind[y % 3];
+        up = y > 0 ? hsum[(y + 2) % 3] : NULL;
+        down = y + 1 < rows ? hsum[(y + 1) % 3] : NULL;
+
+        if(up != NULL && down != NULL){
+            for(unsigned int x = 0; x < cols; x++){
+                out[x] = up[x] + mid[x] + down[x] - centre[x];
+            }
+        } else if(up != NULL || down != NULL){
+            up = up != NULL ? up : down;
+            for(unsigned int x = 0; x < cols; x++){
+                out[x] = up[x] + mid[x] - centre[x];
+            }
+        } else{
+            for(unsigned int x = 0; x < cols; x++){
+                out[x] = mid[x] - centre[x];
+            }
+        }
+    }
+
+    free(buffer);
+    return result;
+}
 
-        if(!(rm_row > popped_arr->rows) && (rm_row > 0) 
-        && !(rm_col > popped_arr->cols) && (rm_col > 0)){
+// ind = row y's cells that are one, hsum = ind summed with its left and right neighbours
+void _eightcount_load_row(nlab_array* source, unsigned int y, int* ind, int* hsum){
 
-            zero_based_rm_row = rm_row - 1;
-            zero_based_rm_col = rm_col - 1;
-            new_rows = popped_arr->rows-1;
-            new_cols = popped_arr->cols-1;
-
-
-            result = nlab_array_create_ones(new_rows, new_cols);
-            current_row = current_col = 0;
-            for(unsigned int y = 0; y < popped_arr->rows; y++){
-                if(y != zero_based_rm_row){
-                    for(unsigned int x = 0; x < popped_arr->cols; x++){
-                        if(x != zero_based_rm_col){
-                            result->array[current_row][current_col] = popped_arr->array[y][x];
-                            current_col++;
-                        }
-                    }
-                    current_row++;
-                }
-                current_col = 0;
-            }
+    unsigned int cols = source->cols;
+    int* row;
 
-            stack_push(prog->polish_stack, result);
-            // pass-by-value, so free result on this side as a copy is passed to stack
-            nlab_array_free(result);
-            return true;
+    if(source->kind == nlab_bool){
+        for(unsigned int x = 0; x < cols; x++){
+            ind[x] = NLAB_BIT(source, y, x);
+        }
+    } else{
+        row = NLAB_ROW(source, y);
+        for(unsigned int x = 0; x < cols; x++){
+            ind[x] = row[x] == true;
         }
     }
 
-    SET_ERROR_STATE(error_interp);
-    char dummy[MAX_STRING_LENGTH];
-    dummy[0] = '\0';
-    strcat(dummy, "unable to interpret submatrix");
-    set_error_msg(prog, dummy);
-    return false;
+    if(cols == 1){
+        hsum[0] = ind[0];
+        return;
+    }
 
+    hsum[0] = ind[0] + ind[1];
+    for(unsigned int x = 1; x + 1 < cols; x++){
+        hsum[x] = ind[x - 1] + ind[x] + ind[x + 1];
+    }
+    hsum[cols - 1] = ind[cols - 2] + ind[cols - 1];
 }
 
-
-#endif
-
+// the direct count for one cell - kept as the reference for _eightcount()
 int _calc_moore_neighbourhood(nlab_array* nlab, int mid_x, int mid_y){
 
     short counter = 0;
@@ -1264,7 +3275,9 @@ int _calc_moore_neighbourhood(nlab_array* nlab, int mid_x, int mid_y){
             if((localy >= 0 && localx >= 0) 
             && (localy < (int) nlab->rows && localx < (int) nlab->cols)){
                 if(!(localy == mid_y && localx == mid_x)){ 
-                    if(nlab->array[localy][localx] == true){
+                    if(nlab->kind == nlab_bool){
+                        counter += NLAB_BIT(nlab, localy, localx);
+                    } else if(NLAB_ROW(nlab, localy)[localx] == true){
                         counter++;
                     }
                 } 
@@ -1278,7 +3291,6 @@ int _calc_moore_neighbourhood(nlab_array* nlab, int mid_x, int mid_y){
 
 bool _do_binary_operation(Program* prog, binary_op operation_type){
 
-    bool is_op1_scalar, is_op2_scalar;
     nlab_array *operand1, *operand2;
     unsigned int single_dim;
 
@@ -1295,31 +3307,22 @@ bool _do_binary_operation(Program* prog, binary_op operation_type){
         return false;
     }
 
-    is_op1_scalar = is_op2_scalar = false;
+    // the kernels below all walk contiguous rows
+    nlab_array_materialize(operand1);
+    nlab_array_materialize(operand2);
+
     single_dim = 1;
 
+    // scalars are always read straight out of ->data
     if(operand1->rows == single_dim && operand1->cols == single_dim){
-        is_op1_scalar = true;
+        nlab_array_unpack(operand1);
     }
 
     if(operand2->rows == single_dim && operand2->cols == single_dim){
-        is_op2_scalar = true;
+        nlab_array_unpack(operand2);
     }
 
-    nlab_array* result = NULL;
-
-    if(is_op1_scalar == false && is_op2_scalar == true){
-        result = _binop_scalar_vector(operand2, operand1, operation_type);
-
-    } else if(is_op1_scalar == true && is_op2_scalar == false){
-        result = _binop_scalar_vector(operand1, operand2, operation_type);
-
-    } else if(is_op1_scalar == false && is_op2_scalar == false) {
-        result = _binop_vector_vector(operand1, operand2, operation_type);
-
-    } else if(is_op1_scalar == true && is_op2_scalar == true) {
-        result = _binop_scalar_scalar(operand1, operand2, operation_type);
-    }
+    nlab_array* result = _binary_result(operand1, operand2, operation_type);
 
     if(result == NULL){
         return false;
@@ -1332,6 +3335,43 @@ bool _do_binary_operation(Program* prog, binary_op operation_type){
     return true;
 }
 
+// operands laid out, and scalars unpacked
+nlab_array* _binary_result(nlab_array* operand1, nlab_array* operand2, binary_op operation_type){
+
+    bool is_op1_scalar = operand1->rows == 1 && operand1->cols == 1;
+    bool is_op2_scalar = operand2->rows == 1 && operand2->cols == 1;
+
+    if(is_op1_scalar == false && is_op2_scalar == true){
+        return _binop_scalar_vector(operand2, operand1, operation_type);
+
+    } else if(is_op1_scalar == true && is_op2_scalar == false){
+        return _binop_scalar_vector(operand1, operand2, operation_type);
+
+    } else if(is_op1_scalar == false && is_op2_scalar == false) {
+        return _binop_vector_vector(operand1, operand2, operation_type);
+    }
+    return _binop_scalar_scalar(operand1, operand2, operation_type);
+}
+
+// as _do_binary_operation(), on copies where an operand would have been changed
+nlab_array* _apply_binary(nlab_array** operands, int operation_type){
+
+    nlab_array* copies[2];
+    nlab_array* result;
+
+    for(int i = 0; i < 2; i++){
+        copies[i] = _laid_out(operands[i]);
+        if(copies[i] == NULL && operands[i]->kind == nlab_bool && operands[i]->rows == 1 && operands[i]->cols == 1){
+            copies[i] = nlab_array_to_int(operands[i]);
+        }
+    }
+    result = _binary_result(copies[0] == NULL ? operands[0] : copies[0],
+                            copies[1] == NULL ? operands[1] : copies[1], operation_type);
+    nlab_array_free(copies[0]);
+    nlab_array_free(copies[1]);
+    return result;
+}
+
 bool interp_b_and(Program* prog){
     if(_do_binary_operation(prog, binop_and)){
         return true;
@@ -1391,114 +3431,296 @@ bool extension_b_dotproduct(Program* prog){
 }
 
 
+/*
+    M^n by repeated squaring, so a power costs O(log n) dot-products rather
+    than n - 1. Elements wrap like B-DOTPRODUCT's, unless POWER_MODULUS is set.
+*/
 bool extension_b_power(Program* prog){
 
     nlab_array* power_arr;
-    nlab_array* orig_vector;
-    short power, scalar_dims, power_of_one, power_of_ten;
+    nlab_array* base;
+    nlab_array* result;
+    int power;
+
+    if(prog == NULL || prog->polish_stack == NULL){
+        return false;
+    }
 
     power_arr = stack_pop(prog->polish_stack);
-    power = power_arr->array[0][0];
+    base = stack_pop(prog->polish_stack);
 
-    orig_vector = nlab_array_copy(stack_peek(prog->polish_stack));
+    if(power_arr == NULL || base == NULL || power_arr->rows != 1 || power_arr->cols != 1){
+        return false;
+    }
 
-    scalar_dims = 1;
-    power_of_one = 1;
-    power_of_ten = 10;
+    power = nlab_array_get(power_arr, 0, 0);
+    result = power < 0 ? NULL : _matrix_power(base, (unsigned int) power, POWER_MODULUS);
 
-    if(((short) power_arr->cols == scalar_dims) 
-    && ((short) power_arr->rows == scalar_dims) 
-    && (power == power_of_one)){
-        nlab_array_free(orig_vector);
-        return true;
+    if(result == NULL){
+        return false;
+    }
 
-    } else if(((short) power_arr->cols == scalar_dims) 
-    && ((short) power_arr->rows == scalar_dims) 
-    && (power > power_of_one)
-    && (power <= power_of_ten)){
+    stack_push(prog->polish_stack, result);
+    // pass-by-value
+    nlab_array_free(result);
+    return true;
+}
 
-        while(power > power_of_one){
-            
-            stack_push(prog->polish_stack, orig_vector);
-            if(!_do_binary_operation(prog, binop_dotproduct)){
-                nlab_array_free(orig_vector);
-                return false;
+nlab_array* _apply_power(nlab_array** operands, int operation_type){
+
+    int power;
+
+    (void) operation_type;
+    if(operands[1]->rows != 1 || operands[1]->cols != 1){
+        return NULL;
+    }
+    power = nlab_array_get(operands[1], 0, 0);
+    return power < 0 ? NULL : _matrix_power(operands[0], (unsigned int) power, POWER_MODULUS);
+}
+
+// NULL unless base is square. M^0 is the identity
+nlab_array* _matrix_power(nlab_array* base, unsigned int power, unsigned int modulus){
+
+    nlab_array* square;
+    nlab_array* result;
+    nlab_array* product;
+    int64_t reduced;
+
+    if(base == NULL || base->rows != base->cols){
+        return NULL;
+    }
+
+    // the first multiply reduces everything after it, so only base needs it by hand
+    square = nlab_array_to_int(base);
+    if(modulus != 0){
+        nlab_array_make_writable(square);
+        for(unsigned int y = 0; y < square->rows; y++){
+            for(unsigned int x = 0; x < square->cols; x++){
+                reduced = (int64_t) NLAB_ROW(square, y)[x] % modulus;
+                NLAB_ROW(square, y)[x] = (int) (reduced < 0 ? reduced + modulus : reduced);
             }
+        }
+    }
 
-            power--;
+    result = NULL;
+    while(power > 0){
+        if(power & 1u){
+            product = result == NULL ? nlab_array_copy(square) : _matrix_multiply(result, square, modulus);
+            nlab_array_free(result);
+            result = product;
+        }
+        power >>= 1;
+        if(power > 0){
+            product = _matrix_multiply(square, square, modulus);
+            nlab_array_free(square);
+            square = product;
         }
-        nlab_array_free(orig_vector);
-        return true;
     }
-    nlab_array_free(orig_vector);
-    return false;
+
+    if(result == NULL){
+        result = nlab_array_create_zeros(base->rows, base->cols);
+        for(unsigned int i = 0; i < result->rows; i++){
+            NLAB_ROW(result, i)[i] = modulus == 1 ? 0 : 1;
+        }
+    }
+
+    nlab_array_free(square);
+    return result;
+}
+
+// int-only m1 . m2, with every element reduced mod modulus unless it's 0
+nlab_array* _matrix_multiply(nlab_array* m1, nlab_array* m2, unsigned int modulus){
+
+    nlab_array* result = nlab_array_create_zeros(m1->rows, m2->cols);
+
+    if(modulus == 0){
+        gemm_int(m1->data, m1->stride, m2->data, m2->stride, result->data, result->stride,
+                 m1->rows, m2->cols, m1->cols);
+    } else{
+        gemm_int_mod(m1->data, m1->stride, m2->data, m2->stride, result->data, result->stride,
+                     m1->rows, m2->cols, m1->cols, modulus);
+    }
+    return result;
 }
 #endif
 
+
+nlab_array* _unop_not(nlab_array* operand){
+
+    nlab_array* result;
+    uint64_t* in_bits;
+    uint64_t* out_bits;
+    size_t num_words;
+
+    if(operand == NULL){
+        return NULL;
+    }
+
+    if(operand->kind == nlab_bool){
+        result = nlab_array_create_bool(operand->rows, operand->cols);
+        in_bits = operand->bits;
+        out_bits = result->bits;
+        num_words = (size_t) operand->rows * operand->stride;
+        for(size_t i = 0; i < num_words; i++){
+            out_bits[i] = ~in_bits[i];
+        }
+        _nlab_array_clear_bit_padding(result);
+
+    } else if(operand->rows == 1 && operand->cols == 1){
+        result = nlab_array_create_1d(operand->data[0] == false);
+
+    } else {
+        result = nlab_array_create_bool(operand->rows, operand->cols);
+        for(unsigned int y = 0; y < operand->rows; y++){
+            simd_not(NLAB_BITS_ROW(result, y), NLAB_ROW(operand, y), operand->cols);
+        }
+    }
+
+    return result;
+}
+
+// the kernels have their own copy of the elementwise operators
+simd_op _simd_op(binary_op operation_type){
+
+    switch(operation_type){
+        case binop_and:
+            return simd_and;
+        case binop_or:
+            return simd_or;
+        case binop_greater:
+            return simd_greater;
+        case binop_less:
+            return simd_less;
+        case binop_add:
+            return simd_add;
+        case binop_times:
+            return simd_times;
+        default:
+            return simd_equals;
+    }
+}
+
+// every element of a packed array the same as value (0 or 1)
+nlab_array* _bool_fill(nlab_array* shape, bool value){
+
+    nlab_array* result = nlab_array_create_bool(shape->rows, shape->cols);
+
+    if(value){
+        memset(result->bits, 0xff, _nlab_array_num_bytes(result));
+        _nlab_array_clear_bit_padding(result);
+    }
+    return result;
+}
+
+/*
+    A packed (0/1) vector against a scalar never needs unpacking - each operator
+    reduces to the vector itself, its negation, or a constant.
+*/
+nlab_array* _binop_scalar_bool(int value, nlab_array* vector, binary_op operation_type){
+
+    if(operation_type == binop_and){
+        return value ? nlab_array_copy(vector) : _bool_fill(vector, false);
+    } else if(operation_type == binop_or){
+        return value ? _bool_fill(vector, true) : nlab_array_copy(vector);
+    } else if(operation_type == binop_greater){
+        if(value < 0){
+            return _bool_fill(vector, true);
+        }
+        return value == 0 ? nlab_array_copy(vector) : _bool_fill(vector, false);
+    } else if(operation_type == binop_less){
+        if(value > 1){
+            return _bool_fill(vector, true);
+        }
+        return value == 1 ? _unop_not(vector) : _bool_fill(vector, false);
+    } else if(operation_type == binop_equals){
+        if(value == 1){
+            return nlab_array_copy(vector);
+        }
+        return value == 0 ? _unop_not(vector) : _bool_fill(vector, false);
+    }
+    return NULL;
+}
+
 nlab_array* _binop_scalar_vector(nlab_array* scalar, nlab_array* vector, binary_op operation_type){
     
     nlab_array* result;
+    nlab_array* int_vector;
+    int value;
     
     if(scalar == NULL || vector == NULL){
         return NULL;
     }
 
-    result = nlab_array_copy(vector);
-            
-    if(operation_type == binop_and){
+    value = nlab_array_get(scalar, 0, 0);
+
+    if(vector->kind == nlab_bool){
+        if(operation_type != binop_add && operation_type != binop_times){
+            return _binop_scalar_bool(value, vector, operation_type);
+        }
+        // arithmetic leaves 0/1, so widen
+        int_vector = nlab_array_to_int(vector);
+        result = _binop_scalar_vector(scalar, int_vector, operation_type);
+        nlab_array_free(int_vector);
+        return result;
+    }
+
+    // both buffers are contiguous with the same stride, so arithmetic streams
+    // through them in one flat pass (the row padding is computed too, but never read)
+    if(operation_type == binop_add || operation_type == binop_times){
+        result = nlab_array_create_uninit(vector->rows, vector->cols);
+        simd_arith(_simd_op(operation_type), result->data, vector->data, NULL, value,
+                   (size_t) vector->rows * vector->stride);
+
+    // the logical operators only produce 0/1, so their results are packed
+    } else if(operation_type == binop_and || operation_type == binop_or || operation_type == binop_greater
+           || operation_type == binop_less || operation_type == binop_equals){
+        result = nlab_array_create_bool(vector->rows, vector->cols);
         for(unsigned int y = 0; y < vector->rows; y++){
-            for(unsigned int x = 0; x < vector->cols; x++){
-                result->array[y][x] = vector->array[y][x] &&  scalar->array[0][0];
-            }
+            simd_compare(_simd_op(operation_type), NLAB_BITS_ROW(result, y), NLAB_ROW(vector, y), NULL, value, vector->cols);
+        }
+    } else {
+        return NULL;
+    }
+
+    return result;
+}
+
+// both operands packed: whole 64-cell words at a time
+nlab_array* _binop_bool_bool(nlab_array* v1, nlab_array* v2, binary_op operation_type){
+
+    nlab_array* result;
+    uint64_t* in1;
+    uint64_t* in2;
+    uint64_t* out;
+    size_t num_words;
+
+    result = nlab_array_create_bool(v1->rows, v1->cols);
+    in1 = v1->bits;
+    in2 = v2->bits;
+    out = result->bits;
+    num_words = (size_t) v1->rows * v1->stride;
+
+    if(operation_type == binop_and){
+        for(size_t i = 0; i < num_words; i++){
+            out[i] = in1[i] & in2[i];
         }
     } else if(operation_type == binop_or){
-        for(unsigned int y = 0; y < vector->rows; y++){
-            for(unsigned int x = 0; x < vector->cols; x++){
-                result->array[y][x] = vector->array[y][x] ||  scalar->array[0][0];
-            }
+        for(size_t i = 0; i < num_words; i++){
+            out[i] = in1[i] | in2[i];
         }
     } else if(operation_type == binop_greater){
-        for(unsigned int y = 0; y < vector->rows; y++){
-            for(unsigned int x = 0; x < vector->cols; x++){
-                if(vector->array[y][x] > scalar->array[0][0]){
-                    result->array[y][x] = true;
-                } else{
-                    result->array[y][x] = false;
-                }
-            }
+        for(size_t i = 0; i < num_words; i++){
+            out[i] = in1[i] & ~in2[i];
         }
     } else if(operation_type == binop_less){
-        for(unsigned int y = 0; y < vector->rows; y++){
-            for(unsigned int x = 0; x < vector->cols; x++){
-                if(vector->array[y][x] < scalar->array[0][0]){
-                    result->array[y][x] = true;
-                } else{
-                    result->array[y][x] = false;
-                }
-            }
-        }
-    } else if(operation_type == binop_add){
-        for(unsigned int y = 0; y < vector->rows; y++){
-            for(unsigned int x = 0; x < vector->cols; x++){
-                result->array[y][x] = vector->array[y][x] + scalar->array[0][0];
-            }
-        }
-    } else if(operation_type == binop_times){
-        for(unsigned int y = 0; y < vector->rows; y++){
-            for(unsigned int x = 0; x < vector->cols; x++){
-                result->array[y][x] = vector->array[y][x] * scalar->array[0][0];
-            }
+        for(size_t i = 0; i < num_words; i++){
+            out[i] = ~in1[i] & in2[i];
         }
     } else if(operation_type == binop_equals){
-        for(unsigned int y = 0; y < vector->rows; y++){
-            for(unsigned int x = 0; x < vector->cols; x++){
-                if(vector->array[y][x] == scalar->array[0][0]){
-                    result->array[y][x] = true;
-                } else{
-                    result->array[y][x] = false;
-                }
-            }
+        for(size_t i = 0; i < num_words; i++){
+            out[i] = ~(in1[i] ^ in2[i]);
         }
+        _nlab_array_clear_bit_padding(result);
     } else {
         nlab_array_free(result);
         return NULL;
@@ -1510,129 +3732,58 @@ nlab_array* _binop_scalar_vector(nlab_array* scalar, nlab_array* vector, binary_
 nlab_array* _binop_vector_vector(nlab_array* v1, nlab_array* v2, binary_op operation_type){
     
     nlab_array* result;
+    nlab_array* int_v1;
+    nlab_array* int_v2;
     
     if(v1 == NULL || v2 == NULL){
         return NULL;
     }
 
-    result = nlab_array_copy(v1);
+    if(operation_type != binop_dotproduct && (v1->rows != v2->rows || v1->cols != v2->cols)){
+        return NULL;
+    }
 
-    if(operation_type == binop_and){
-        if(v1->rows == v2->rows && v1->cols == v2->cols){
-            for(unsigned int y = 0; y < result->rows; y++){
-                for(unsigned int x = 0; x < result->cols; x++){
-                    result->array[y][x] = v1->array[y][x] &&  v2->array[y][x];
-                } 
-            }
-        } else {
-            nlab_array_free(result);
-            return NULL;
+    if(v1->kind == nlab_bool || v2->kind == nlab_bool){
+        if(v1->kind == nlab_bool && v2->kind == nlab_bool
+        && operation_type != binop_add && operation_type != binop_times && operation_type != binop_dotproduct){
+            return _binop_bool_bool(v1, v2, operation_type);
         }
-    } else if(operation_type == binop_or){
-        if(v1->rows == v2->rows && v1->cols == v2->cols){
-            for(unsigned int y = 0; y < result->rows; y++){
-                for(unsigned int x = 0; x < result->cols; x++){
-                    result->array[y][x] = v1->array[y][x] ||  v2->array[y][x];
-                } 
-            }
-        } else {
-            nlab_array_free(result);
-            return NULL;
-        }
-    } else if(operation_type == binop_greater){
-        if(v1->rows == v2->rows && v1->cols == v2->cols){
-            for(unsigned int y = 0; y < result->rows; y++){
-                for(unsigned int x = 0; x < result->cols; x++){
-                    if(v1->array[y][x] > v2->array[y][x]){
-                        result->array[y][x] = true;
-                    } else{
-                        result->array[y][x] = false;
-                    }
-                }
-            }
-        } else {
-            nlab_array_free(result);
-            return NULL;
-        }
-    } else if(operation_type == binop_less){
-        if(v1->rows == v2->rows && v1->cols == v2->cols){
-            for(unsigned int y = 0; y < result->rows; y++){
-                for(unsigned int x = 0; x < result->cols; x++){
-                    if(v1->array[y][x] < v2->array[y][x]){
-                        result->array[y][x] = true;
-                    } else{
-                        result->array[y][x] = false;
-                    }
-                }
-            }
-        } else {
-            nlab_array_free(result);
-            return NULL;
-        }
-    } else if(operation_type == binop_add){
-        if(v1->rows == v2->rows && v1->cols == v2->cols){
-            for(unsigned int y = 0; y < result->rows; y++){
-                for(unsigned int x = 0; x < result->cols; x++){
-                    result->array[y][x] = v1->array[y][x] + v2->array[y][x];
-                }
-            }
-        } else {
-            nlab_array_free(result);
-            return NULL;
-        }
-    } else if(operation_type == binop_times){
-        if(v1->rows == v2->rows && v1->cols == v2->cols){
-            for(unsigned int y = 0; y < result->rows; y++){
-                for(unsigned int x = 0; x < result->cols; x++){
-                    result->array[y][x] = v1->array[y][x] * v2->array[y][x];
-                }
-            }
-        } else {
-            nlab_array_free(result);
-            return NULL;
-        }
-    } else if(operation_type == binop_equals){
-        if(v1->rows == v2->rows && v1->cols == v2->cols){
-            for(unsigned int y = 0; y < result->rows; y++){
-                for(unsigned int x = 0; x < result->cols; x++){
-                    if(v1->array[y][x] == v2->array[y][x]){
-                        result->array[y][x] = true;
-                    } else{
-                        result->array[y][x] = false;
-                    }
-                }
-            }
-        } else {
-            nlab_array_free(result);
-            return NULL;
+        // mixed kinds, or arithmetic - widen and use the int kernels
+        int_v1 = nlab_array_to_int(v1);
+        int_v2 = nlab_array_to_int(v2);
+        result = _binop_vector_vector(int_v1, int_v2, operation_type);
+        nlab_array_free(int_v1);
+        nlab_array_free(int_v2);
+        return result;
+    }
+
+    // same shape means same stride, so arithmetic streams through all three buffers in one flat pass
+    if(operation_type == binop_add || operation_type == binop_times){
+        result = nlab_array_create_uninit(v1->rows, v1->cols);
+        simd_arith(_simd_op(operation_type), result->data, v1->data, v2->data, 0,
+                   (size_t) v1->rows * v1->stride);
+
+    // the logical operators only produce 0/1, so their results are packed
+    } else if(operation_type == binop_and || operation_type == binop_or || operation_type == binop_greater
+           || operation_type == binop_less || operation_type == binop_equals){
+        result = nlab_array_create_bool(v1->rows, v1->cols);
+        for(unsigned int y = 0; y < v1->rows; y++){
+            simd_compare(_simd_op(operation_type), NLAB_BITS_ROW(result, y), NLAB_ROW(v1, y), NLAB_ROW(v2, y), 0, v1->cols);
         }
     } 
     #ifdef EXTENSION
     else if(operation_type == binop_dotproduct){
         if(v1->cols == v2->rows){
-            nlab_array_free(result);
-            unsigned int counter;
-            result = nlab_array_create_ones(v1->rows, v2->cols);
-
-            for(unsigned int y = 0; y < result->rows; y++){
-                for(unsigned int x = 0; x < result->cols; x++){
-                    counter = 0;
-                    result->array[y][x] = 0;
-                    while(counter < v1->cols){
-                        result->array[y][x] += v1->array[y][counter] * v2->array[counter][x];
-                        counter++;
-                    }
-                }
-            }
+            result = nlab_array_create_zeros(v1->rows, v2->cols);
+            gemm_int(v1->data, v1->stride, v2->data, v2->stride, result->data, result->stride,
+                     v1->rows, v2->cols, v1->cols);
         } else {
-            nlab_array_free(result);
             return NULL;
         }
     } 
 
     #endif
     else {
-        nlab_array_free(result);
         return NULL;
     }
 
@@ -1646,33 +3797,33 @@ nlab_array* _binop_scalar_scalar(nlab_array* s1, nlab_array* s2, binary_op opera
         return NULL;
     }
 
-    result = nlab_array_copy(s1);
+    result = nlab_array_create_1d(0);
 
     if(operation_type == binop_and){
-        result->array[0][0] = s1->array[0][0] &&  s2->array[0][0];
+        result->data[0] = s1->data[0] &&  s2->data[0];
     } else  if(operation_type == binop_or){
-        result->array[0][0] = s1->array[0][0] ||  s2->array[0][0];
+        result->data[0] = s1->data[0] ||  s2->data[0];
     } else if(operation_type == binop_greater){
-        if(s1->array[0][0] > s2->array[0][0]){
-            result->array[0][0] = true;
+        if(s1->data[0] > s2->data[0]){
+            result->data[0] = true;
         } else{
-            result->array[0][0] = false;
+            result->data[0] = false;
         }
     } else if(operation_type == binop_less){
-        if(s1->array[0][0] < s2->array[0][0]){
-            result->array[0][0] = true;
+        if(s1->data[0] < s2->data[0]){
+            result->data[0] = true;
         } else{
-            result->array[0][0] = false;
+            result->data[0] = false;
         }
     } else if(operation_type == binop_add){
-        result->array[0][0] = s1->array[0][0] + s2->array[0][0];
+        result->data[0] = (int) ((unsigned int) s1->data[0] + (unsigned int) s2->data[0]);
     } else if(operation_type == binop_times){
-        result->array[0][0] = s1->array[0][0] * s2->array[0][0];
+        result->data[0] = (int) ((unsigned int) s1->data[0] * (unsigned int) s2->data[0]);
     } else if(operation_type == binop_equals){
-        if(s1->array[0][0] == s2->array[0][0]){
-            result->array[0][0] = true;
+        if(s1->data[0] == s2->data[0]){
+            result->data[0] = true;
         } else{
-            result->array[0][0] = false;
+            result->data[0] = false;
         }
     } else {
         nlab_array_free(result);
@@ -1682,22 +3833,6 @@ nlab_array* _binop_scalar_scalar(nlab_array* s1, nlab_array* s2, binary_op opera
     return result;
 }
 
-char* _interp_get_var_context(Program* prog){
-
-    int currentword;
-
-    currentword = prog->current_token;
-
-    while(currentword >= 0){
-        if(STRINGS_EQUAL(prog->tokens[currentword],"SET")){
-            currentword++;
-            return prog->tokens[currentword];
-        }
-        currentword--;
-    }
-    return  NULL;
-}
-
 bool interp_create_ones(Program* prog, char* key, nlab_array* ones_array){
 
     if(prog != NULL && prog->variable_map!= NULL && ones_array != NULL){
@@ -1747,7 +3882,7 @@ bool interp_create_read(Program* prog, char* key, nlab_array* narray, char* file
                         fclose(fp);
                         return false;
                     }
-                    narray->array[y][x] = element;
+                    NLAB_ROW(narray, y)[x] = element;
                     x++;
                     num_elements++;
                     if(x%num_cols == 0){
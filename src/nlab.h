@@ -4,6 +4,12 @@
 #include "map/specific.h"
 #include "stack/stack.h"
 #include "stack/specific.h"
+#include "bytecode/bytecode.h"
+#include "bytecode/specific.h"
+#include "simd/simd.h"
+#include "gemm/gemm.h"
+#include "arena/arena.h"
+#include "arena/specific.h"
 
 #define MAX_NUM_OF_TOKENS 1000
 #define MAX_TOKEN_SIZE 100
@@ -12,6 +18,29 @@
 #define SEMICOLON ";"
 #define LBRACE "{"
 #define RBRACE "}"
+// elements evaluated at a time by a fused expression, and the deepest stack it may use
+#define FUSED_BLOCK 256
+#define FUSED_MAX_DEPTH 16
+// most values an operator with a register kernel takes
+#define OPERATOR_MAX_OPERANDS 2
+// birth/survival masks for U-LIFESTEP - bit n set for n neighbours
+#define LIFE_BIRTH_B3 (1u << 3)
+#define LIFE_SURVIVE_S23 ((1u << 2) | (1u << 3))
+#define LIFE_MAX_NEIGHBOURS 8
+// LOOP bodies whose shapes haven't settled after this many passes aren't checked past the loop
+#define SHAPE_MAX_PASSES 4
+// chunk sizes for the arena holding a program's literals, and the one holding
+// the temporaries of a single SET
+#define PROGRAM_ARENA_CHUNK (1 << 12)
+#define SCRATCH_ARENA_CHUNK (1 << 20)
+// B-POWER wraps like the other int operators. Building with e.g.
+// -DPOWER_MODULUS=1000000007 reduces every element mod that instead
+#ifndef POWER_MODULUS
+#define POWER_MODULUS 0
+#endif
+#if POWER_MODULUS < 0 || POWER_MODULUS > INT_MAX
+#error "POWER_MODULUS must be between 0 and INT_MAX"
+#endif
 
 #define CURRENT_WORD prog->tokens[prog->current_token]
 #define INCR_CURRENT_WORD prog->current_token++
@@ -21,27 +50,127 @@
 #define SET_ERROR_STATE(A) if(prog->error_state == error_none){prog->error_state = A;}
 
 typedef enum error_state {error_none, error_io, error_parse, error_interp, error_unknown} error_state;
-typedef enum binary_op {binop_and, binop_or, binop_greater, binop_less, binop_add, binop_times, binop_equals, binop_dotproduct, binop_power} binary_op;
+typedef enum unary_op {unop_not, unop_eightcount, unop_trace, unop_transpose, unop_submatrix, unop_lifestep, unop_count} unary_op;
+typedef enum binary_op {binop_and, binop_or, binop_greater, binop_less, binop_add, binop_times, binop_equals, binop_dotproduct, binop_power, binop_count} binary_op;
+
+// what each token was interned to as it was read, so the grammar and compiler
+// never compare operator words - see program_builder_add()
+typedef enum token_kind {token_other, token_unary, token_binary} token_kind;
+typedef struct token_code{
+    token_kind kind;
+    short operation_type;
+} token_code;
+
+
+// a value in an op_registers SET: a variable or literal read where it is, or a result the register owns
+typedef struct nlab_register{
+    nlab_array* value;
+    bool owned;
+} nlab_register;
 
 typedef struct prog{
     char** tokens;
+    token_code* token_codes;
     int current_token;
     int num_of_tokens;
     char error_msg[MAX_LEN_OF_ERROR_MESSAGE];
     struct stack* polish_stack;
+    // values a SET's expression computes more than once, kept by op_cache_store
+    struct stack* cse_values;
+    // enough registers for any op_registers SET compiled so far
+    nlab_register* registers;
+    int num_registers;
     struct map* variable_map;
     error_state error_state;
+    // instructions are only run once the outermost one has been compiled, so
+    // a LOOP body is compiled once however many times it's executed
+    struct bytecode* bytecode;
+    int compile_depth;
+    // set by nlabc - programs are compiled as usual, but never run
+    bool compile_only;
+    // set by main - each variable is freed once nothing can read it again. Off
+    // otherwise, so tests can look at every variable once a program has run
+    bool release_dead_variables;
+    // set by main too - SETs whose value nothing reads are dropped before the run
+    bool remove_dead_stores;
+    // literals live as long as the program. Temporaries made while a SET is
+    // evaluated come from scratch_arena, which is reset once the result has
+    // been stored and at the end of every LOOP iteration
+    struct arena* program_arena;
+    struct arena* scratch_arena;
+    // heap allocations counted at the last LOOP iteration's end, and made during it
+    size_t iteration_heap_mark;
+    size_t last_iteration_heap_allocs;
 } Program;
 
+/*
+    UNARY_OPERATORS and BINARY_OPERATORS are indexed by unary_op/binary_op. An
+    operator is known to the grammar, compiler and interpreter by its entry
+    alone; entries left empty (e.g. the extension's, in other builds) don't exist.
+*/
+typedef bool (*operator_kernel)(Program* prog);
+typedef nlab_array* (*operator_apply)(nlab_array** operands, int operation_type);
+typedef struct operator_entry{
+    const char* word;
+    operator_kernel kernel;
+    // values taken off the stack (one is always pushed), unless needs_whole_stack -
+    // then the stack must hold exactly that many, and nothing may be pushed
+    short operands;
+    bool needs_whole_stack;
+    // the kernel for op_registers: the result of operands (left to right), which
+    // it mustn't change, or NULL if it can't be computed - the stack kernel then
+    // runs, and reports why. Left empty, the operator is only run on the stack
+    operator_apply apply;
+} operator_entry;
+
+/*
+    What the shape pass knows about a value before the program is run: its
+    shape and, for a literal, the value itself. The pass is exact up to the
+    first thing it can't be sure of (see shape_check), and stops there.
+*/
+typedef struct static_value{
+    unsigned int rows;
+    unsigned int cols;
+    bool is_literal;
+    int literal;
+} static_value;
+
+typedef struct static_state{
+    bool is_set[NUM_OF_VARS];
+    static_value vars[NUM_OF_VARS];
+    static_value stack[MAX_NUM_OF_TOKENS];
+    int stack_size;
+    static_value cached[MAX_NUM_OF_TOKENS];
+    int num_cached;
+    // scratch arena bytes used by the current SET, and by the largest so far
+    size_t set_bytes;
+    size_t max_set_bytes;
+} static_state;
+
+// shapes_unsure: the run could go wrong (or right) in a way that depends on more than shapes
+typedef enum shape_check {shapes_ok, shapes_unsure, shapes_mismatch} shape_check;
+
+// a value computed by a SET's expression, when looking for ones computed twice:
+// the instruction making it, its operands (earlier nodes) and the first node of its subtree
+typedef struct expression_node{
+    opcode op;
+    int operand;
+    int lhs;
+    int rhs;
+    int start;
+} expression_node;
+
 
 /** GENERAL FUNCTIONS **/
 
 void readfile(char* filename, Program* prog);
+void finish_program(Program* prog, bool ran);
 Program* program_builder_init(void);
 bool program_builder_add(Program* prog, char* token);
 void program_builder_free(Program* prog);
 bool set_error_msg(Program* prog, const char* msg);
 void process_error_msg(Program* prog, char* message);
+void print_alloc_report(Program* prog);
 int word_to_integer(char* word);
 bool _is_correct_file_extention(char* filename, char* exttype);
 bool _format_filename(char* fname);
@@ -65,6 +194,7 @@ bool rows(Program* prog);
 bool cols(Program* prog);
 bool filename(Program* prog);
 bool loop(Program* prog);
+bool until_stable(Program* prog, int* watched);
 
 
 
@@ -104,11 +234,15 @@ void test_nlab(void);
 void test_stack(void);
 void test_map(void);
 void test_nlab_array(void);
+void test_bytecode(void);
+void test_simd(void);
+void test_gemm(void);
+void test_arena(void);
+void test_nlabc(void);
 
 /* INTERPRETER FUNCTIONS */
 char* interp_print_variable(Program* prog, char* current_token);
 char* interp_print_string(char* word);
-bool interp_set(Program* prog);
 bool interp_pushdown_variable(Program* prog);
 bool interp_u_not(Program* prog);
 bool interp_u_eightcount(Program* prog);
@@ -122,30 +256,100 @@ bool interp_b_equals(Program* prog);
 bool interp_loop(Program* prog);
 bool interp_create_ones(Program* prog, char* key,  nlab_array* ones_array);
 bool interp_create_read(Program* prog, char* key, nlab_array* arr, char* filename);
+bool interp_execute(Program* prog, int first_instruction);
+bool _interp_execute_instructions(Program* prog, int first_instruction);
+int _interp_step(Program* prog, int pc);
+bool _is_expression_op(opcode op);
+void _interp_materialize_variable(nlab_array* value);
+void _interp_store_result(Program* prog, short slot);
+void _interp_reset_scratch(Program* prog);
+void _interp_end_iteration(Program* prog);
+
+extern const operator_entry UNARY_OPERATORS[unop_count];
+extern const operator_entry BINARY_OPERATORS[binop_count];
 
 bool _add_value_to_map(Program* prog, char* key, nlab_array* value);
+nlab_array* _eightcount(nlab_array* source);
+nlab_array* _lifestep(nlab_array* source, unsigned int birth, unsigned int survive);
+void _life_shifted(uint64_t* row, unsigned int w, unsigned int num_words, uint64_t* west, uint64_t* centre, uint64_t* east);
+void _eightcount_load_row(nlab_array* source, unsigned int y, int* ind, int* hsum);
 int _calc_moore_neighbourhood(nlab_array* nlab, int x, int y);
 bool _do_binary_operation(Program* prog, binary_op operation_type);
+nlab_array* _binary_result(nlab_array* operand1, nlab_array* operand2, binary_op operation_type);
+nlab_array* _laid_out(nlab_array* operand);
+nlab_array* _apply_not(nlab_array** operands, int operation_type);
+nlab_array* _apply_eightcount(nlab_array** operands, int operation_type);
+nlab_array* _apply_binary(nlab_array** operands, int operation_type);
+token_code _intern_token(char* word);
+bool _interp_unary(Program* prog, unary_op operation_type);
+bool _interp_binary(Program* prog, binary_op operation_type);
+bool _interp_run_if_top_level(Program* prog, int first_instruction);
+void _interp_until_stable(Program* prog, instruction* instr);
+void _interp_emit_operator(Program* prog, opcode op, int operation_type);
+bool _is_fusable(instruction* instr);
+void _interp_fuse_elementwise(Program* prog, int first_instruction);
+void _interp_update_in_place(Program* prog, int first_instruction, short slot);
+void _interp_move_dead_copies(Program* prog, int first_instruction);
+void _interp_release_dead_variables(Program* prog, int first_instruction);
+void _interp_remove_dead_stores(Program* prog, int first_instruction);
+void _statement_uses(Program* prog, int start, int end, bool* used);
+bool _interp_is_dead_after(Program* prog, short slot, int from);
+bool _reads_variable(instruction* instr, short slot);
+bool _interp_run_fused(Program* prog, int fused_instruction, nlab_array* dest);
+void _interp_assign_registers(Program* prog, int first_instruction);
+void _interp_reserve_registers(Program* prog, int count);
+bool _interp_run_registers(Program* prog, int header);
+void _release_registers(nlab_register* registers, int count);
+bool _stack_effect(instruction* instr, int* pops, int* pushes);
+bool _interp_set_is_balanced(Program* prog, int first_instruction, int end);
+int _interp_set_start(Program* prog, int set_end);
+bool _interp_sets_balanced(Program* prog, int end);
+void _interp_hoist_invariants(Program* prog, int loop_begin);
+void _interp_share_subexpressions(Program* prog, int first_instruction);
+bool _same_expression(expression_node* nodes, int* canon, int a, int b);
+void _interp_drop_cached(Program* prog);
+void _interp_fold_constants(Program* prog, int first_instruction);
+shape_check _interp_check_shapes(Program* prog, int first_instruction);
+shape_check _shapes_run(Program* prog, static_state* st, int from, int to);
+shape_check _shapes_loop(Program* prog, static_state* st, instruction* loop_begin, int body);
+shape_check _shapes_step(Program* prog, static_state* st, instruction* instr);
+shape_check _shapes_operator(Program* prog, static_state* st, instruction* instr);
+shape_check _shapes_mismatch(Program* prog, instruction* instr, const char* why, static_value* a, static_value* b);
+bool _static_vars_equal(static_state* a, static_state* b);
+bool _arr_file_shape(char* token, unsigned int* rows, unsigned int* cols);
+void _fused_load(nlab_array* source, unsigned int y, unsigned int first_col, int n, int* out);
+void _fused_binop(binary_op operation_type, int* out, int* lhs, int* rhs, int n);
+void _fused_binop_scalar(binary_op operation_type, int* out, int* lhs, int value, int n);
+nlab_array* _unop_not(nlab_array* operand);
+simd_op _simd_op(binary_op operation_type);
+nlab_array* _bool_fill(nlab_array* shape, bool value);
+nlab_array* _binop_scalar_bool(int value, nlab_array* vector, binary_op operation_type);
 nlab_array* _binop_scalar_vector(nlab_array* scalar, nlab_array* vector, binary_op operation_type);
+nlab_array* _binop_bool_bool(nlab_array* v1, nlab_array* v2, binary_op operation_type);
 nlab_array* _binop_vector_vector(nlab_array* v1, nlab_array* v2, binary_op operation_type);
 nlab_array* _binop_scalar_scalar(nlab_array* s1, nlab_array* s2, binary_op operation_type);
 bool _evaluate_operation(Program* prog);
-char* _interp_get_var_context(Program* prog);
 
 /* EXTENSION FUNCTIONS */
 #ifdef EXTENSION
 bool extension_u_trace(Program* prog);
 bool extension_u_transpose(Program* prog);
 bool extension_u_submatrix(Program* prog);
+bool extension_u_lifestep(Program* prog);
 bool extension_b_dotproduct(Program* prog);
 bool extension_b_power(Program* prog);
+nlab_array* _matrix_power(nlab_array* base, unsigned int power, unsigned int modulus);
+nlab_array* _matrix_multiply(nlab_array* m1, nlab_array* m2, unsigned int modulus);
+nlab_array* _apply_trace(nlab_array** operands, int operation_type);
+nlab_array* _apply_transpose(nlab_array** operands, int operation_type);
+nlab_array* _apply_lifestep(nlab_array** operands, int operation_type);
+nlab_array* _apply_power(nlab_array** operands, int operation_type);
 #endif
 
 /* TEST INTERPRETER FUNCTIONS */
 void test_interp_print_variable(void);
 void test_interp_print_string(void);
 void test_interp_set(void);
-void test_interp_get_var_context(void);
 void test_interp_u_not(void);
 void test_interp_u_eightcount(void);
 void test_interp_b_and(void);
@@ -160,12 +364,27 @@ void test_interp_loop(void);
 void test_binop_scalar_vector(void);
 void test_binop_vector_vector(void);
 void test_binop_scalar_scalar(void);
+void test_binop_bool(void);
+void test_interp_execute(void);
+void test_interp_arena(void);
+void test_interp_fused(void);
+void test_interp_hoist(void);
+int _count_ops(Program* prog, opcode op);
+void test_interp_cse(void);
+void test_interp_shapes(void);
+void test_interp_in_place(void);
+void test_interp_move(void);
+void test_interp_registers(void);
+void test_interp_release(void);
+void test_interp_dead_stores(void);
 
 /* TEST EXTENSION FUNCTIONS */
 #ifdef EXTENSION
 void test_extension_u_trace(void);
 void test_extension_u_transpose(void);
 void test_extension_u_submatrix(void);
+void test_extension_u_lifestep(void);
 void test_extension_b_dotproduct(void);
 void test_extension_b_power(void);
+void test_extension_until_stable(void);
 #endif
@@ -1,5 +1,12 @@
 #include "specific.h"
 
+// the arena new buffers and handles are bumped from (NULL for the heap), a
+// tally of the kinds of allocation - see nlab_array_use_arena() - and the
+// pool of freed heap buffers and handles
+arena* _nlab_arena = NULL;
+nlab_alloc_counts _nlab_counts = {0, 0, 0, 0, 0, 0, 0, 0};
+nlab_pool _nlab_pool;
+
 nlab_array* nlab_array_create_1d(unsigned int val){
     return _nlab_array_create(1, 1, val);
 }
@@ -8,91 +15,732 @@ nlab_array* nlab_array_create_ones(unsigned int rows, unsigned int cols){
     return _nlab_array_create(rows, cols, 1);
 }
 
-nlab_array* _nlab_array_create(unsigned int rows, unsigned int cols, unsigned int val){
-    short num_maps;
+nlab_array* nlab_array_create_zeros(unsigned int rows, unsigned int cols){
+    return _nlab_array_create(rows, cols, 0);
+}
+
+nlab_array* nlab_array_create_uninit(unsigned int rows, unsigned int cols){
+
+    nlab_array* nlab;
 
     if(rows == 0 || cols == 0){
         return NULL;
     }
 
-    num_maps = 1;
-    
-    nlab_array* nlab = (nlab_array*) calloc(sizeof(nlab_array), num_maps);
-    
+    nlab = _nlab_array_new_handle();
+    _nlab_array_alloc_data(nlab, rows, cols);
+    return nlab;
+}
+
+nlab_array* nlab_array_create_bool(unsigned int rows, unsigned int cols){
+
+    nlab_array* nlab;
+
+    if(rows == 0 || cols == 0){
+        return NULL;
+    }
+
+    nlab = _nlab_array_new_handle();
+    _nlab_array_alloc_bits(nlab, rows, cols);
+    memset(nlab->bits, 0, _nlab_array_num_bytes(nlab));
+    return nlab;
+}
+
+nlab_array* _nlab_array_create(unsigned int rows, unsigned int cols, unsigned int val){
+
+    nlab_array* nlab = nlab_array_create_uninit(rows, cols);
+
     if(nlab == NULL){
-        fprintf(stderr, "Memory error - cannot calloc space for nlab array\n");
-        exit(EXIT_FAILURE);
+        return NULL;
     }
 
-    nlab->cols = cols;
-    nlab->rows = rows;
-    nlab->array = (int**) calloc(sizeof(int*), (nlab->cols * nlab->rows));
+    // fill the row padding too, so whole-buffer copies never read uninitialised memory
+    for(size_t i = 0; i < (size_t) nlab->rows * nlab->stride; i++){
+        nlab->data[i] = val;
+    }
 
-    if(nlab->array == NULL){
-        fprintf(stderr, "Memory error - cannot calloc space for nlab array\n");
-        exit(EXIT_FAILURE);
+    return nlab;
+}
+
+/*
+    Copies are cheap: the new handle shares the element buffer and bumps its
+    reference count. The buffer is only cloned when one of the sharers writes
+    to it (see nlab_array_make_writable()), so stacks and maps can hand arrays
+    to each other without duplicating the elements.
+*/
+nlab_array* nlab_array_copy(nlab_array* d){
+
+    nlab_array* copy_d;
+
+    if(d == NULL){
+        return NULL;
+    }
+
+    copy_d = _nlab_array_new_handle();
+    _nlab_array_share_data(copy_d, d);
+    return copy_d;
+}
+
+// deep copy - the clone owns its own buffer
+nlab_array* nlab_array_clone(nlab_array* d){
+
+    nlab_array* clone_d;
+
+    if(d == NULL){
+        return NULL;
+    }
+
+    if(d->is_view){
+        return _nlab_array_flatten(d);
+    }
+
+    clone_d = _nlab_array_new_handle();
+    if(d->kind == nlab_bool){
+        _nlab_array_alloc_bits(clone_d, d->rows, d->cols);
+        memcpy(clone_d->bits, d->bits, _nlab_array_num_bytes(d));
+    } else{
+        _nlab_array_alloc_data(clone_d, d->rows, d->cols);
+        // both buffers share the same stride, so copy every row in one go
+        memcpy(clone_d->data, d->data, _nlab_array_num_bytes(d));
+    }
+
+    return clone_d;
+}
+
+// an nlab_int array with the same values - shares d's buffer if it's already unpacked
+nlab_array* nlab_array_to_int(nlab_array* d){
+
+    nlab_array* int_d;
+    uint64_t* in;
+    int* out;
+
+    if(d != NULL && d->is_view){
+        return _nlab_array_flatten(d);
+    }
+    if(d == NULL || d->kind == nlab_int){
+        return nlab_array_copy(d);
+    }
+
+    int_d = nlab_array_create_zeros(d->rows, d->cols);
+
+    for(unsigned int y = 0; y < d->rows; y++){
+        in = NLAB_BITS_ROW(d, y);
+        out = NLAB_ROW(int_d, y);
+        for(unsigned int x = 0; x < d->cols; x++){
+            out[x] = (int) ((in[x / NLAB_BITS_PER_WORD] >> (x % NLAB_BITS_PER_WORD)) & 1u);
+        }
+    }
+
+    return int_d;
+}
+
+// widens a packed array (or lays out a view) in place, e.g. a stack slot about
+// to be handed to an int-only kernel
+void nlab_array_unpack(nlab_array* narr){
+
+    nlab_array* int_narr;
+
+    if(narr == NULL || (narr->kind == nlab_int && !narr->is_view)){
+        return;
     }
 
+    int_narr = nlab_array_to_int(narr);
+    _nlab_array_take(narr, int_narr);
+}
+
+bool nlab_array_is_shared(nlab_array* narr){
+    return narr != NULL && narr->block != NULL && narr->block->refcount > 1;
+}
+
+// copy-on-write: give this handle a private buffer before it's written to
+void nlab_array_make_writable(nlab_array* narr){
+
+    nlab_array* clone;
+
+    if(narr != NULL && narr->is_view){
+        nlab_array_materialize(narr);
+        return;
+    }
+    if(!nlab_array_is_shared(narr)){
+        return;
+    }
+
+    clone = nlab_array_clone(narr);
+    _nlab_array_take(narr, clone);
+}
+
+void nlab_array_free(nlab_array* narr){
+    if(narr == NULL){
+        return;
+    }
+    _nlab_array_free_data(narr);
+    _nlab_array_free_handle(narr);
+}
+
+int nlab_array_get(nlab_array* narr, unsigned int y, unsigned int x){
+    assert(narr != NULL && y < narr->rows && x < narr->cols);
+    if(narr->kind == nlab_bool){
+        return NLAB_BIT(narr, y, x);
+    }
+    if(narr->is_view){
+        return NLAB_VIEW_AT(narr, y, x);
+    }
+    return NLAB_ROW(narr, y)[x];
+}
+
+/*
+    Whether a and b hold the same values in the same shape, whatever their kind
+    or layout. Handles sharing a buffer are equal without looking at it - a
+    write would have given one of them its own (see nlab_array_make_writable()).
+    Otherwise a row is compared at a time where both are laid out alike, packed
+    ones a word (64 elements) at a time, as their row padding is always zero.
+*/
+bool nlab_array_equal(nlab_array* a, nlab_array* b){
+
+    unsigned int words;
+
+    if(a == NULL || b == NULL){
+        return a == b;
+    }
+    if(a->rows != b->rows || a->cols != b->cols){
+        return false;
+    }
+    if(a->block != NULL && a->block == b->block && !a->is_view && !b->is_view && a->kind == b->kind){
+        return true;
+    }
 
-    for(unsigned int y = 0; y < nlab->rows; y++){
-        nlab->array[y] = (int*) calloc(sizeof(int), nlab->cols);
-            if(nlab->array[y] == NULL){
-                fprintf(stderr, "Memory error - cannot calloc space for nlab array\n");
-                exit(EXIT_FAILURE);
+    if(a->kind == nlab_bool && b->kind == nlab_bool){
+        words = (a->cols + NLAB_BITS_PER_WORD - 1) / NLAB_BITS_PER_WORD;
+        for(unsigned int y = 0; y < a->rows; y++){
+            if(memcmp(NLAB_BITS_ROW(a, y), NLAB_BITS_ROW(b, y), sizeof(uint64_t) * words) != 0){
+                return false;
             }
-        for(unsigned int x = 0; x < nlab->cols; x++){
-            nlab->array[y][x] = val;
         }
+        return true;
+    }
+    if(a->kind == nlab_int && b->kind == nlab_int && !a->is_view && !b->is_view && !a->is_inline && !b->is_inline){
+        for(unsigned int y = 0; y < a->rows; y++){
+            if(memcmp(NLAB_ROW(a, y), NLAB_ROW(b, y), sizeof(int) * a->cols) != 0){
+                return false;
+            }
+        }
+        return true;
     }
 
-    return nlab;
+    for(unsigned int y = 0; y < a->rows; y++){
+        for(unsigned int x = 0; x < a->cols; x++){
+            if(nlab_array_get(a, y, x) != nlab_array_get(b, y, x)){
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
 /*
-    These nlab_arry data structures will be pass-by-value rather than reference,
-    otherwise the pointers get tangled up (SEGV) when trying to free both maps 
-    and stacks as they point to the same memory addresses.
+    Both views are O(1): the handle shares d's buffer and only describes a
+    different walk over it. A packed d is widened first, as views index ints.
 */
-nlab_array* nlab_array_copy(nlab_array* d){
-    
-    short num_arrays;
-    nlab_array* copy_d;
+nlab_array* nlab_array_transpose_view(nlab_array* d){
+
+    nlab_array* view;
+    unsigned int swap;
 
     if(d == NULL){
         return NULL;
     }
 
-    num_arrays = 1;
+    view = d->kind == nlab_bool ? nlab_array_to_int(d) : nlab_array_copy(d);
+    // a scalar is its own transpose
+    if(view->is_inline){
+        return view;
+    }
+    if(!view->is_view){
+        view->is_view = true;
+        view->col_stride = 1;
+        view->skip_row = view->skip_col = NLAB_NO_SKIP;
+    }
+
+    // walking the rows of the view walks the columns of d, and vice versa
+    swap = view->rows;
+    view->rows = view->cols;
+    view->cols = swap;
+    swap = view->stride;
+    view->stride = view->col_stride;
+    view->col_stride = swap;
+    swap = view->skip_row;
+    view->skip_row = view->skip_col;
+    view->skip_col = swap;
+    return view;
+}
+
+// NULL if d doesn't have a row and column to spare
+nlab_array* nlab_array_submatrix_view(nlab_array* d, unsigned int rm_row, unsigned int rm_col){
+
+    nlab_array* view;
+
+    if(d == NULL || rm_row >= d->rows || rm_col >= d->cols || d->rows < 2 || d->cols < 2){
+        return NULL;
+    }
+
+    view = d->kind == nlab_bool ? nlab_array_to_int(d) : nlab_array_copy(d);
+    // a view can only skip one row and one column, so a submatrix of a submatrix is laid out first
+    if(view->is_view && (view->skip_row != NLAB_NO_SKIP || view->skip_col != NLAB_NO_SKIP)){
+        nlab_array_materialize(view);
+    }
+    if(!view->is_view){
+        view->is_view = true;
+        view->col_stride = 1;
+    }
+
+    view->rows--;
+    view->cols--;
+    view->skip_row = rm_row;
+    view->skip_col = rm_col;
+    return view;
+}
+
+bool nlab_array_is_view(nlab_array* narr){
+    return narr != NULL && narr->is_view;
+}
+
+// replaces a view with a contiguous copy of its elements. Other handles on the
+// source buffer are untouched
+void nlab_array_materialize(nlab_array* narr){
+
+    nlab_array* flat;
+
+    if(!nlab_array_is_view(narr)){
+        return;
+    }
+
+    flat = _nlab_array_flatten(narr);
+    _nlab_array_take(narr, flat);
+}
+
+arena* nlab_array_use_arena(arena* a){
+
+    arena* previous = _nlab_arena;
+
+    _nlab_arena = a;
+    return previous;
+}
+
+// whether narr's buffer (or its view's source) was bumped from a
+bool nlab_array_in_arena(nlab_array* narr, arena* a){
+    return narr != NULL && narr->block != NULL && a != NULL && narr->block->owner == a;
+}
+
+// gives narr a heap buffer of its own if its current one is in a, which is about to be reset
+void nlab_array_move_out_of(nlab_array* narr, arena* a){
 
-    copy_d = (nlab_array*) calloc(sizeof(nlab_array), num_arrays);
+    arena* previous;
 
-    if(copy_d == NULL){
-        fprintf(stderr, "Memory error - cannot malloc() space for nlab array");
+    if(!nlab_array_in_arena(narr, a)){
+        return;
+    }
+
+    previous = nlab_array_use_arena(NULL);
+    _nlab_array_take(narr, nlab_array_clone(narr));
+    nlab_array_use_arena(previous);
+}
+
+bool nlab_array_assign(nlab_array* dest, nlab_array* src){
+
+    if(dest != NULL && src != NULL && dest->is_inline && src->kind == nlab_int && src->rows == 1 && src->cols == 1){
+        dest->scalar = nlab_array_get(src, 0, 0);
+        return true;
+    }
+
+    if(dest == NULL || src == NULL || dest->block == NULL || dest->block == src->block
+    || dest->is_view || src->is_view || nlab_array_is_shared(dest) || dest->block->owner != NULL
+    || dest->kind != src->kind || dest->rows != src->rows || dest->cols != src->cols){
+        return false;
+    }
+
+    // same kind and shape, so the same stride - row padding included
+    if(dest->kind == nlab_bool){
+        memcpy(dest->bits, src->bits, _nlab_array_num_bytes(src));
+    } else{
+        memcpy(dest->data, src->data, _nlab_array_num_bytes(src));
+    }
+    return true;
+}
+
+nlab_alloc_counts nlab_array_alloc_counts(void){
+    return _nlab_counts;
+}
+
+void _nlab_count_bytes(size_t* bytes, size_t* peak, size_t num_bytes){
+    *bytes += num_bytes;
+    *peak = *bytes > *peak ? *bytes : *peak;
+}
+
+size_t nlab_array_arena_bytes(unsigned int rows, unsigned int cols){
+
+    size_t stride;
+
+    if(rows == 1 && cols == 1){
+        return ARENA_ROUND_UP(sizeof(nlab_handle));
+    }
+    stride = ((cols + NLAB_INTS_PER_LINE - 1) / NLAB_INTS_PER_LINE) * NLAB_INTS_PER_LINE;
+    return ARENA_ROUND_UP(sizeof(nlab_handle))
+         + ARENA_ROUND_UP(sizeof(nlab_block) + NLAB_ALIGNMENT + sizeof(int) * (size_t) rows * stride);
+}
+
+void nlab_array_set(nlab_array* narr, unsigned int y, unsigned int x, int val){
+
+    uint64_t mask;
+
+    assert(narr != NULL && y < narr->rows && x < narr->cols);
+
+    // anything other than 0/1 can't be held in a packed array
+    if(narr->kind == nlab_bool && val != 0 && val != 1){
+        nlab_array_unpack(narr);
+    }
+    nlab_array_make_writable(narr);
+
+    if(narr->kind == nlab_bool){
+        mask = (uint64_t) 1 << (x % NLAB_BITS_PER_WORD);
+        if(val){
+            NLAB_BITS_ROW(narr, y)[x / NLAB_BITS_PER_WORD] |= mask;
+        } else{
+            NLAB_BITS_ROW(narr, y)[x / NLAB_BITS_PER_WORD] &= ~mask;
+        }
+    } else{
+        NLAB_ROW(narr, y)[x] = val;
+    }
+}
+
+void _nlab_array_alloc_data(nlab_array* narr, unsigned int rows, unsigned int cols){
+
+    narr->rows = rows;
+    narr->cols = cols;
+    narr->kind = nlab_int;
+    narr->is_view = false;
+    narr->bits = NULL;
+
+    // scalars (literals, loop counters, ...) need no buffer at all
+    narr->is_inline = rows == 1 && cols == 1;
+    if(narr->is_inline){
+        narr->stride = 1;
+        narr->block = NULL;
+        narr->data = &narr->scalar;
+        return;
+    }
+
+    // round each row up to a whole cache line
+    narr->stride = ((cols + NLAB_INTS_PER_LINE - 1) / NLAB_INTS_PER_LINE) * NLAB_INTS_PER_LINE;
+    narr->bits = NULL;
+    narr->data = (int*) _nlab_array_alloc_block(narr, sizeof(int));
+}
+
+void _nlab_array_alloc_bits(nlab_array* narr, unsigned int rows, unsigned int cols){
+
+    unsigned int words_per_row;
+
+    narr->rows = rows;
+    narr->cols = cols;
+    narr->kind = nlab_bool;
+    narr->is_view = false;
+    narr->is_inline = false;
+    words_per_row = (cols + NLAB_BITS_PER_WORD - 1) / NLAB_BITS_PER_WORD;
+    narr->stride = ((words_per_row + NLAB_WORDS_PER_LINE - 1) / NLAB_WORDS_PER_LINE) * NLAB_WORDS_PER_LINE;
+    narr->data = NULL;
+    narr->bits = (uint64_t*) _nlab_array_alloc_block(narr, sizeof(uint64_t));
+}
+
+// allocates rows*stride units for narr, and returns the aligned start of them
+void* _nlab_array_alloc_block(nlab_array* narr, size_t unit_size){
+
+    size_t num_bytes, header_bytes;
+    uintptr_t misalignment;
+    char* first_byte;
+
+    header_bytes = sizeof(nlab_block) + NLAB_ALIGNMENT;
+
+    if(narr->stride == 0 || (size_t) narr->rows > (SIZE_MAX - header_bytes) / unit_size / narr->stride){
+        fprintf(stderr, "Memory error - nlab array of %u x %u is too large\n", narr->rows, narr->cols);
         exit(EXIT_FAILURE);
     }
 
-    copy_d->cols = d->cols;
-    copy_d->rows = d->rows;
-    copy_d->array = (int**) calloc(sizeof(int*), (d->cols * d->rows));
-    if(copy_d->array == NULL){
-        fprintf(stderr, "Memory error - cannot malloc() space for nlab array");
+    // over-allocate so the start of the elements can be aligned by hand (C99 has no aligned_alloc)
+    num_bytes = unit_size * (size_t) narr->rows * narr->stride;
+    if(_nlab_arena != NULL){
+        narr->block = (nlab_block*) arena_alloc(_nlab_arena, header_bytes + num_bytes);
+        _nlab_counts.arena++;
+    } else{
+        narr->block = _nlab_pool_take(header_bytes + num_bytes);
+        if(narr->block == NULL){
+            narr->block = (nlab_block*) malloc(header_bytes + num_bytes);
+            _nlab_counts.heap++;
+            _nlab_count_bytes(&_nlab_counts.held_bytes, &_nlab_counts.peak_held_bytes, header_bytes + num_bytes);
+        }
+        _nlab_count_bytes(&_nlab_counts.live_bytes, &_nlab_counts.peak_live_bytes, header_bytes + num_bytes);
+    }
+
+    if(narr->block == NULL){
+        fprintf(stderr, "Memory error - cannot calloc space for nlab array\n");
         exit(EXIT_FAILURE);
     }
 
-    for(unsigned int y = 0; y < copy_d->rows; y++){
-        copy_d->array[y] = (int*) calloc(sizeof(int), (d->cols));
-        for(unsigned int x = 0; x < copy_d->cols; x++){
-            copy_d->array[y][x] = d->array[y][x];
+    narr->block->refcount = 1;
+    narr->block->owner = _nlab_arena;
+    narr->block->num_bytes = header_bytes + num_bytes;
+
+    first_byte = (char*) narr->block + sizeof(nlab_block);
+    misalignment = (uintptr_t) first_byte % NLAB_ALIGNMENT;
+    return first_byte + (misalignment == 0 ? 0 : NLAB_ALIGNMENT - misalignment);
+}
+
+void _nlab_array_share_data(nlab_array* dest, nlab_array* src){
+    _nlab_array_copy_struct(dest, src);
+    if(dest->block != NULL){
+        dest->block->refcount++;
+    }
+}
+
+// a plain struct copy, except that an inline scalar's data points at its own copy
+void _nlab_array_copy_struct(nlab_array* dest, nlab_array* src){
+    *dest = *src;
+    _nlab_array_fix_inline(dest);
+}
+
+// for after narr has been moved in memory some other way, e.g. by realloc()
+void _nlab_array_fix_inline(nlab_array* narr){
+    if(narr->is_inline){
+        narr->data = &narr->scalar;
+    }
+}
+
+// drops this handle's reference, and frees the buffer when it was the last one
+void _nlab_array_free_data(nlab_array* narr){
+    if(narr == NULL){
+        return;
+    }
+    if(narr->is_inline){
+        narr->is_inline = false;
+        narr->data = NULL;
+        return;
+    }
+    if(narr->block == NULL){
+        return;
+    }
+
+    narr->block->refcount--;
+    if(narr->block->refcount == 0 && narr->block->owner == NULL){
+        _nlab_counts.live_bytes -= narr->block->num_bytes;
+        if(!_nlab_pool_give(narr->block)){
+            _nlab_counts.held_bytes -= narr->block->num_bytes;
+            free(narr->block);
         }
     }
-    return copy_d;
+    narr->block = NULL;
+    narr->data = NULL;
+    narr->bits = NULL;
 }
 
+// zeroes the unused bits at the end of every row of a packed array, after a
+// word-at-a-time kernel (e.g. NOT) may have set them
+void _nlab_array_clear_bit_padding(nlab_array* narr){
+
+    unsigned int last_word, used_bits;
+    uint64_t* row;
+
+    if(narr == NULL || narr->kind != nlab_bool){
+        return;
+    }
+
+    last_word = (narr->cols - 1) / NLAB_BITS_PER_WORD;
+    used_bits = narr->cols - (last_word * NLAB_BITS_PER_WORD);
 
-void nlab_array_free(nlab_array* narr){
     for(unsigned int y = 0; y < narr->rows; y++){
-        FREE_AND_NULL(narr->array[y]);
+        row = NLAB_BITS_ROW(narr, y);
+        if(used_bits < NLAB_BITS_PER_WORD){
+            row[last_word] &= ((uint64_t) 1 << used_bits) - 1;
+        }
+        for(unsigned int w = last_word + 1; w < narr->stride; w++){
+            row[w] = 0;
+        }
+    }
+}
+
+size_t _nlab_array_num_bytes(nlab_array* narr){
+    if(narr->kind == nlab_bool){
+        return sizeof(uint64_t) * (size_t) narr->rows * narr->stride;
+    }
+    return sizeof(int) * (size_t) narr->rows * narr->stride;
+}
+
+// a contiguous int copy of view, copied a tile at a time
+nlab_array* _nlab_array_flatten(nlab_array* view){
+
+    nlab_array* flat;
+    unsigned int y_end, x_end;
+    int* out;
+
+    flat = nlab_array_create_uninit(view->rows, view->cols);
+
+    for(unsigned int ty = 0; ty < view->rows; ty += NLAB_VIEW_TILE){
+        y_end = (view->rows - ty) < NLAB_VIEW_TILE ? view->rows : ty + NLAB_VIEW_TILE;
+        for(unsigned int tx = 0; tx < view->cols; tx += NLAB_VIEW_TILE){
+            x_end = (view->cols - tx) < NLAB_VIEW_TILE ? view->cols : tx + NLAB_VIEW_TILE;
+            for(unsigned int y = ty; y < y_end; y++){
+                out = NLAB_ROW(flat, y);
+                for(unsigned int x = tx; x < x_end; x++){
+                    out[x] = NLAB_VIEW_AT(view, y, x);
+                }
+            }
+        }
+    }
+
+    // keep the row padding defined, as for every other int array
+    for(unsigned int y = 0; y < flat->rows; y++){
+        memset(NLAB_ROW(flat, y) + flat->cols, 0, sizeof(int) * (flat->stride - flat->cols));
+    }
+
+    return flat;
+}
+
+nlab_array* _nlab_array_new_handle(void){
+
+    short num_arrays;
+    nlab_handle* handle;
+
+    num_arrays = 1;
+
+    if(_nlab_arena != NULL){
+        handle = (nlab_handle*) arena_alloc(_nlab_arena, sizeof(nlab_handle));
+        memset(handle, 0, sizeof(nlab_handle));
+        handle->in_arena = true;
+        _nlab_counts.arena++;
+    } else if(_nlab_pool.free_handles != NULL){
+        handle = _nlab_pool.free_handles;
+        _nlab_pool.free_handles = handle->next_free;
+        _nlab_pool.num_handles--;
+        memset(handle, 0, sizeof(nlab_handle));
+    } else{
+        handle = (nlab_handle*) calloc(sizeof(nlab_handle), num_arrays);
+        _nlab_counts.heap++;
     }
-    FREE_AND_NULL(narr->array);
-    FREE_AND_NULL(narr);
+
+    if(handle == NULL){
+        fprintf(stderr, "Memory error - cannot calloc space for nlab array\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return &handle->array;
+}
+
+void _nlab_array_free_handle(nlab_array* narr){
+
+    nlab_handle* handle;
+
+    if(narr == NULL){
+        return;
+    }
+
+    handle = NLAB_HANDLE_OF(narr);
+    if(handle->in_arena){
+        return;
+    }
+    if(_nlab_pool.num_handles < NLAB_POOL_HANDLES){
+        handle->next_free = _nlab_pool.free_handles;
+        _nlab_pool.free_handles = handle;
+        _nlab_pool.num_handles++;
+        return;
+    }
+    free(handle);
+}
+
+// a pooled buffer of exactly num_bytes, or NULL if there isn't one
+nlab_block* _nlab_pool_take(size_t num_bytes){
+
+    nlab_pool_class* class;
+    nlab_block* block;
+
+    for(unsigned int c = 0; c < NLAB_POOL_CLASSES; c++){
+        class = &_nlab_pool.classes[c];
+        if(class->count > 0 && class->num_bytes == num_bytes){
+            block = class->free;
+            class->free = block->next_free;
+            class->count--;
+            _nlab_counts.pool_hits++;
+            return block;
+        }
+    }
+
+    _nlab_counts.pool_misses++;
+    return NULL;
+}
+
+// files block under its size. false if that size's class is full, and block should be freed
+bool _nlab_pool_give(nlab_block* block){
+
+    nlab_pool_class* class;
+    nlab_pool_class* empty;
+
+    empty = NULL;
+    for(unsigned int c = 0; c < NLAB_POOL_CLASSES; c++){
+        class = &_nlab_pool.classes[c];
+        if(class->count > 0 && class->num_bytes == block->num_bytes){
+            if(class->count >= NLAB_POOL_DEPTH){
+                return false;
+            }
+            empty = class;
+            break;
+        }
+        if(class->count == 0 && empty == NULL){
+            empty = class;
+        }
+    }
+
+    // every class holds some other size - the next in turn gives way
+    if(empty == NULL){
+        empty = &_nlab_pool.classes[_nlab_pool.next_victim];
+        _nlab_pool.next_victim = (_nlab_pool.next_victim + 1) % NLAB_POOL_CLASSES;
+        while(empty->free != NULL){
+            nlab_block* next = empty->free->next_free;
+            _nlab_counts.held_bytes -= empty->free->num_bytes;
+            free(empty->free);
+            empty->free = next;
+        }
+        empty->count = 0;
+    }
+
+    empty->num_bytes = block->num_bytes;
+    block->next_free = empty->free;
+    empty->free = block;
+    empty->count++;
+    return true;
+}
+
+void nlab_array_pool_drain(void){
+
+    nlab_block* next_block;
+    nlab_handle* next_handle;
+
+    for(unsigned int c = 0; c < NLAB_POOL_CLASSES; c++){
+        while(_nlab_pool.classes[c].free != NULL){
+            next_block = _nlab_pool.classes[c].free->next_free;
+            _nlab_counts.held_bytes -= _nlab_pool.classes[c].free->num_bytes;
+            free(_nlab_pool.classes[c].free);
+            _nlab_pool.classes[c].free = next_block;
+        }
+        _nlab_pool.classes[c].count = 0;
+    }
+
+    while(_nlab_pool.free_handles != NULL){
+        next_handle = _nlab_pool.free_handles->next_free;
+        free(_nlab_pool.free_handles);
+        _nlab_pool.free_handles = next_handle;
+    }
+    _nlab_pool.num_handles = 0;
+}
+
+// narr drops its buffer and takes over from's, and from's handle is freed
+void _nlab_array_take(nlab_array* narr, nlab_array* from){
+    _nlab_array_free_data(narr);
+    _nlab_array_copy_struct(narr, from);
+    _nlab_array_free_handle(from);
 }
@@ -1,12 +1,86 @@
 #pragma once
 
 #include "../general.h"
+#include "../arena/arena.h"
 
 typedef struct nlab_array nlab_array;
+typedef struct nlab_block nlab_block;
+
+/*
+    nlab_int arrays hold one int per element. Results of the logical operators
+    are only ever 0 or 1, so they're stored bit-packed as nlab_bool arrays.
+*/
+typedef enum nlab_kind {nlab_int, nlab_bool} nlab_kind;
+
+// malloc() calls made for array buffers and handles, against bumps of an arena,
+// and how often the pool of freed heap buffers could (hits) or couldn't (misses) supply one.
+// Heap buffer bytes are tallied too: those arrays are using, and those malloc()ed and not
+// yet freed (so including the pool's), with the most there have been of each at once
+typedef struct nlab_alloc_counts {
+    size_t heap;
+    size_t arena;
+    size_t pool_hits;
+    size_t pool_misses;
+    size_t live_bytes;
+    size_t peak_live_bytes;
+    size_t held_bytes;
+    size_t peak_held_bytes;
+} nlab_alloc_counts;
 
 nlab_array* nlab_array_create_1d(unsigned int val);
 nlab_array* nlab_array_create_ones(unsigned int rows, unsigned int cols);
+nlab_array* nlab_array_create_zeros(unsigned int rows, unsigned int cols);
+/* elements (including row padding) are left for the caller to fill */
+nlab_array* nlab_array_create_uninit(unsigned int rows, unsigned int cols);
+/* all bits start false */
+nlab_array* nlab_array_create_bool(unsigned int rows, unsigned int cols);
 /* _nlab_array_create() considered private - just a helper function*/
 nlab_array* _nlab_array_create(unsigned int rows, unsigned int cols, unsigned int val);
 nlab_array* nlab_array_copy(nlab_array* d);
+nlab_array* nlab_array_clone(nlab_array* d);
+nlab_array* nlab_array_to_int(nlab_array* d);
+void nlab_array_unpack(nlab_array* narr);
+bool nlab_array_is_shared(nlab_array* narr);
+/* views share d's buffer - see struct nlab_array. rm_row and rm_col are zero-based */
+nlab_array* nlab_array_transpose_view(nlab_array* d);
+nlab_array* nlab_array_submatrix_view(nlab_array* d, unsigned int rm_row, unsigned int rm_col);
+bool nlab_array_is_view(nlab_array* narr);
+void nlab_array_materialize(nlab_array* narr);
+/* new buffers and handles come from a (the heap if NULL) until the next call,
+   which is handed back the arena to restore. Arena memory is only taken back
+   by arena_reset(), so nothing made from it may outlive that - see
+   nlab_array_move_out_of() */
+arena* nlab_array_use_arena(arena* a);
+bool nlab_array_in_arena(nlab_array* narr, arena* a);
+void nlab_array_move_out_of(nlab_array* narr, arena* a);
+/* copies src's elements into dest's own buffer, if dest has one of the same shape */
+bool nlab_array_assign(nlab_array* dest, nlab_array* src);
+nlab_alloc_counts nlab_array_alloc_counts(void);
+/* arena bytes an int array of this shape takes, handle included - no less than a bool one */
+size_t nlab_array_arena_bytes(unsigned int rows, unsigned int cols);
+/* frees every buffer and handle held by the pool */
+void nlab_array_pool_drain(void);
+void nlab_array_make_writable(nlab_array* narr);
 void nlab_array_free(nlab_array* narr);
+int nlab_array_get(nlab_array* narr, unsigned int y, unsigned int x);
+void nlab_array_set(nlab_array* narr, unsigned int y, unsigned int x, int val);
+/* same shape and values, whether laid out, viewed or packed - two NULLs are equal */
+bool nlab_array_equal(nlab_array* a, nlab_array* b);
+nlab_array* _nlab_array_new_handle(void);
+void _nlab_array_free_handle(nlab_array* narr);
+void _nlab_array_take(nlab_array* narr, nlab_array* from);
+nlab_block* _nlab_pool_take(size_t num_bytes);
+bool _nlab_pool_give(nlab_block* block);
+void _nlab_count_bytes(size_t* bytes, size_t* peak, size_t num_bytes);
+/* _nlab_array_alloc_data() and _nlab_array_free_data() considered private - they only
+   manage the element buffer, so can be used on arrays held by-value in a stack */
+void _nlab_array_alloc_data(nlab_array* narr, unsigned int rows, unsigned int cols);
+void _nlab_array_alloc_bits(nlab_array* narr, unsigned int rows, unsigned int cols);
+void* _nlab_array_alloc_block(nlab_array* narr, size_t unit_size);
+void _nlab_array_share_data(nlab_array* dest, nlab_array* src);
+void _nlab_array_copy_struct(nlab_array* dest, nlab_array* src);
+void _nlab_array_fix_inline(nlab_array* narr);
+void _nlab_array_free_data(nlab_array* narr);
+void _nlab_array_clear_bit_padding(nlab_array* narr);
+size_t _nlab_array_num_bytes(nlab_array* narr);
+nlab_array* _nlab_array_flatten(nlab_array* view);
@@ -1,9 +1,109 @@
 #pragma once
 
+#include <stddef.h>
+
 #include "nlab_array.h"
+#include "../arena/specific.h"
+
+// rows are padded out to a whole number of cache lines so that every row starts aligned
+#define NLAB_ALIGNMENT 64
+#define NLAB_INTS_PER_LINE (NLAB_ALIGNMENT / sizeof(int))
+#define NLAB_WORDS_PER_LINE (NLAB_ALIGNMENT / sizeof(uint64_t))
+#define NLAB_BITS_PER_WORD 64
+
+#define NLAB_ROW(A, Y) ((A)->data + ((size_t) (Y) * (A)->stride))
+#define NLAB_BITS_ROW(A, Y) ((A)->bits + ((size_t) (Y) * (A)->stride))
+#define NLAB_BIT(A, Y, X) ((int) ((NLAB_BITS_ROW(A, Y)[(X) / NLAB_BITS_PER_WORD] >> ((X) % NLAB_BITS_PER_WORD)) & 1u))
+
+// a view's rows and columns step over the one skipped in its source, if any
+#define NLAB_NO_SKIP UINT_MAX
+#define NLAB_VIEW_INDEX(I, SKIP) ((size_t) (I) + ((I) >= (SKIP)))
+#define NLAB_VIEW_AT(A, Y, X) ((A)->data[NLAB_VIEW_INDEX(Y, (A)->skip_row) * (A)->stride \
+                                         + NLAB_VIEW_INDEX(X, (A)->skip_col) * (A)->col_stride])
+// views are copied out in square tiles, so a transposed read stays within a few cache lines
+#define NLAB_VIEW_TILE 32
+// how many sizes of freed buffer the pool keeps, how many of each, and how many spare handles
+#define NLAB_POOL_CLASSES 16
+#define NLAB_POOL_DEPTH 8
+#define NLAB_POOL_HANDLES 64
+
+typedef struct nlab_handle nlab_handle;
+
+/*
+    Header at the start of every element buffer. Handles that share a buffer
+    (stack slots, map values, copies) each hold one reference to it.
+*/
+struct nlab_block {
+    unsigned int refcount;
+    // the arena this buffer was bumped from, or NULL if it was malloc()ed. Arena
+    // buffers are never passed to free() - the arena is reset instead
+    arena* owner;
+    // size of the whole allocation, header included, and the next buffer
+    // of the same size while this one is waiting in the pool
+    size_t num_bytes;
+    nlab_block* next_free;
+};
+
+/*
+    Heap buffers whose last reference is dropped go back to the pool rather
+    than to free(), filed by size (so by kind, rows and cols), and are handed
+    out again as they are - the create functions all fill what they use. A
+    LOOP making the same shapes every time round then only malloc()s on its
+    first pass. There's one pool for the process (_nlab_pool), not one per
+    Program, so programs run side by side - as the tests do - share it, and
+    program_builder_free() draining it empties it for all of them.
+*/
+typedef struct nlab_pool_class {
+    size_t num_bytes;
+    unsigned int count;
+    nlab_block* free;
+} nlab_pool_class;
+
+typedef struct nlab_pool {
+    nlab_pool_class classes[NLAB_POOL_CLASSES];
+    // the class given up when a new size arrives and none is empty - taken in
+    // turn (round-robin), not by how long ago a class was claimed
+    unsigned int next_victim;
+    nlab_handle* free_handles;
+    unsigned int num_handles;
+} nlab_pool;
+
+/*
+    Handles are allocated with this header in front, so nlab_array_free() can
+    tell whether the handle came from an arena. It's kept out of nlab_array
+    itself because arrays are copied by value into stacks.
+*/
+#define NLAB_HANDLE_OF(A) ((nlab_handle*) ((char*) (A) - offsetof(nlab_handle, array)))
 
 struct nlab_array {
     unsigned int rows;
     unsigned int cols;
-    int** array;
+    nlab_kind kind;
+    // distance between the start of one row and the next - in ints for nlab_int
+    // arrays, in 64-bit words for nlab_bool arrays
+    unsigned int stride;
+    // one contiguous, row-major buffer, aligned inside block. Only the one matching
+    // kind is set; bool arrays hold one bit per element and keep row padding bits zero
+    int* data;
+    uint64_t* bits;
+    nlab_block* block;
+    // a view reads another int array's buffer in place, so U-TRANSPOSE and
+    // U-SUBMATRIX needn't copy. Element (y, x) is NLAB_VIEW_AT(), and the rows
+    // aren't contiguous, so nothing but nlab_array_get() may read ->data
+    // directly until nlab_array_materialize() has been called
+    bool is_view;
+    unsigned int col_stride;
+    unsigned int skip_row;
+    unsigned int skip_col;
+    // a 1x1 int array keeps its element here, with no buffer (block is NULL) -
+    // data points at scalar, so it's re-pointed whenever the struct is copied
+    bool is_inline;
+    int scalar;
+};
+
+struct nlab_handle {
+    bool in_arena;
+    // the next spare handle, while this one is in the pool
+    nlab_handle* next_free;
+    nlab_array array;
 };
@@ -0,0 +1,1099 @@
+#include "specific.h"
+
+const char* NLABC_OPCODE_NAMES[] = {
+    [op_print_var] = "op_print_var",
+    [op_print_string] = "op_print_string",
+    [op_push_var] = "op_push_var",
+    [op_push_int] = "op_push_int",
+    [op_unary] = "op_unary",
+    [op_binary] = "op_binary",
+    [op_set_end] = "op_set_end",
+    [op_create_ones] = "op_create_ones",
+    [op_create_read] = "op_create_read",
+    [op_loop_begin] = "op_loop_begin",
+    [op_loop_end] = "op_loop_end",
+    [op_fused] = "op_fused",
+    [op_invariant] = "op_invariant",
+    [op_cache_store] = "op_cache_store",
+    [op_cache_load] = "op_cache_load",
+    [op_in_place] = "op_in_place",
+    [op_move] = "op_move",
+    [op_registers] = "op_registers",
+    [op_release] = "op_release",
+    [op_until_stable] = "op_until_stable"
+};
+
+const char* NLABC_ERROR_NAMES[] = {
+    [error_none] = "error_none",
+    [error_io] = "error_io",
+    [error_parse] = "error_parse",
+    [error_interp] = "error_interp",
+    [error_unknown] = "error_unknown"
+};
+
+// the operators' kernels by their C names, so a compiled SET can call them directly
+const nlabc_kernel NLABC_KERNELS[] = {
+    {_apply_not, "_apply_not"},
+    {_apply_eightcount, "_apply_eightcount"},
+    {_apply_binary, "_apply_binary"},
+    #ifdef EXTENSION
+    {_apply_trace, "_apply_trace"},
+    {_apply_transpose, "_apply_transpose"},
+    {_apply_lifestep, "_apply_lifestep"},
+    {_apply_power, "_apply_power"},
+    #endif
+    {NULL, NULL}
+};
+
+void nlabc_emit(Program* prog, bool compiled, const char* source_name, FILE* out){
+
+    if(prog == NULL || out == NULL){
+        return;
+    }
+
+    _nlabc_emit_tables(prog, source_name, out);
+
+    if(compiled){
+        _nlabc_emit_variables(prog, out);
+        _nlabc_emit_run(prog, out);
+    }
+
+    fprintf(out, "int main(void){\n\n");
+    fprintf(out, "    Program* prog;\n\n");
+    fprintf(out, "    prog = nlabc_load(%s, %d, %s, %s, %d);\n",
+            prog->num_of_tokens > 0 ? "nlabc_tokens" : "NULL", prog->num_of_tokens,
+            compiled && prog->bytecode->size > 0 ? "nlabc_code" : "NULL",
+            compiled && prog->bytecode->size > 0 ? "nlabc_literals" : "NULL",
+            compiled ? prog->bytecode->size : 0);
+
+    if(compiled){
+        fprintf(out, "    finish_program(prog, nlabc_run(prog));\n");
+    } else{
+        // the error the compile stopped at, as ./extension would have reported it
+        fprintf(out, "    prog->error_state = %s;\n", NLABC_ERROR_NAMES[prog->error_state]);
+        if(strlen(prog->error_msg) != 0){
+            fprintf(out, "    set_error_msg(prog, ");
+            _nlabc_emit_string(prog->error_msg, out);
+            fprintf(out, ");\n");
+        }
+        fprintf(out, "    finish_program(prog, false);\n");
+    }
+    fprintf(out, "    return EXIT_SUCCESS;\n}\n");
+}
+
+void _nlabc_emit_tables(Program* prog, const char* source_name, FILE* out){
+
+    instruction* instr;
+
+    fprintf(out, "// compiled by nlabc from ");
+    _nlabc_emit_string(source_name == NULL ? "" : source_name, out);
+    fprintf(out, "\n#include \"src/nlabc/nlabc.h\"\n\n");
+
+    if(prog->num_of_tokens > 0){
+        fprintf(out, "char* nlabc_tokens[%d] = {\n", prog->num_of_tokens);
+        for(int i = 0; i < prog->num_of_tokens; i++){
+            fprintf(out, "    ");
+            _nlabc_emit_string(prog->tokens[i], out);
+            fprintf(out, "%s\n", i + 1 < prog->num_of_tokens ? "," : "");
+        }
+        fprintf(out, "};\n\n");
+    }
+
+    if(prog->bytecode == NULL || prog->bytecode->size == 0){
+        return;
+    }
+
+    // op, token, slot, operand, operand2, jump, loop, constant, copies
+    fprintf(out, "instruction nlabc_code[%d] = {\n", prog->bytecode->size);
+    for(int i = 0; i < prog->bytecode->size; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        fprintf(out, "    {%s, %d, %d, %d, %d, %d, %d, NULL, NULL}%s\n", NLABC_OPCODE_NAMES[instr->op], instr->token,
+                instr->slot, instr->operand, instr->operand2, instr->jump, instr->loop,
+                i + 1 < prog->bytecode->size ? "," : "");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "int nlabc_literals[%d] = {", prog->bytecode->size);
+    for(int i = 0; i < prog->bytecode->size; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        fprintf(out, "%s%d", i > 0 ? ", " : "", instr->op == op_push_int ? nlab_array_get(instr->constant, 0, 0) : 0);
+    }
+    fprintf(out, "};\n\n");
+}
+
+// each variable the program uses, as where the map keeps its value - nlabc_run() points them there
+void _nlabc_emit_variables(Program* prog, FILE* out){
+
+    bool used[NUM_OF_VARS];
+
+    _nlabc_variables_used(prog, used);
+    for(short slot = 0; slot < NUM_OF_VARS; slot++){
+        if(used[slot]){
+            fprintf(out, "nlab_array** nlabc_%c;\n", 'A' + slot);
+        }
+    }
+    fprintf(out, "\n");
+}
+
+void _nlabc_variables_used(Program* prog, bool* used){
+
+    instruction* instr;
+
+    for(int i = 0; i < NUM_OF_VARS; i++){
+        used[i] = false;
+    }
+    for(int i = 0; i < prog->bytecode->size; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if(instr->slot >= 0 && instr->slot < NUM_OF_VARS){
+            used[instr->slot] = true;
+        }
+    }
+}
+
+/*
+    A function for each SET that's compiled, then the run function, with one
+    statement (or a few) per instruction. The LOOPs' bookkeeping, strings and
+    literals are written out in C, and a SET is run by its own function - or,
+    for scalars, a line of C - once it's reached; anything these can't do
+    (including reporting an error) is left to _interp_step(). Anything that
+    can leave the line goes through the jump table at the bottom, which
+    returns once the run fails or goes past the last instruction.
+*/
+void _nlabc_emit_run(Program* prog, FILE* out){
+
+    int size = prog->bytecode->size;
+    int max_vars, start;
+    int* scalar_sets;
+    int* array_sets;
+    bool used[NUM_OF_VARS];
+
+    scalar_sets = _nlabc_find_scalar_sets(prog, &max_vars);
+    array_sets = _nlabc_find_array_sets(prog);
+    for(int pc = 0; pc < size; pc++){
+        if(array_sets[pc] != NLABC_NOT_COMPILED){
+            _nlabc_emit_array_set(prog, pc, array_sets[pc], out);
+        }
+    }
+
+    fprintf(out, "bool nlabc_run(Program* prog){\n\n");
+    if(_nlabc_uses_code(prog)){
+        fprintf(out, "    instruction* code = bytecode_at(prog->bytecode, 0);\n");
+    }
+    fprintf(out, "    int pc;\n");
+    if(max_vars > 0){
+        fprintf(out, "    int v[%d];\n", max_vars);
+    }
+    fprintf(out, "\n");
+    _nlabc_variables_used(prog, used);
+    for(short slot = 0; slot < NUM_OF_VARS; slot++){
+        if(used[slot]){
+            fprintf(out, "    nlabc_%c = map_slot_by_code(prog->variable_map, %d);\n", 'A' + slot, slot);
+        }
+    }
+    fprintf(out, "\n");
+
+    for(int pc = 0; pc <= size; pc++){
+        start = pc > 0 && bytecode_at(prog->bytecode, pc - 1)->op == op_set_end ? _interp_set_start(prog, pc - 1) : 0;
+        if(_nlabc_is_jump_target(prog, pc)
+        || (pc > 0 && bytecode_at(prog->bytecode, pc - 1)->op == op_set_end
+            && (scalar_sets[start] == pc - 1 || array_sets[start] == pc - 1))){
+            fprintf(out, "L%d:\n", pc);
+        }
+        if(pc < size && scalar_sets[pc] != NLABC_NOT_COMPILED){
+            _nlabc_emit_scalar_set(prog, pc, scalar_sets[pc], out);
+        }
+        if(pc < size && array_sets[pc] != NLABC_NOT_COMPILED){
+            fprintf(out, "    // %d-%d: SET, compiled\n", pc, array_sets[pc]);
+            fprintf(out, "    if(prog->polish_stack->size == 0 && nlabc_set_%d(prog)){\n", pc);
+            fprintf(out, "        goto L%d;\n", array_sets[pc] + 1);
+            fprintf(out, "    }\n");
+        }
+        if(pc < size){
+            _nlabc_emit_instruction(prog, pc, out);
+        }
+    }
+    free(scalar_sets);
+    free(array_sets);
+
+    fprintf(out, "    pc = %d;\n", size);
+    fprintf(out, "    goto jump;\n");
+    fprintf(out, "jump:\n");
+    fprintf(out, "    switch(pc){\n");
+    for(int pc = 0; pc < size; pc++){
+        if(_nlabc_is_jump_target(prog, pc)){
+            fprintf(out, "        case %d: goto L%d;\n", pc, pc);
+        }
+    }
+    fprintf(out, "        case NO_JUMP:\n");
+    fprintf(out, "            nlab_array_use_arena(NULL);\n");
+    fprintf(out, "            return false;\n");
+    fprintf(out, "        default:\n");
+    fprintf(out, "            nlab_array_use_arena(NULL);\n");
+    fprintf(out, "            return true;\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "}\n\n");
+}
+
+// whether the run function reads or updates any of the instructions themselves
+bool _nlabc_uses_code(Program* prog){
+
+    opcode op;
+
+    for(int i = 0; i < prog->bytecode->size; i++){
+        op = bytecode_at(prog->bytecode, i)->op;
+        if(op == op_loop_begin || op == op_invariant || op == op_until_stable){
+            return true;
+        }
+    }
+    return false;
+}
+
+// indexed by the first instruction of each SET, the op_set_end of those that can be worked out in C
+int* _nlabc_find_scalar_sets(Program* prog, int* max_vars){
+
+    int size = prog->bytecode->size;
+    int* scalar_sets;
+    char expression[NLABC_MAX_EXPRESSION];
+    int start, num_vars;
+    instruction* instr;
+
+    scalar_sets = _nlabc_new_sets(size);
+    *max_vars = 0;
+    for(int i = 0; i < size; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if(instr->op != op_set_end || instr->slot < 0 || instr->slot >= NUM_OF_VARS){
+            continue;
+        }
+        start = _interp_set_start(prog, i);
+        if(_nlabc_scalar_expression(prog, start, i, expression, &num_vars)){
+            scalar_sets[start] = i;
+            *max_vars = num_vars > *max_vars ? num_vars : *max_vars;
+        }
+    }
+    return scalar_sets;
+}
+
+// as _nlabc_find_scalar_sets(), for the SETs compiled to a function of their own
+int* _nlabc_find_array_sets(Program* prog){
+
+    int size = prog->bytecode->size;
+    int* array_sets;
+    nlabc_expression* expr;
+    int start;
+    instruction* instr;
+
+    array_sets = _nlabc_new_sets(size);
+    expr = _nlabc_new_expression();
+    for(int i = 0; i < size; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if(instr->op != op_set_end || instr->slot < 0 || instr->slot >= NUM_OF_VARS){
+            continue;
+        }
+        start = _interp_set_start(prog, i);
+        if(_nlabc_build_expression(prog, start, i, expr)){
+            array_sets[start] = i;
+        }
+    }
+    free(expr);
+    return array_sets;
+}
+
+int* _nlabc_new_sets(int size){
+
+    int* sets = (int*) malloc(sizeof(int) * (size + 1));
+
+    if(sets == NULL){
+        fprintf(stderr, "Memory error - cannot malloc space for nlabc\n");
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i <= size; i++){
+        sets[i] = NLABC_NOT_COMPILED;
+    }
+    return sets;
+}
+
+nlabc_expression* _nlabc_new_expression(void){
+
+    nlabc_expression* expr = (nlabc_expression*) malloc(sizeof(nlabc_expression));
+
+    if(expr == NULL){
+        fprintf(stderr, "Memory error - cannot malloc space for nlabc\n");
+        exit(EXIT_FAILURE);
+    }
+    expr->num_nodes = 0;
+    return expr;
+}
+
+/*
+    The SET's expression as C, on ints, with its variables read into v[0],
+    v[1]... in the order they're pushed. Only operators whose scalar results
+    are 1x1 ints are written out; B-ADD and B-TIMES wrap as the interpreter's do.
+*/
+bool _nlabc_scalar_expression(Program* prog, int start, int set_end, char* expression, int* num_vars){
+
+    char parts[FUSED_MAX_DEPTH][NLABC_MAX_EXPRESSION];
+    char joined[NLABC_MAX_EXPRESSION];
+    const char* format;
+    instruction* instr;
+    int depth, len;
+
+    *num_vars = 0;
+    depth = 0;
+    if(start >= set_end || !_interp_set_is_balanced(prog, start, set_end)){
+        return false;
+    }
+
+    for(int i = start; i < set_end; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        // markers for other ways of running the same instructions
+        if(instr->op == op_fused || instr->op == op_in_place || instr->op == op_registers){
+            continue;
+        }
+        if(!_is_fusable(instr) || instr->op == op_unary){
+            return false;
+        }
+
+        if(instr->op == op_push_var || instr->op == op_push_int){
+            if(depth == FUSED_MAX_DEPTH){
+                return false;
+            }
+            if(instr->op == op_push_var){
+                snprintf(parts[depth], NLABC_MAX_EXPRESSION, "v[%d]", (*num_vars)++);
+            } else{
+                // read from the table, so no comparison is of constants
+                snprintf(parts[depth], NLABC_MAX_EXPRESSION, "nlabc_literals[%d]", i);
+            }
+            depth++;
+            continue;
+        }
+
+        switch(instr->operand){
+            case binop_add: format = "((int) ((unsigned int) %s + (unsigned int) %s))"; break;
+            case binop_times: format = "((int) ((unsigned int) %s * (unsigned int) %s))"; break;
+            case binop_and: format = "((%s) != 0 && (%s) != 0)"; break;
+            case binop_or: format = "((%s) != 0 || (%s) != 0)"; break;
+            case binop_greater: format = "(%s > %s)"; break;
+            case binop_less: format = "(%s < %s)"; break;
+            case binop_equals: format = "(%s == %s)"; break;
+            default: return false;
+        }
+        len = snprintf(joined, NLABC_MAX_EXPRESSION, format, parts[depth - 2], parts[depth - 1]);
+        if(len < 0 || len >= NLABC_MAX_EXPRESSION){
+            return false;
+        }
+        strcpy(parts[depth - 2], joined);
+        depth--;
+    }
+
+    strcpy(expression, parts[0]);
+    return depth == 1;
+}
+
+void _nlabc_emit_scalar_set(Program* prog, int start, int set_end, FILE* out){
+
+    char expression[NLABC_MAX_EXPRESSION];
+    int num_vars, var;
+    instruction* instr;
+
+    _nlabc_scalar_expression(prog, start, set_end, expression, &num_vars);
+
+    fprintf(out, "    // %d-%d: SET of scalars\n", start, set_end);
+    fprintf(out, "    if(prog->polish_stack->size == 0");
+    var = 0;
+    for(int i = start; i < set_end; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if(instr->op == op_push_var){
+            fprintf(out, "\n    && nlabc_scalar(*nlabc_%c, &v[%d])", 'A' + instr->slot, var++);
+        }
+    }
+    fprintf(out, "){\n");
+    fprintf(out, "        nlabc_store_scalar(prog, %d, %s);\n", bytecode_at(prog->bytecode, set_end)->slot, expression);
+    fprintf(out, "        goto L%d;\n", set_end + 1);
+    fprintf(out, "    }\n");
+}
+
+/* SETS OF ARRAYS */
+
+/*
+    The SET's expression as a tree, if every instruction in it is a push or
+    an operator with a kernel of its own. Nodes are in the order their
+    instructions are, so a node's operands come before it and the root is the
+    last. Whether a value is an array is what it's expected to be when the
+    SET runs - a literal or U-TRACE gives a scalar, and a variable an array -
+    which the compiled SET checks, leaving the SET to the interpreter if not.
+*/
+bool _nlabc_build_expression(Program* prog, int start, int set_end, nlabc_expression* expr){
+
+    int stack[NLABC_MAX_NODES];
+    int depth = 0;
+    instruction* instr;
+    const operator_entry* entry;
+    nlabc_node* node;
+
+    expr->num_nodes = 0;
+    if(start >= set_end || !_interp_set_is_balanced(prog, start, set_end)){
+        return false;
+    }
+
+    for(int pc = start; pc < set_end; pc++){
+        instr = bytecode_at(prog->bytecode, pc);
+        // markers for other ways of running the same instructions
+        if(instr->op == op_fused || instr->op == op_in_place || instr->op == op_registers){
+            continue;
+        }
+        if(expr->num_nodes == NLABC_MAX_NODES){
+            return false;
+        }
+
+        node = &expr->nodes[expr->num_nodes];
+        node->pc = pc;
+        node->op = instr->op;
+        node->operation_type = instr->operand;
+        node->num_operands = 0;
+        node->parent = NLABC_NO_NODE;
+
+        if(instr->op == op_push_var){
+            node->kind = nlabc_variable;
+            node->is_vector = true;
+        } else if(instr->op == op_push_int){
+            node->kind = nlabc_literal;
+            node->value = nlab_array_get(instr->constant, 0, 0);
+            node->is_vector = false;
+        } else if(instr->op == op_unary || instr->op == op_binary){
+            entry = instr->op == op_unary ? &UNARY_OPERATORS[instr->operand] : &BINARY_OPERATORS[instr->operand];
+            if(_nlabc_kernel_name(entry->apply) == NULL || entry->needs_whole_stack
+            || entry->operands > OPERATOR_MAX_OPERANDS || entry->operands > depth){
+                return false;
+            }
+            node->kind = nlabc_call;
+            node->num_operands = entry->operands;
+            node->is_vector = false;
+            depth -= entry->operands;
+            for(int i = 0; i < entry->operands; i++){
+                node->operands[i] = stack[depth + i];
+                expr->nodes[stack[depth + i]].parent = expr->num_nodes;
+                node->is_vector = node->is_vector || expr->nodes[stack[depth + i]].is_vector;
+            }
+            if(instr->op == op_unary && instr->operand == unop_trace){
+                node->is_vector = false;
+            }
+        } else{
+            return false;
+        }
+        stack[depth++] = expr->num_nodes++;
+    }
+
+    if(depth != 1 || expr->nodes[expr->num_nodes - 1].kind != nlabc_call){
+        return false;
+    }
+    _nlabc_find_loops(expr);
+    return true;
+}
+
+const char* _nlabc_kernel_name(operator_apply apply){
+
+    for(int i = 0; apply != NULL && NLABC_KERNELS[i].apply != NULL; i++){
+        if(NLABC_KERNELS[i].apply == apply){
+            return NLABC_KERNELS[i].name;
+        }
+    }
+    return NULL;
+}
+
+// the operators _interp_run_fused() can run, which work element by element
+bool _nlabc_is_elementwise(nlabc_node* node){
+    return (node->kind == nlabc_call || node->kind == nlabc_loop || node->kind == nlabc_inlined)
+        && ((node->op == op_unary && node->operation_type == unop_not)
+         || (node->op == op_binary && node->operation_type != binop_dotproduct && node->operation_type != binop_power));
+}
+
+/*
+    Elementwise operators feeding each other are written as one loop over
+    the elements, at the last of them (an nlabc_loop, with the others
+    nlabc_inlined into it), if there are at least two, one of their values is
+    an array, and the loop isn't too big to write out. A single elementwise
+    operator is left as a call, as its kernel already takes one pass - with
+    SIMD, where it can.
+*/
+void _nlabc_find_loops(nlabc_expression* expr){
+
+    char element[NLABC_MAX_EXPRESSION];
+    nlabc_node* node;
+    int num_ops, num_leaves;
+
+    for(int i = expr->num_nodes - 1; i >= 0; i--){
+        node = &expr->nodes[i];
+        if(!_nlabc_is_elementwise(node)
+        || (node->parent != NLABC_NO_NODE && _nlabc_is_elementwise(&expr->nodes[node->parent]))){
+            continue;
+        }
+
+        num_ops = num_leaves = 0;
+        _nlabc_loop_extent(expr, i, &num_ops, &num_leaves);
+        element[0] = '\0';
+        if(num_ops < 2 || !node->is_vector || num_leaves > FUSED_MAX_DEPTH || !_nlabc_element(expr, i, element)){
+            continue;
+        }
+        node->kind = nlabc_loop;
+        _nlabc_inline(expr, i);
+    }
+}
+
+// the elementwise operators a loop at node would take in, and the arrays it would read
+void _nlabc_loop_extent(nlabc_expression* expr, int node, int* num_ops, int* num_leaves){
+
+    nlabc_node* operand;
+
+    (*num_ops)++;
+    for(int i = 0; i < expr->nodes[node].num_operands; i++){
+        operand = &expr->nodes[expr->nodes[node].operands[i]];
+        if(_nlabc_is_elementwise(operand)){
+            _nlabc_loop_extent(expr, expr->nodes[node].operands[i], num_ops, num_leaves);
+        } else if(operand->kind != nlabc_literal){
+            (*num_leaves)++;
+        }
+    }
+}
+
+void _nlabc_inline(nlabc_expression* expr, int node){
+
+    int operand;
+
+    for(int i = 0; i < expr->nodes[node].num_operands; i++){
+        operand = expr->nodes[node].operands[i];
+        if(_nlabc_is_elementwise(&expr->nodes[operand])){
+            expr->nodes[operand].kind = nlabc_inlined;
+            _nlabc_inline(expr, operand);
+        }
+    }
+}
+
+/*
+    One element of a loop's result, as C on ints - from r<n>[x] for each array
+    it reads (n being the node) and s<n> for each scalar, literals included,
+    so no comparison is of constants. As in _interp_run_fused(): a scalar on the left of an array is
+    taken as the right-hand operand, the logical operators test for non-zero,
+    and B-ADD and B-TIMES wrap. False if it's longer than NLABC_MAX_EXPRESSION.
+*/
+bool _nlabc_element(nlabc_expression* expr, int node, char* element){
+
+    nlabc_node* n = &expr->nodes[node];
+    nlabc_node* lhs;
+    char leaf[NLABC_MAX_LEAF];
+    const char* format[3];
+    int first, second;
+
+    if(!_nlabc_is_elementwise(n)){
+        snprintf(leaf, NLABC_MAX_LEAF, n->is_vector ? "r%d[x]" : "s%d", node);
+        return _nlabc_append(element, leaf);
+    }
+
+    if(n->op == op_unary){
+        return _nlabc_append(element, "((")
+            && _nlabc_element(expr, n->operands[0], element)
+            && _nlabc_append(element, ") == 0)");
+    }
+
+    switch(n->operation_type){
+        case binop_and: format[0] = "((("; format[1] = ") != 0) & (("; format[2] = ") != 0))"; break;
+        case binop_or: format[0] = "((("; format[1] = ") != 0) | (("; format[2] = ") != 0))"; break;
+        case binop_greater: format[0] = "(("; format[1] = ") > ("; format[2] = "))"; break;
+        case binop_less: format[0] = "(("; format[1] = ") < ("; format[2] = "))"; break;
+        case binop_equals: format[0] = "(("; format[1] = ") == ("; format[2] = "))"; break;
+        case binop_add: format[0] = "((int) ((unsigned int) ("; format[1] = ") + (unsigned int) ("; format[2] = ")))"; break;
+        default: format[0] = "((int) ((unsigned int) ("; format[1] = ") * (unsigned int) ("; format[2] = ")))"; break;
+    }
+    lhs = &expr->nodes[n->operands[0]];
+    first = !lhs->is_vector && n->is_vector ? n->operands[1] : n->operands[0];
+    second = first == n->operands[0] ? n->operands[1] : n->operands[0];
+    return _nlabc_append(element, format[0])
+        && _nlabc_element(expr, first, element)
+        && _nlabc_append(element, format[1])
+        && _nlabc_element(expr, second, element)
+        && _nlabc_append(element, format[2]);
+}
+
+bool _nlabc_append(char* element, const char* str){
+
+    if(strlen(element) + strlen(str) >= NLABC_MAX_EXPRESSION){
+        return false;
+    }
+    strcat(element, str);
+    return true;
+}
+
+/*
+    The SET as a function of its own, which runs it and returns true, or
+    returns false having changed nothing the interpreter would see, so the
+    SET's instructions run as they would have (and report any error). Kernels
+    are called on the values they'd have had from the stack, and loops work
+    through FUSED_BLOCK elements of a row at a time. The result is stored as
+    op_registers stores it - or, from a loop, written straight over the
+    target's elements, if they're of the same kind and shape and no other
+    value shares them.
+*/
+void _nlabc_emit_array_set(Program* prog, int start, int set_end, FILE* out){
+
+    nlabc_expression* expr;
+    nlabc_node* node;
+    int root;
+    short slot = bytecode_at(prog->bytecode, set_end)->slot;
+    bool has_calls = false, has_loops = false, reads_code = false;
+
+    expr = _nlabc_new_expression();
+    _nlabc_build_expression(prog, start, set_end, expr);
+    root = expr->num_nodes - 1;
+
+    for(int i = 0; i < expr->num_nodes; i++){
+        node = &expr->nodes[i];
+        has_calls = has_calls || node->kind == nlabc_call;
+        has_loops = has_loops || node->kind == nlabc_loop;
+        reads_code = reads_code || (node->kind == nlabc_literal && node->parent != NLABC_NO_NODE
+                                    && expr->nodes[node->parent].kind == nlabc_call);
+    }
+
+    fprintf(out, "// %d-%d: SET $%c\n", start, set_end, 'A' + slot);
+    fprintf(out, "bool nlabc_set_%d(Program* prog){\n\n", start);
+    if(reads_code){
+        fprintf(out, "    instruction* code = bytecode_at(prog->bytecode, 0);\n");
+    }
+    if(has_calls){
+        fprintf(out, "    nlab_array* operands[OPERATOR_MAX_OPERANDS];\n");
+    }
+    for(int i = 0; i < expr->num_nodes; i++){
+        node = &expr->nodes[i];
+        if(node->kind == nlabc_variable || node->kind == nlabc_call || node->kind == nlabc_loop){
+            fprintf(out, "    nlab_array* a%d = NULL;\n", i);
+        }
+        if(node->kind == nlabc_loop && _nlabc_is_bool(node)){
+            fprintf(out, "    int o%d[FUSED_BLOCK];\n", i);
+        }
+        if(node->parent != NLABC_NO_NODE && !_nlabc_is_elementwise(node)
+        && expr->nodes[node->parent].kind != nlabc_call){
+            if(node->is_vector){
+                fprintf(out, "    int b%d[FUSED_BLOCK];\n", i);
+                fprintf(out, "    const int* r%d;\n", i);
+            } else{
+                fprintf(out, "    int s%d;\n", i);
+            }
+        }
+    }
+    if(has_loops){
+        fprintf(out, "    nlab_array* out;\n");
+        fprintf(out, "    int* w;\n");
+        fprintf(out, "    unsigned int rows, cols;\n");
+        fprintf(out, "    int n;\n");
+    }
+    if(expr->nodes[root].kind == nlabc_loop){
+        fprintf(out, "    nlab_array* target = NULL;\n");
+    }
+    fprintf(out, "    bool ran = false;\n\n");
+
+    // as in _interp_store_result()
+    fprintf(out, "    // popped and cached values may still hold a reference to a variable's buffer\n");
+    fprintf(out, "    stack_release_popped(prog->polish_stack);\n");
+    fprintf(out, "    _interp_drop_cached(prog);\n");
+    fprintf(out, "    nlab_array_use_arena(prog->scratch_arena);\n");
+
+    for(int i = 0; i < expr->num_nodes; i++){
+        node = &expr->nodes[i];
+        if(node->kind == nlabc_variable){
+            fprintf(out, "\n    // %d: %s\n", node->pc, prog->tokens[bytecode_at(prog->bytecode, node->pc)->token]);
+            fprintf(out, "    if((a%d = *nlabc_%c) == NULL){\n", i, 'A' + bytecode_at(prog->bytecode, node->pc)->slot);
+            fprintf(out, "        goto done;\n");
+            fprintf(out, "    }\n");
+            fprintf(out, "    _interp_materialize_variable(a%d);\n", i);
+        } else if(node->kind == nlabc_call){
+            _nlabc_emit_call(expr, i, out);
+        } else if(node->kind == nlabc_loop){
+            _nlabc_emit_loop(expr, i, i == root ? slot : NLABC_NO_TARGET, out);
+        }
+    }
+
+    fprintf(out, "\n");
+    if(expr->nodes[root].kind == nlabc_loop){
+        fprintf(out, "    if(target == NULL){\n");
+        fprintf(out, "        nlabc_store(prog, %d, a%d);\n", slot, root);
+        fprintf(out, "    }\n");
+    } else{
+        fprintf(out, "    nlabc_store(prog, %d, a%d);\n", slot, root);
+    }
+    fprintf(out, "    ran = true;\n\n");
+    fprintf(out, "done:\n");
+    for(int i = 0; i < expr->num_nodes; i++){
+        if(expr->nodes[i].kind == nlabc_call || expr->nodes[i].kind == nlabc_loop){
+            fprintf(out, "    nlab_array_free(a%d);\n", i);
+        }
+    }
+    fprintf(out, "    if(ran){\n");
+    fprintf(out, "        _interp_reset_scratch(prog);\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    nlab_array_use_arena(NULL);\n");
+    fprintf(out, "    return ran;\n");
+    fprintf(out, "}\n\n");
+    free(expr);
+}
+
+void _nlabc_emit_call(nlabc_expression* expr, int node, FILE* out){
+
+    nlabc_node* n = &expr->nodes[node];
+    const operator_entry* entry;
+    int operand;
+
+    entry = n->op == op_unary ? &UNARY_OPERATORS[n->operation_type] : &BINARY_OPERATORS[n->operation_type];
+    fprintf(out, "\n    // %d: %s\n", n->pc, entry->word);
+    for(int i = 0; i < n->num_operands; i++){
+        operand = n->operands[i];
+        if(expr->nodes[operand].kind == nlabc_literal){
+            fprintf(out, "    operands[%d] = code[%d].constant;\n", i, expr->nodes[operand].pc);
+        } else{
+            fprintf(out, "    operands[%d] = a%d;\n", i, operand);
+        }
+    }
+    fprintf(out, "    if((a%d = %s(operands, %d)) == NULL){\n", node, _nlabc_kernel_name(entry->apply), n->operation_type);
+    fprintf(out, "        goto done;\n");
+    fprintf(out, "    }\n");
+}
+
+// the loop at node. If it's the SET's last, slot is the target it may be written over
+void _nlabc_emit_loop(nlabc_expression* expr, int node, short slot, FILE* out){
+
+    nlabc_node* n = &expr->nodes[node];
+    nlabc_node* leaf;
+    char element[NLABC_MAX_EXPRESSION];
+    int shape = NLABC_NO_NODE;
+    bool is_bool;
+    const char* kind;
+
+    is_bool = _nlabc_is_bool(n);
+    kind = is_bool ? "nlab_bool" : "nlab_int";
+    element[0] = '\0';
+    _nlabc_element(expr, node, element);
+
+    fprintf(out, "\n    // %d-%d:", expr->nodes[_nlabc_loop_first(expr, node)].pc, n->pc);
+    for(int i = 0; i <= node; i++){
+        if(_nlabc_in_loop(expr, i, node)){
+            fprintf(out, " %s", expr->nodes[i].op == op_unary ? UNARY_OPERATORS[expr->nodes[i].operation_type].word
+                                                                : BINARY_OPERATORS[expr->nodes[i].operation_type].word);
+        }
+    }
+    fprintf(out, ", in one loop\n");
+
+    // every array it reads has the shape of the first, and the scalars are 1x1
+    for(int i = 0; i < node && shape == NLABC_NO_NODE; i++){
+        if(_nlabc_is_leaf_of(expr, i, node) && expr->nodes[i].is_vector){
+            shape = i;
+        }
+    }
+    fprintf(out, "    rows = a%d->rows;\n", shape);
+    fprintf(out, "    cols = a%d->cols;\n", shape);
+    fprintf(out, "    if((rows == 1 && cols == 1)");
+    for(int i = 0; i < node; i++){
+        leaf = &expr->nodes[i];
+        if(i != shape && _nlabc_is_leaf_of(expr, i, node) && leaf->kind != nlabc_literal){
+            fprintf(out, "\n    || !nlabc_fits(a%d, %s)", i, leaf->is_vector ? "rows, cols" : "1, 1");
+        }
+    }
+    fprintf(out, "){\n");
+    fprintf(out, "        goto done;\n");
+    fprintf(out, "    }\n");
+    // rows are read straight from the buffers, so a transposed view is laid out first
+    for(int i = 0; i < node; i++){
+        if(_nlabc_is_leaf_of(expr, i, node) && expr->nodes[i].kind == nlabc_call && expr->nodes[i].is_vector){
+            fprintf(out, "    nlab_array_materialize(a%d);\n", i);
+        }
+    }
+    for(int i = 0; i < node; i++){
+        if(_nlabc_is_leaf_of(expr, i, node) && expr->nodes[i].kind == nlabc_literal){
+            fprintf(out, "    s%d = %d;\n", i, expr->nodes[i].value);
+        } else if(_nlabc_is_leaf_of(expr, i, node) && !expr->nodes[i].is_vector){
+            fprintf(out, "    s%d = nlab_array_get(a%d, 0, 0);\n", i, i);
+        }
+    }
+
+    if(slot != NLABC_NO_TARGET){
+        fprintf(out, "    if((target = nlabc_target(*nlabc_%c, rows, cols, %s)) != NULL){\n", 'A' + slot, kind);
+        fprintf(out, "        out = target;\n");
+        fprintf(out, "    } else{\n");
+        fprintf(out, "        out = a%d = %s(rows, cols);\n", node, is_bool ? "nlab_array_create_bool" : "nlab_array_create_uninit");
+        fprintf(out, "    }\n");
+    } else{
+        fprintf(out, "    out = a%d = %s(rows, cols);\n", node, is_bool ? "nlab_array_create_bool" : "nlab_array_create_uninit");
+    }
+
+    fprintf(out, "    for(unsigned int y = 0; y < rows; y++){\n");
+    fprintf(out, "        for(unsigned int first = 0; first < cols; first += FUSED_BLOCK){\n");
+    fprintf(out, "            n = cols - first < FUSED_BLOCK ? (int) (cols - first) : FUSED_BLOCK;\n");
+    for(int i = 0; i < node; i++){
+        if(_nlabc_is_leaf_of(expr, i, node) && expr->nodes[i].is_vector){
+            fprintf(out, "            r%d = nlabc_row(a%d, y, first, n, b%d);\n", i, i, i);
+        }
+    }
+    if(is_bool){
+        fprintf(out, "            w = o%d;\n", node);
+    } else{
+        fprintf(out, "            w = NLAB_ROW(out, y) + first;\n");
+    }
+    fprintf(out, "            for(int x = 0; x < n; x++){\n");
+    fprintf(out, "                w[x] = %s;\n", element);
+    fprintf(out, "            }\n");
+    if(is_bool){
+        fprintf(out, "            nlabc_pack(out, y, first, n, w);\n");
+    }
+    fprintf(out, "        }\n");
+    if(!is_bool){
+        fprintf(out, "        memset(NLAB_ROW(out, y) + cols, 0, sizeof(int) * (out->stride - cols));\n");
+    }
+    fprintf(out, "    }\n");
+}
+
+// the kind of a loop's result, as _interp_run_fused() decides it
+bool _nlabc_is_bool(nlabc_node* node){
+    return node->op == op_unary || (node->operation_type != binop_add && node->operation_type != binop_times);
+}
+
+// whether node i is an operator written into the loop at node
+bool _nlabc_in_loop(nlabc_expression* expr, int i, int node){
+
+    while(i != NLABC_NO_NODE && expr->nodes[i].kind == nlabc_inlined){
+        i = expr->nodes[i].parent;
+    }
+    return i == node;
+}
+
+// whether node i is a value the loop at node reads
+bool _nlabc_is_leaf_of(nlabc_expression* expr, int i, int node){
+    return !_nlabc_is_elementwise(&expr->nodes[i]) && expr->nodes[i].parent != NLABC_NO_NODE
+        && _nlabc_in_loop(expr, expr->nodes[i].parent, node);
+}
+
+// the first operator in the loop at node
+int _nlabc_loop_first(nlabc_expression* expr, int node){
+
+    for(int i = 0; i < node; i++){
+        if(_nlabc_in_loop(expr, i, node)){
+            return i;
+        }
+    }
+    return node;
+}
+
+// strings, literals and the LOOPs' bookkeeping don't need the interpreter; everything else is one step of it
+void _nlabc_emit_instruction(Program* prog, int pc, FILE* out){
+
+    instruction* instr = bytecode_at(prog->bytecode, pc);
+    char* str;
+
+    fprintf(out, "    // %d: %s\n", pc, NLABC_OPCODE_NAMES[instr->op]);
+    switch(instr->op){
+        case op_print_string:
+            str = interp_print_string(prog->tokens[instr->token]);
+            fprintf(out, "    printf(\"%%s\\n\", ");
+            _nlabc_emit_string(str, out);
+            fprintf(out, ");\n");
+            free(str);
+            break;
+
+        case op_push_int:
+            fprintf(out, "    stack_push(prog->polish_stack, bytecode_at(prog->bytecode, %d)->constant);\n", pc);
+            break;
+
+        case op_loop_begin:
+            // the interpreter reports a counter that's already set
+            fprintf(out, "    if(*nlabc_%c != NULL){\n", 'A' + instr->slot);
+            fprintf(out, "        pc = _interp_step(prog, %d);\n", pc);
+            fprintf(out, "        goto jump;\n");
+            fprintf(out, "    }\n");
+            fprintf(out, "    nlabc_start_counter(prog, %d);\n", instr->slot);
+            fprintf(out, "    code[%d].operand2++;\n", pc);
+            break;
+
+        case op_loop_end:
+            fprintf(out, "    if(nlabc_count(*nlabc_%c, %d)){\n", 'A' + instr->slot, instr->operand);
+            fprintf(out, "        _interp_end_iteration(prog);\n");
+            fprintf(out, "        goto L%d;\n", instr->jump);
+            fprintf(out, "    }\n");
+            fprintf(out, "    map_remove_by_code(prog->variable_map, %d);\n", instr->slot);
+            fprintf(out, "    _interp_end_iteration(prog);\n");
+            break;
+
+        case op_release:
+            fprintf(out, "    map_remove_by_code(prog->variable_map, %d);\n", instr->slot);
+            break;
+
+        case op_invariant:
+            // once each time the loop is entered, as in _interp_step()
+            fprintf(out, "    if(code[%d].operand2 == code[%d].operand2){\n", pc, instr->loop);
+            fprintf(out, "        goto L%d;\n", instr->jump);
+            fprintf(out, "    }\n");
+            fprintf(out, "    code[%d].operand2 = code[%d].operand2;\n", pc, instr->loop);
+            break;
+
+        case op_until_stable:
+            fprintf(out, "    nlab_array_use_arena(NULL);\n");
+            fprintf(out, "    _interp_until_stable(prog, &code[%d]);\n", pc);
+            break;
+
+        default:
+            fprintf(out, "    if((pc = _interp_step(prog, %d)) != %d){\n", pc, pc + 1);
+            fprintf(out, "        goto jump;\n");
+            fprintf(out, "    }\n");
+            break;
+    }
+}
+
+// the instructions _interp_step() may send somewhere other than the next one
+bool _nlabc_can_jump(instruction* instr){
+    return instr->op == op_loop_end || instr->op == op_fused || instr->op == op_invariant || instr->op == op_in_place
+        || instr->op == op_registers;
+}
+
+bool _nlabc_is_jump_target(Program* prog, int pc){
+
+    instruction* instr;
+
+    for(int i = 0; i < prog->bytecode->size; i++){
+        instr = bytecode_at(prog->bytecode, i);
+        if(_nlabc_can_jump(instr) && instr->jump == pc){
+            return true;
+        }
+    }
+    return false;
+}
+
+// as a C string literal. '?' is escaped too, so nothing is read as a trigraph
+void _nlabc_emit_string(const char* str, FILE* out){
+
+    fputc('"', out);
+    for(const char* c = str; *c != '\0'; c++){
+        if(*c == '"' || *c == '\\' || *c == '?'){
+            fprintf(out, "\\%c", *c);
+        } else if(isprint((unsigned char) *c)){
+            fputc(*c, out);
+        } else{
+            fprintf(out, "\\%03o", (unsigned char) *c);
+        }
+    }
+    fputc('"', out);
+}
+
+Program* nlabc_load(char** tokens, int num_of_tokens, instruction* code, int* literals, int num_of_instructions){
+
+    Program* prog;
+    instruction* instr;
+    arena* previous_arena;
+
+    prog = program_builder_init();
+    for(int i = 0; i < num_of_tokens; i++){
+        program_builder_add(prog, tokens[i]);
+    }
+
+    for(int i = 0; i < num_of_instructions; i++){
+        instr = bytecode_emit(prog->bytecode, code[i].op, code[i].token);
+        *instr = code[i];
+        // built as pushdown() builds them
+        if(instr->op == op_push_int){
+            previous_arena = nlab_array_use_arena(prog->program_arena);
+            instr->constant = nlab_array_create_1d((unsigned int) literals[i]);
+            nlab_array_use_arena(previous_arena);
+        } else if(instr->op == op_registers){
+            _interp_reserve_registers(prog, instr->operand);
+        }
+    }
+
+    prog->current_token = prog->num_of_tokens;
+    return prog;
+}
+
+bool nlabc_scalar(nlab_array* narr, int* value){
+
+    if(narr == NULL || narr->rows != 1 || narr->cols != 1){
+        return false;
+    }
+    *value = nlab_array_get(narr, 0, 0);
+    return true;
+}
+
+// the result is a 1x1 int, so it's written over a 1x1 int target, and replaces anything else
+void nlabc_store_scalar(Program* prog, short slot, int value){
+
+    nlab_array* target;
+    nlab_array* result;
+    arena* previous_arena;
+
+    // variables outlive the scratch arena
+    previous_arena = nlab_array_use_arena(NULL);
+    target = map_get_by_code(prog->variable_map, slot);
+    if(target != NULL && target->kind == nlab_int && target->rows == 1 && target->cols == 1){
+        nlab_array_set(target, 0, 0, value);
+    } else{
+        result = nlab_array_create_1d((unsigned int) value);
+        map_add_by_code(prog->variable_map, slot, result);
+        nlab_array_free(result);
+    }
+    nlab_array_use_arena(previous_arena);
+}
+
+// n elements of row y, from first_col - the row itself for an int array, or unpacked into buffer.
+// first_col is at the start of a word, as loops take FUSED_BLOCK columns at a time
+const int* nlabc_row(nlab_array* narr, unsigned int y, unsigned int first_col, int n, int* buffer){
+
+    if(narr->kind == nlab_int){
+        return NLAB_ROW(narr, y) + first_col;
+    }
+    simd_unpack(buffer, NLAB_BITS_ROW(narr, y) + first_col / NLAB_BITS_PER_WORD, (size_t) n);
+    return buffer;
+}
+
+// n 0s and 1s packed into a bool array's row y, from first_col (as for nlabc_row())
+void nlabc_pack(nlab_array* narr, unsigned int y, unsigned int first_col, int n, const int* values){
+    simd_compare(simd_equals, NLAB_BITS_ROW(narr, y) + first_col / NLAB_BITS_PER_WORD, values, NULL, 1, (size_t) n);
+}
+
+bool nlabc_fits(nlab_array* narr, unsigned int rows, unsigned int cols){
+    return narr->rows == rows && narr->cols == cols;
+}
+
+// target, if a result of this kind and shape can be written straight over it - see nlab_array_assign()
+nlab_array* nlabc_target(nlab_array* target, unsigned int rows, unsigned int cols, nlab_kind kind){
+
+    if(target == NULL || target->block == NULL || target->is_view || target->is_inline
+    || nlab_array_is_shared(target) || target->block->owner != NULL
+    || target->kind != kind || target->rows != rows || target->cols != cols){
+        return NULL;
+    }
+    return target;
+}
+
+// as _interp_run_registers() stores its result
+void nlabc_store(Program* prog, short slot, nlab_array* result){
+
+    arena* previous_arena = nlab_array_use_arena(NULL);
+
+    if(!nlab_array_assign(map_get_by_code(prog->variable_map, slot), result)){
+        nlab_array_move_out_of(result, prog->scratch_arena);
+        map_add_by_code(prog->variable_map, slot, result);
+    }
+    nlab_array_use_arena(previous_arena);
+}
+
+// a LOOP's counter starts at 1, on the heap
+void nlabc_start_counter(Program* prog, short slot){
+
+    nlab_array* counter;
+
+    nlab_array_use_arena(NULL);
+    counter = nlab_array_create_1d(1);
+    map_add_by_code(prog->variable_map, slot, counter);
+    nlab_array_free(counter);
+}
+
+// moves a LOOP's counter on, unless it's done its last pass - the body may have changed it
+bool nlabc_count(nlab_array* counter, int last){
+
+    if(counter == NULL || nlab_array_get(counter, 0, 0) >= last){
+        return false;
+    }
+    nlab_array_set(counter, 0, 0, nlab_array_get(counter, 0, 0) + 1);
+    return true;
+}
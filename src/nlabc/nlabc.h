@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../nlab.h"
+
+/*
+    nlabc compiles a .nlb program ahead of time. The grammar functions compile
+    it to bytecode as they would for ./extension, without running it, and
+    nlabc_emit() writes that out as a C program: the tokens and instructions
+    as tables, a function for each SET whose expression is only pushes and
+    operators, and a run function with a statement or two per instruction,
+    in order, jumping only where a LOOP (or a skipped SET) does. A SET's
+    function calls the operators' kernels (the SIMD, eightcount and GEMM ones
+    among them) on its values directly, and works out a chain of elementwise
+    operators - U-NOT, the B- ones but B-DOTPRODUCT and B-POWER - as one loop
+    over the elements; a SET of scalars is a line of C. These, the LOOPs'
+    bookkeeping and strings are all that's written out - anything else (ONES,
+    READ, PRINTing a variable, or a SET whose values aren't what it was
+    compiled for) is a call to _interp_step(), as is any SET that fails, so
+    the interpreter reports the error. The program is built with the NLab
+    sources and -DNLABC_PROGRAM - see the makefile - and its output is the
+    same as ./extension's, byte for byte.
+*/
+
+/* if compiled is false, the program written just reports prog's error */
+void nlabc_emit(Program* prog, bool compiled, const char* source_name, FILE* out);
+/* builds the program a written one runs - literals[i] is the value of code[i] if it's an op_push_int */
+Program* nlabc_load(char** tokens, int num_of_tokens, instruction* code, int* literals, int num_of_instructions);
+
+/* what a written program calls */
+/* for scalar SETs: reads a 1x1 variable, and stores a result as the SET would have */
+bool nlabc_scalar(nlab_array* narr, int* value);
+void nlabc_store_scalar(Program* prog, short slot, int value);
+/* for compiled SETs' loops: a row's elements as ints, and 0s and 1s packed back into bits */
+const int* nlabc_row(nlab_array* narr, unsigned int y, unsigned int first_col, int n, int* buffer);
+void nlabc_pack(nlab_array* narr, unsigned int y, unsigned int first_col, int n, const int* values);
+bool nlabc_fits(nlab_array* narr, unsigned int rows, unsigned int cols);
+nlab_array* nlabc_target(nlab_array* target, unsigned int rows, unsigned int cols, nlab_kind kind);
+void nlabc_store(Program* prog, short slot, nlab_array* result);
+/* for LOOPs */
+void nlabc_start_counter(Program* prog, short slot);
+bool nlabc_count(nlab_array* counter, int last);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "nlabc.h"
+
+// longest C expression written for a scalar SET, or an element of a loop - longer ones are left to the interpreter
+#define NLABC_MAX_EXPRESSION 2000
+#define NLABC_MAX_LEAF 32
+#define NLABC_NOT_COMPILED -1
+// most pushes and operators in a SET compiled to a function of its own
+#define NLABC_MAX_NODES 256
+#define NLABC_NO_NODE -1
+#define NLABC_NO_TARGET -1
+
+// the C names of opcodes and error states, as written into a program
+extern const char* NLABC_OPCODE_NAMES[];
+extern const char* NLABC_ERROR_NAMES[];
+
+typedef struct nlabc_kernel{
+    operator_apply apply;
+    const char* name;
+} nlabc_kernel;
+extern const nlabc_kernel NLABC_KERNELS[];
+
+/*
+    A compiled SET's expression, one node per push or operator. An operator
+    is a call to its kernel, or an elementwise one that's written as a loop -
+    taking in (nlabc_inlined) the elementwise operators that feed it.
+*/
+typedef enum nlabc_node_kind {nlabc_variable, nlabc_literal, nlabc_call, nlabc_loop, nlabc_inlined} nlabc_node_kind;
+typedef struct nlabc_node{
+    nlabc_node_kind kind;
+    int pc;
+    opcode op;
+    int operation_type;
+    int value;
+    int operands[OPERATOR_MAX_OPERANDS];
+    int num_operands;
+    int parent;
+    // whether it's expected to be an array rather than 1x1 when the SET runs
+    bool is_vector;
+} nlabc_node;
+
+typedef struct nlabc_expression{
+    nlabc_node nodes[NLABC_MAX_NODES];
+    int num_nodes;
+} nlabc_expression;
+
+void _nlabc_emit_tables(Program* prog, const char* source_name, FILE* out);
+void _nlabc_emit_variables(Program* prog, FILE* out);
+void _nlabc_variables_used(Program* prog, bool* used);
+void _nlabc_emit_run(Program* prog, FILE* out);
+bool _nlabc_uses_code(Program* prog);
+void _nlabc_emit_instruction(Program* prog, int pc, FILE* out);
+bool _nlabc_can_jump(instruction* instr);
+bool _nlabc_is_jump_target(Program* prog, int pc);
+int* _nlabc_find_scalar_sets(Program* prog, int* max_vars);
+int* _nlabc_find_array_sets(Program* prog);
+int* _nlabc_new_sets(int size);
+nlabc_expression* _nlabc_new_expression(void);
+bool _nlabc_scalar_expression(Program* prog, int start, int set_end, char* expression, int* num_vars);
+void _nlabc_emit_scalar_set(Program* prog, int start, int set_end, FILE* out);
+bool _nlabc_build_expression(Program* prog, int start, int set_end, nlabc_expression* expr);
+const char* _nlabc_kernel_name(operator_apply apply);
+bool _nlabc_is_elementwise(nlabc_node* node);
+void _nlabc_find_loops(nlabc_expression* expr);
+void _nlabc_loop_extent(nlabc_expression* expr, int node, int* num_ops, int* num_leaves);
+void _nlabc_inline(nlabc_expression* expr, int node);
+bool _nlabc_element(nlabc_expression* expr, int node, char* element);
+bool _nlabc_append(char* element, const char* str);
+void _nlabc_emit_array_set(Program* prog, int start, int set_end, FILE* out);
+void _nlabc_emit_call(nlabc_expression* expr, int node, FILE* out);
+void _nlabc_emit_loop(nlabc_expression* expr, int node, short slot, FILE* out);
+bool _nlabc_is_bool(nlabc_node* node);
+bool _nlabc_in_loop(nlabc_expression* expr, int i, int node);
+bool _nlabc_is_leaf_of(nlabc_expression* expr, int i, int node);
+int _nlabc_loop_first(nlabc_expression* expr, int node);
+void _nlabc_emit_string(const char* str, FILE* out);
@@ -25,9 +25,25 @@ Program* program_builder_init(void){
             exit(EXIT_FAILURE);
         }
     }
+    p->token_codes = (token_code*) calloc(MAX_NUM_OF_TOKENS, sizeof(token_code));
+    if(p->token_codes == NULL){
+        fprintf(stderr, "Memory error - unable to create memory for program\n.");
+        exit(EXIT_FAILURE);
+    }
     p->error_state = error_none;
     p->polish_stack = stack_init();
+    p->cse_values = stack_init();
+    p->registers = NULL;
+    p->num_registers = 0;
     p->variable_map = map_init();
+    p->bytecode = bytecode_init();
+    p->compile_depth = 0;
+    p->compile_only = false;
+    p->release_dead_variables = false;
+    p->remove_dead_stores = false;
+    p->program_arena = arena_init(PROGRAM_ARENA_CHUNK);
+    p->scratch_arena = arena_init(SCRATCH_ARENA_CHUNK);
+    p->iteration_heap_mark = p->last_iteration_heap_allocs = 0;
     
 
     return p;
@@ -55,6 +71,7 @@ bool program_builder_add(Program* prog, char* token){
     if(!(strcmp(returnedstr, token) == 0)){
         return false;
     }
+    prog->token_codes[prog->num_of_tokens] = _intern_token(token);
     prog->num_of_tokens++;
     return true;
 }
@@ -66,6 +83,7 @@ void program_builder_free(Program* prog){
             }
         
         FREE_AND_NULL(prog->tokens);
+        FREE_AND_NULL(prog->token_codes);
 
         if(prog->variable_map != NULL){
             map_free(prog->variable_map);
@@ -77,6 +95,31 @@ void program_builder_free(Program* prog){
             prog->polish_stack = NULL;
         }
 
+        if(prog->cse_values != NULL){
+            stack_free(prog->cse_values);
+            prog->cse_values = NULL;
+        }
+
+        FREE_AND_NULL(prog->registers);
+
+        if(prog->bytecode != NULL){
+            bytecode_free(prog->bytecode);
+            prog->bytecode = NULL;
+        }
+
+        // last, as the map, stack and bytecode may hold arrays bumped from them
+        if(prog->program_arena != NULL){
+            arena_free(prog->program_arena);
+            prog->program_arena = NULL;
+        }
+
+        if(prog->scratch_arena != NULL){
+            arena_free(prog->scratch_arena);
+            prog->scratch_arena = NULL;
+        }
+
+        nlab_array_pool_drain();
+
         FREE_AND_NULL(prog);
         prog = NULL;
     }
@@ -0,0 +1,313 @@
+#include "specific.h"
+
+simd_level simd_get_level(void){
+    #ifdef SIMD_X86
+    if(__builtin_cpu_supports("avx2")){
+        return simd_avx2;
+    }
+    if(__builtin_cpu_supports("sse4.1")){
+        return simd_sse41;
+    }
+    #endif
+    return simd_scalar;
+}
+
+void simd_arith(simd_op op, int* out, const int* a, const int* b, int value, size_t n){
+    _simd_arith_level(simd_get_level(), op, out, a, b, value, n);
+}
+
+void simd_compare(simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n){
+    _simd_compare_level(simd_get_level(), op, out, a, b, value, n);
+}
+
+void simd_not(uint64_t* out, const int* a, size_t n){
+    simd_compare(simd_equals, out, a, NULL, 0, n);
+}
+
+void simd_unpack(int* out, const uint64_t* bits, size_t n){
+    _simd_unpack_level(simd_get_level(), out, bits, n);
+}
+
+void _simd_arith_level(simd_level level, simd_op op, int* out, const int* a, const int* b, int value, size_t n){
+    #ifdef SIMD_X86
+    if(level == simd_avx2){
+        _simd_arith_avx2(op, out, a, b, value, n);
+        return;
+    } else if(level == simd_sse41){
+        _simd_arith_sse41(op, out, a, b, value, n);
+        return;
+    }
+    #endif
+    (void) level;
+    _simd_arith_scalar(op, out, a, b, value, n);
+}
+
+void _simd_compare_level(simd_level level, simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n){
+    #ifdef SIMD_X86
+    if(level == simd_avx2){
+        _simd_compare_avx2(op, out, a, b, value, n);
+        return;
+    } else if(level == simd_sse41){
+        _simd_compare_sse41(op, out, a, b, value, n);
+        return;
+    }
+    #endif
+    (void) level;
+    _simd_compare_scalar(op, out, a, b, value, n);
+}
+
+void _simd_unpack_level(simd_level level, int* out, const uint64_t* bits, size_t n){
+    #ifdef SIMD_X86
+    if(level == simd_avx2){
+        _simd_unpack_avx2(out, bits, n);
+        return;
+    } else if(level == simd_sse41){
+        _simd_unpack_sse41(out, bits, n);
+        return;
+    }
+    #endif
+    (void) level;
+    _simd_unpack_scalar(out, bits, n);
+}
+
+/* PORTABLE FALLBACK */
+
+// wraps as the vector adds and multiplies do, worked in unsigned ints so it's defined
+void _simd_arith_scalar(simd_op op, int* out, const int* a, const int* b, int value, size_t n){
+
+    if(op == simd_add){
+        for(size_t i = 0; i < n; i++){
+            out[i] = (int) ((unsigned int) a[i] + (unsigned int) (b == NULL ? value : b[i]));
+        }
+    } else if(op == simd_times){
+        for(size_t i = 0; i < n; i++){
+            out[i] = (int) ((unsigned int) a[i] * (unsigned int) (b == NULL ? value : b[i]));
+        }
+    }
+}
+
+void _simd_compare_scalar(simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n){
+
+    uint64_t word;
+    size_t first;
+
+    for(first = 0; first < n; first += SIMD_BITS_PER_WORD){
+        word = 0;
+        for(size_t i = first; i < n && i < first + SIMD_BITS_PER_WORD; i++){
+            word |= (uint64_t) _simd_compare_one(op, a[i], b == NULL ? value : b[i]) << (i - first);
+        }
+        out[first / SIMD_BITS_PER_WORD] = word;
+    }
+}
+
+int _simd_compare_one(simd_op op, int a, int b){
+
+    switch(op){
+        case simd_and:
+            return a && b;
+        case simd_or:
+            return a || b;
+        case simd_greater:
+            return a > b;
+        case simd_less:
+            return a < b;
+        case simd_equals:
+            return a == b;
+        default:
+            return 0;
+    }
+}
+
+void _simd_unpack_scalar(int* out, const uint64_t* bits, size_t n){
+
+    for(size_t i = 0; i < n; i++){
+        out[i] = (int) ((bits[i / SIMD_BITS_PER_WORD] >> (i % SIMD_BITS_PER_WORD)) & 1u);
+    }
+}
+
+#ifdef SIMD_X86
+
+/*
+    The comparisons build each word of bits from movemask()s of whole vectors -
+    and/or are done on the "is zero" masks, then inverted. What's left of the
+    row past the last whole vector goes through _simd_compare_one().
+*/
+
+/* AVX2 - 8 ints at a time */
+
+__attribute__((target("avx2")))
+void _simd_arith_avx2(simd_op op, int* out, const int* a, const int* b, int value, size_t n){
+
+    __m256i va, vb, broadcast;
+    size_t i;
+
+    broadcast = _mm256_set1_epi32(value);
+
+    for(i = 0; i + SIMD_AVX2_INTS <= n; i += SIMD_AVX2_INTS){
+        va = _mm256_loadu_si256((const __m256i*) (a + i));
+        vb = b == NULL ? broadcast : _mm256_loadu_si256((const __m256i*) (b + i));
+        if(op == simd_add){
+            _mm256_storeu_si256((__m256i*) (out + i), _mm256_add_epi32(va, vb));
+        } else{
+            _mm256_storeu_si256((__m256i*) (out + i), _mm256_mullo_epi32(va, vb));
+        }
+    }
+
+    _simd_arith_scalar(op, out + i, a + i, b == NULL ? NULL : b + i, value, n - i);
+}
+
+__attribute__((target("avx2")))
+void _simd_compare_avx2(simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n){
+
+    __m256i va, vb, mask, zero, broadcast;
+    unsigned int bits;
+    uint64_t word;
+    size_t i, first;
+
+    zero = _mm256_setzero_si256();
+    broadcast = _mm256_set1_epi32(value);
+    i = 0;
+
+    for(first = 0; first < n; first += SIMD_BITS_PER_WORD){
+        word = 0;
+
+        for(; i + SIMD_AVX2_INTS <= n && i + SIMD_AVX2_INTS <= first + SIMD_BITS_PER_WORD; i += SIMD_AVX2_INTS){
+            va = _mm256_loadu_si256((const __m256i*) (a + i));
+            vb = b == NULL ? broadcast : _mm256_loadu_si256((const __m256i*) (b + i));
+
+            if(op == simd_greater){
+                mask = _mm256_cmpgt_epi32(va, vb);
+            } else if(op == simd_less){
+                mask = _mm256_cmpgt_epi32(vb, va);
+            } else if(op == simd_equals){
+                mask = _mm256_cmpeq_epi32(va, vb);
+            } else if(op == simd_and){
+                mask = _mm256_or_si256(_mm256_cmpeq_epi32(va, zero), _mm256_cmpeq_epi32(vb, zero));
+            } else{
+                mask = _mm256_and_si256(_mm256_cmpeq_epi32(va, zero), _mm256_cmpeq_epi32(vb, zero));
+            }
+
+            bits = (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+            if(op == simd_and || op == simd_or){
+                bits = ~bits & 0xffu;
+            }
+            word |= (uint64_t) bits << (i - first);
+        }
+
+        for(; i < n && i < first + SIMD_BITS_PER_WORD; i++){
+            word |= (uint64_t) _simd_compare_one(op, a[i], b == NULL ? value : b[i]) << (i - first);
+        }
+        out[first / SIMD_BITS_PER_WORD] = word;
+    }
+}
+
+// each byte of bits is spread over a vector, whose lanes then test one bit apiece
+__attribute__((target("avx2")))
+void _simd_unpack_avx2(int* out, const uint64_t* bits, size_t n){
+
+    __m256i lanes, spread;
+    int byte;
+    size_t i;
+
+    lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    for(i = 0; i + SIMD_AVX2_INTS <= n; i += SIMD_AVX2_INTS){
+        byte = (int) ((bits[i / SIMD_BITS_PER_WORD] >> (i % SIMD_BITS_PER_WORD)) & 0xffu);
+        spread = _mm256_and_si256(_mm256_set1_epi32(byte), lanes);
+        _mm256_storeu_si256((__m256i*) (out + i), _mm256_srli_epi32(_mm256_cmpeq_epi32(spread, lanes), 31));
+    }
+
+    for(; i < n; i++){
+        out[i] = (int) ((bits[i / SIMD_BITS_PER_WORD] >> (i % SIMD_BITS_PER_WORD)) & 1u);
+    }
+}
+
+/* SSE4.1 - 4 ints at a time (mullo needs 4.1, the rest is SSE2) */
+
+__attribute__((target("sse4.1")))
+void _simd_arith_sse41(simd_op op, int* out, const int* a, const int* b, int value, size_t n){
+
+    __m128i va, vb, broadcast;
+    size_t i;
+
+    broadcast = _mm_set1_epi32(value);
+
+    for(i = 0; i + SIMD_SSE_INTS <= n; i += SIMD_SSE_INTS){
+        va = _mm_loadu_si128((const __m128i*) (a + i));
+        vb = b == NULL ? broadcast : _mm_loadu_si128((const __m128i*) (b + i));
+        if(op == simd_add){
+            _mm_storeu_si128((__m128i*) (out + i), _mm_add_epi32(va, vb));
+        } else{
+            _mm_storeu_si128((__m128i*) (out + i), _mm_mullo_epi32(va, vb));
+        }
+    }
+
+    _simd_arith_scalar(op, out + i, a + i, b == NULL ? NULL : b + i, value, n - i);
+}
+
+__attribute__((target("sse4.1")))
+void _simd_compare_sse41(simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n){
+
+    __m128i va, vb, mask, zero, broadcast;
+    unsigned int bits;
+    uint64_t word;
+    size_t i, first;
+
+    zero = _mm_setzero_si128();
+    broadcast = _mm_set1_epi32(value);
+    i = 0;
+
+    for(first = 0; first < n; first += SIMD_BITS_PER_WORD){
+        word = 0;
+
+        for(; i + SIMD_SSE_INTS <= n && i + SIMD_SSE_INTS <= first + SIMD_BITS_PER_WORD; i += SIMD_SSE_INTS){
+            va = _mm_loadu_si128((const __m128i*) (a + i));
+            vb = b == NULL ? broadcast : _mm_loadu_si128((const __m128i*) (b + i));
+
+            if(op == simd_greater){
+                mask = _mm_cmpgt_epi32(va, vb);
+            } else if(op == simd_less){
+                mask = _mm_cmplt_epi32(va, vb);
+            } else if(op == simd_equals){
+                mask = _mm_cmpeq_epi32(va, vb);
+            } else if(op == simd_and){
+                mask = _mm_or_si128(_mm_cmpeq_epi32(va, zero), _mm_cmpeq_epi32(vb, zero));
+            } else{
+                mask = _mm_and_si128(_mm_cmpeq_epi32(va, zero), _mm_cmpeq_epi32(vb, zero));
+            }
+
+            bits = (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(mask));
+            if(op == simd_and || op == simd_or){
+                bits = ~bits & 0xfu;
+            }
+            word |= (uint64_t) bits << (i - first);
+        }
+
+        for(; i < n && i < first + SIMD_BITS_PER_WORD; i++){
+            word |= (uint64_t) _simd_compare_one(op, a[i], b == NULL ? value : b[i]) << (i - first);
+        }
+        out[first / SIMD_BITS_PER_WORD] = word;
+    }
+}
+
+__attribute__((target("sse4.1")))
+void _simd_unpack_sse41(int* out, const uint64_t* bits, size_t n){
+
+    __m128i lanes, spread;
+    int nibble;
+    size_t i;
+
+    lanes = _mm_setr_epi32(1, 2, 4, 8);
+
+    for(i = 0; i + SIMD_SSE_INTS <= n; i += SIMD_SSE_INTS){
+        nibble = (int) ((bits[i / SIMD_BITS_PER_WORD] >> (i % SIMD_BITS_PER_WORD)) & 0xfu);
+        spread = _mm_and_si128(_mm_set1_epi32(nibble), lanes);
+        _mm_storeu_si128((__m128i*) (out + i), _mm_srli_epi32(_mm_cmpeq_epi32(spread, lanes), 31));
+    }
+
+    for(; i < n; i++){
+        out[i] = (int) ((bits[i / SIMD_BITS_PER_WORD] >> (i % SIMD_BITS_PER_WORD)) & 1u);
+    }
+}
+
+#endif
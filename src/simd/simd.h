@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../general.h"
+
+/*
+    Elementwise kernels over rows of ints. Each one picks the widest
+    instruction set the CPU supports at run time (AVX2, then SSE4.1), and
+    falls back to plain C elsewhere. The ops are in the same order as
+    binary_op, but the kernels don't depend on the interpreter.
+*/
+typedef enum simd_op {simd_and, simd_or, simd_greater, simd_less, simd_add, simd_times, simd_equals} simd_op;
+typedef enum simd_level {simd_scalar, simd_sse41, simd_avx2} simd_level;
+
+simd_level simd_get_level(void);
+/* out[i] = a[i] OP b[i], or a[i] OP value when b is NULL - add/times only */
+void simd_arith(simd_op op, int* out, const int* a, const int* b, int value, size_t n);
+/* bit i of out = a[i] OP b[i] (or value), packed 64 to a word, with the unused
+   bits of the last word cleared - the logical and comparison ops */
+void simd_compare(simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n);
+/* bit i of out = (a[i] == 0) */
+void simd_not(uint64_t* out, const int* a, size_t n);
+/* out[i] = bit i of bits, as 0 or 1 - what simd_compare() packs, unpacked */
+void simd_unpack(int* out, const uint64_t* bits, size_t n);
+
+/* one per level - considered private, but exposed so they can be tested against each other */
+void _simd_arith_level(simd_level level, simd_op op, int* out, const int* a, const int* b, int value, size_t n);
+void _simd_compare_level(simd_level level, simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n);
+void _simd_unpack_level(simd_level level, int* out, const uint64_t* bits, size_t n);
+void _simd_arith_scalar(simd_op op, int* out, const int* a, const int* b, int value, size_t n);
+void _simd_compare_scalar(simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n);
+void _simd_unpack_scalar(int* out, const uint64_t* bits, size_t n);
+int _simd_compare_one(simd_op op, int a, int b);
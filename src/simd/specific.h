@@ -0,0 +1,22 @@
+#include "simd.h"
+
+#pragma once
+
+// the x86 kernels need GCC/clang's target attribute and cpu detection
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+#define SIMD_BITS_PER_WORD 64
+#define SIMD_AVX2_INTS 8
+#define SIMD_SSE_INTS 4
+
+#ifdef SIMD_X86
+void _simd_arith_avx2(simd_op op, int* out, const int* a, const int* b, int value, size_t n);
+void _simd_compare_avx2(simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n);
+void _simd_unpack_avx2(int* out, const uint64_t* bits, size_t n);
+void _simd_arith_sse41(simd_op op, int* out, const int* a, const int* b, int value, size_t n);
+void _simd_compare_sse41(simd_op op, uint64_t* out, const int* a, const int* b, int value, size_t n);
+void _simd_unpack_sse41(int* out, const uint64_t* bits, size_t n);
+#endif
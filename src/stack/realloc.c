@@ -34,7 +34,7 @@ bool stack_push(stack* s, nlab_array* d){
        return false;
    }
 
-   nlab_array* copy_d;
+   nlab_array shared_d;
 
    if(s->size >= s->capacity){
       s->a = (nlab_array*) realloc(s->a, sizeof(nlab_array)*s->capacity*SCALEFACTOR);
@@ -43,19 +43,20 @@ bool stack_push(stack* s, nlab_array* d){
          fprintf(stderr, "Memory error - cannot malloc() space for nlab array");
          exit(EXIT_FAILURE);
       }
+      // inline scalars point into their own slot, which may just have moved
+      for(int i = 0; i < s->capacity; i++){
+         _nlab_array_fix_inline(&s->a[i]);
+      }
+      // realloc() doesn't zero the new slots, and they're freed on the next push
+      memset(&s->a[s->capacity], 0, sizeof(nlab_array)*s->capacity*(SCALEFACTOR-1));
       s->capacity = s->capacity*SCALEFACTOR;
    }
 
-   // free the data already in the stack before pushing, otherwise the memory will leak
-   copy_d = nlab_array_copy(d);
-   for(unsigned  int y = 0; y < (s->a[s->size].rows); y++){
-      FREE_AND_NULL(s->a[s->size].array[y]);
-   }
-   FREE_AND_NULL(s->a[s->size].array);
-
-   s->a[s->size] = *copy_d;
-   // copy_d dereferenced and assigned into fixed-sized array, so free the reference
-   free(copy_d);
+   // the slot shares d's buffer rather than copying it. Take the new reference
+   // before releasing whatever was left in the slot, in case d *is* that slot
+   _nlab_array_share_data(&shared_d, d);
+   _nlab_array_free_data(&s->a[s->size]);
+   _nlab_array_copy_struct(&s->a[s->size], &shared_d);
    s->size = s->size + 1;
    return true;
 }
@@ -77,6 +78,16 @@ nlab_array* stack_peek(stack* s){
    return &s->a[s->size-1];
 }
 
+// popped slots keep sharing their buffers until they're pushed over - this drops them now
+void stack_release_popped(stack* s){
+   if(s == NULL){
+      return;
+   }
+
+   for(int i = s->size; i < s->capacity; i++){
+      _nlab_array_free_data(&s->a[i]);
+   }
+}
 
 bool stack_free(stack* s){
    if(s==NULL){
@@ -84,12 +95,7 @@ bool stack_free(stack* s){
    }
 
    for(int i = 0; i < (s->capacity); i++){
-      if(s->a[i].array != NULL){
-         for(unsigned int y = 0; y < (s->a[i].rows); y++){
-            FREE_AND_NULL(s->a[i].array[y]);
-         }
-      }
-      FREE_AND_NULL(s->a[i].array);
+      _nlab_array_free_data(&s->a[i]);
    }
    FREE_AND_NULL(s->a);
 
@@ -13,3 +13,4 @@ bool stack_push(stack* s, nlab_array* d);
 nlab_array* stack_pop(stack* s);
 bool stack_free(stack* s);
 nlab_array* stack_peek(stack*s);
+void stack_release_popped(stack* s);
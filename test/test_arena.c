@@ -0,0 +1,74 @@
+#include "../src/nlab.h"
+
+void test_arena(void){
+
+    // test #1 - allocations are aligned, and don't overlap
+    arena* a1 = arena_init(256);
+    char* p1 = (char*) arena_alloc(a1, 10);
+    char* p2 = (char*) arena_alloc(a1, 100);
+    assert((uintptr_t) p1 % ARENA_ALIGNMENT == 0);
+    assert((uintptr_t) p2 % ARENA_ALIGNMENT == 0);
+    assert(p2 >= p1 + 10);
+    assert(arena_owns(a1, p1) && arena_owns(a1, p2 + 99));
+    assert(arena_num_chunk_allocs(a1) == 1);
+
+    // test #2 - past the end of a chunk (or bigger than one) a new chunk is added
+    char* p3 = (char*) arena_alloc(a1, 1000);
+    memset(p3, 1, 1000);
+    assert(arena_owns(a1, p3));
+    assert(arena_num_chunk_allocs(a1) == 2);
+
+    // test #3 - after a reset, the same allocations are made without calling malloc()
+    for(int round = 0; round < 3; round++){
+        arena_reset(a1);
+        assert(arena_alloc(a1, 10) != NULL);
+        assert(arena_alloc(a1, 100) != NULL);
+        assert(arena_alloc(a1, 1000) != NULL);
+    }
+    // the two chunks were merged by the first reset, then reused as they were
+    assert(arena_num_chunk_allocs(a1) == 3);
+
+    // test #4 - NULLs
+    assert(arena_alloc(NULL, 8) == NULL);
+    assert(!arena_owns(a1, NULL));
+    assert(!arena_free(NULL));
+    assert(arena_free(a1));
+
+    // test #5 - arrays made while an arena is in use come from it, and free() leaves them alone
+    arena* a5 = arena_init(1 << 12);
+    assert(nlab_array_use_arena(a5) == NULL);
+    nlab_alloc_counts before = nlab_array_alloc_counts();
+    nlab_array* arr5 = nlab_array_create_ones(4, 4);
+    assert(nlab_array_alloc_counts().heap == before.heap);
+    assert(nlab_array_alloc_counts().arena == before.arena + 2);
+    assert(nlab_array_in_arena(arr5, a5));
+    assert(arena_owns(a5, arr5) && arena_owns(a5, arr5->data));
+    assert(nlab_array_use_arena(NULL) == a5);
+    // a heap handle sharing the arena buffer survives a reset once it's moved out
+    nlab_array* copy5 = nlab_array_copy(arr5);
+    nlab_array_free(arr5);
+    nlab_array_move_out_of(copy5, a5);
+    assert(!nlab_array_in_arena(copy5, a5));
+    arena_reset(a5);
+    memset(arena_alloc(a5, 1 << 12), 0xff, 1 << 12);
+    assert(nlab_array_get(copy5, 3, 3) == 1);
+    nlab_array_free(copy5);
+    arena_free(a5);
+
+    // test #6 - reserving makes one chunk big enough, but never while something's in the arena
+    arena* a6 = arena_init(256);
+    arena_alloc(a6, 200);
+    arena_reserve(a6, 4096);
+    assert(arena_num_chunk_allocs(a6) == 1);
+    arena_reset(a6);
+    arena_reserve(a6, 4096);
+    assert(arena_num_chunk_allocs(a6) == 2);
+    assert(arena_alloc(a6, 4000) != NULL);
+    assert(arena_num_chunk_allocs(a6) == 2);
+    // smaller reservations keep the chunk there is
+    arena_reset(a6);
+    arena_reserve(a6, 100);
+    assert(arena_num_chunk_allocs(a6) == 2);
+    assert(arena_num_bytes(a6) >= 4096 && arena_num_bytes(NULL) == 0);
+    arena_free(a6);
+}
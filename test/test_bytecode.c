@@ -0,0 +1,75 @@
+#include "../src/nlab.h"
+
+void test_bytecode(void){
+    bytecode* bc = bytecode_init();
+    assert(bc);
+    assert(bc->size == 0);
+    assert(bytecode_at(bc, 0) == NULL);
+
+    // assert an emitted instruction starts out blank
+    instruction* instr = bytecode_emit(bc, op_push_var, 3);
+    assert(instr);
+    assert(instr->op == op_push_var);
+    assert(instr->token == 3);
+    assert(instr->slot == NO_SLOT);
+    assert(instr->jump == NO_JUMP);
+    assert(instr->constant == NULL);
+    assert(bc->size == 1);
+    assert(bytecode_at(bc, 0) == instr);
+
+    // assert growing past the initial capacity keeps earlier instructions
+    for(int i = 1; i < FIXEDSIZE_CODE * 2; i++){
+        instr = bytecode_emit(bc, op_push_int, i);
+        instr->constant = nlab_array_create_1d(i);
+    }
+    assert(bc->size == FIXEDSIZE_CODE * 2);
+    assert(bc->capacity >= bc->size);
+    assert(bytecode_at(bc, 0)->op == op_push_var);
+    assert(nlab_array_get(bytecode_at(bc, FIXEDSIZE_CODE + 1)->constant, 0, 0) == FIXEDSIZE_CODE + 1);
+    assert(bytecode_at(bc, bc->size) == NULL);
+    assert(bytecode_at(bc, -1) == NULL);
+
+    // assert inserting shifts the rest up one
+    instr = bytecode_insert(bc, 1, op_fused, 99);
+    assert(instr == bytecode_at(bc, 1));
+    assert(instr->op == op_fused);
+    assert(instr->constant == NULL);
+    assert(bytecode_at(bc, 0)->op == op_push_var);
+    assert(bytecode_at(bc, 2)->token == 1);
+    assert(bc->size == FIXEDSIZE_CODE * 2 + 1);
+    assert(bytecode_insert(bc, bc->size + 1, op_fused, 0) == NULL);
+
+    // assert jumps past an insert follow their instruction, and jumps to it land on it
+    bytecode* bc2 = bytecode_init();
+    for(int i = 0; i < 6; i++){
+        bytecode_emit(bc2, op_push_var, i);
+    }
+    bytecode_at(bc2, 0)->jump = 2;
+    bytecode_at(bc2, 1)->jump = 4;
+    bytecode_at(bc2, 5)->loop = 3;
+    bytecode_insert(bc2, 2, op_invariant, 9);
+    assert(bytecode_at(bc2, 0)->jump == 2);
+    assert(bytecode_at(bc2, 1)->jump == 5);
+    assert(bytecode_at(bc2, 6)->loop == 4);
+    assert(bytecode_at(bc2, 2)->jump == NO_JUMP);
+    // an op_loop_begin something's loop names is followed, even when inserted in front of
+    bytecode_insert(bc2, 4, op_release, 10);
+    assert(bytecode_at(bc2, 7)->loop == 5);
+    assert(bytecode_at(bc2, 1)->jump == 6);
+    assert(bytecode_remove(bc2, 4, 1));
+
+    // assert removing drops the instructions, and jumps into them land after
+    bytecode_at(bc2, 3)->constant = nlab_array_create_ones(2, 2);
+    assert(bytecode_remove(bc2, 2, 3));
+    assert(bc2->size == 4);
+    assert(bytecode_at(bc2, 2)->token == 4);
+    assert(bytecode_at(bc2, 1)->jump == 2);
+    assert(bytecode_at(bc2, 3)->loop == 2);
+    assert(!bytecode_remove(bc2, 2, 3));
+    assert(bytecode_free(bc2));
+
+    assert(!bytecode_free(NULL));
+    assert(bytecode_emit(NULL, op_print_var, 0) == NULL);
+    // frees the constants too
+    assert(bytecode_free(bc));
+}
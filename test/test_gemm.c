@@ -0,0 +1,72 @@
+#include "../src/nlab.h"
+
+void test_gemm(void){
+
+    // sizes around the register and cache blocks, plus one big enough to be split across threads
+    unsigned int sizes[][3] = {{1, 1, 1}, {3, 5, 7}, {4, 8, 1}, {65, 9, 257}, {130, 520, 33}, {200, 150, 120}};
+
+    for(int s = 0; s < 6; s++){
+        unsigned int m = sizes[s][0], n = sizes[s][1], k = sizes[s][2];
+        // rows padded out, as in an nlab_array
+        size_t lda = k + 3, ldb = n + 5, ldc = n + 1;
+        int* a = (int*) calloc((size_t) m * lda, sizeof(int));
+        int* b = (int*) calloc((size_t) k * ldb, sizeof(int));
+        int* c = (int*) calloc((size_t) m * ldc, sizeof(int));
+        assert(a && b && c);
+
+        for(unsigned int y = 0; y < m; y++){
+            for(unsigned int x = 0; x < k; x++){
+                a[y * lda + x] = (int) ((y * 31 + x * 17) % 13) - 6;
+            }
+        }
+        for(unsigned int y = 0; y < k; y++){
+            for(unsigned int x = 0; x < n; x++){
+                b[y * ldb + x] = (int) ((y * 7 + x * 11) % 9) - 4;
+            }
+        }
+        // the padding past each row of c is left alone
+        c[ldc - 1] = 99;
+
+        gemm_int(a, lda, b, ldb, c, ldc, m, n, k);
+
+        for(unsigned int y = 0; y < m; y++){
+            for(unsigned int x = 0; x < n; x++){
+                int expected = 0;
+                for(unsigned int p = 0; p < k; p++){
+                    expected += a[y * lda + p] * b[p * ldb + x];
+                }
+                assert(c[y * ldc + x] == expected);
+            }
+        }
+        assert(c[ldc - 1] == 99);
+
+        free(a);
+        free(b);
+        free(c);
+    }
+
+    // sums are kept in 64 bits until they're stored
+    int big_a[2] = {INT_MAX, INT_MAX};
+    int big_b[2] = {2, -2};
+    int big_c[1];
+    gemm_int(big_a, 2, big_b, 1, big_c, 1, 1, 1, 2);
+    assert(big_c[0] == 0);
+
+    // modular products reduce negative inputs too, and never overflow on the way
+    int mod_a[6] = {-7, INT_MAX, 5, INT_MIN, -1, 3};
+    int mod_b[6] = {INT_MAX, -3, 2, 9, 100, INT_MIN};
+    int mod_c[4];
+    unsigned int modulus = 1000000007;
+    gemm_int_mod(mod_a, 3, mod_b, 2, mod_c, 2, 2, 2, 3, modulus);
+    for(unsigned int y = 0; y < 2; y++){
+        for(unsigned int x = 0; x < 2; x++){
+            int64_t expected = 0;
+            for(unsigned int p = 0; p < 3; p++){
+                int64_t ra = ((int64_t) mod_a[y * 3 + p] % modulus + modulus) % modulus;
+                int64_t rb = ((int64_t) mod_b[p * 2 + x] % modulus + modulus) % modulus;
+                expected = (expected + ra * rb % modulus) % modulus;
+            }
+            assert(mod_c[y * 2 + x] == expected);
+        }
+    }
+}
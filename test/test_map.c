@@ -19,27 +19,57 @@ void test_map(void){
     nlab_array* data1 = nlab_array_create_1d(3);
     assert(data1->rows == 1);
     assert(data1->cols == 1);
-    assert(data1->array[0][0] == 3);
+    assert(nlab_array_get(data1, 0, 0) == 3);
     assert(strlen(varmap->variablemap[0].key) == 0);
     assert(map_add(varmap, var1, data1));
     assert(strlen(varmap->variablemap[0].key) != 0);
-    assert(map_get_key_value(varmap, "$A")->array[0][0] == 3);
+    assert(nlab_array_get(map_get_key_value(varmap, "$A"), 0, 0) == 3);
     nlab_array* data2 = nlab_array_create_1d(5);
 
     // designed so that re-adding existing keys overwrites old value
     // by freeing old then adding new into map
     assert(map_add(varmap, "$A", data2));
     assert(map_add(varmap, "$F", data2));
-    assert(map_get_key_value(varmap, "$F")->array[0][0] == 5);
+    assert(nlab_array_get(map_get_key_value(varmap, "$F"), 0, 0) == 5);
     // assert we can add NULL values
     assert(!map_add(varmap, "$A", NULL));
 
     // assert can't add NULL keys - valid varname tokens are 
     assert(!map_add(varmap, NULL, data2));
 
+    // assert writes to a stored value don't leak back
+    nlab_array_set(map_get_key_value(varmap, "$F"), 0, 0, 6);
+    assert(nlab_array_get(data2, 0, 0) == 5);
+    assert(nlab_array_get(map_get_key_value(varmap, "$A"), 0, 0) == 5);
+
+    // assert the map shares larger buffers
+    nlab_array* data3 = nlab_array_create_ones(3, 3);
+    assert(map_add(varmap, "$G", data3));
+    assert(map_get_key_value(varmap, "$G")->data == data3->data);
+    nlab_array_set(map_get_key_value(varmap, "$G"), 1, 1, 6);
+    assert(nlab_array_get(data3, 1, 1) == 1);
+    nlab_array_free(data3);
+
     // assert values are defaulted to NULL
     assert(map_get_key_value(varmap, "$D") == NULL);
 
+    // assert swaps exchange the values themselves, and only between set variables
+    nlab_array* g = map_get_key_value(varmap, "$G");
+    nlab_array* f = map_get_key_value(varmap, "$F");
+    assert(map_swap_by_code(varmap, map_get_keycode("$F"), map_get_keycode("$G")));
+    assert(map_get_key_value(varmap, "$F") == g && map_get_key_value(varmap, "$G") == f);
+    assert(!map_swap_by_code(varmap, map_get_keycode("$F"), map_get_keycode("$D")));
+    assert(map_get_key_value(varmap, "$F") == g);
+
+    // assert a slot follows its variable as it's set and removed
+    nlab_array** slot = map_slot_by_code(varmap, map_get_keycode("$F"));
+    assert(slot != NULL && *slot == g);
+    assert(map_remove_by_code(varmap, map_get_keycode("$F")));
+    assert(*slot == NULL);
+    assert(map_add_by_code(varmap, map_get_keycode("$F"), data1));
+    assert(*slot == map_get_key_value(varmap, "$F"));
+    assert(map_slot_by_code(varmap, NUM_OF_VARS) == NULL);
+
     nlab_array_free(data1);
     nlab_array_free(data2);
 
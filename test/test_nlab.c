@@ -39,7 +39,6 @@ void test_nlab(void){
     test_interp_print_string();
     test_interp_create_read();
     test_interp_set();
-    test_interp_get_var_context();
     test_interp_u_not();
     test_interp_u_eightcount();
     test_interp_b_and();
@@ -50,18 +49,32 @@ void test_nlab(void){
     test_interp_b_times();
     test_interp_b_equals();
     test_interp_loop();
+    test_interp_execute();
+    test_interp_arena();
+    test_interp_fused();
+    test_interp_hoist();
+    test_interp_cse();
+    test_interp_shapes();
+    test_interp_in_place();
+    test_interp_move();
+    test_interp_registers();
+    test_interp_release();
+    test_interp_dead_stores();
     
     test_binop_scalar_vector();
     test_binop_vector_vector();
     test_binop_scalar_scalar();
+    test_binop_bool();
 
     /* Extension tests */
     #ifdef EXTENSION
     test_extension_u_trace();
     test_extension_u_transpose();
     test_extension_u_submatrix();
+    test_extension_u_lifestep();
     test_extension_b_dotproduct();
     test_extension_b_power();
+    test_extension_until_stable();
     #endif
 
 }
@@ -332,7 +345,7 @@ void test_program(void){
     program_builder_add(p5, "}");
     assert(program(p5));
     nlab_array* final = map_get_key_value(p5->variable_map, "$A");
-    assert(final->array[0][0] == 120);
+    assert(nlab_array_get(final, 0, 0) == 120);
     program_builder_free(p5);
 
     // test #6 - testing a bug found interpretting Neill's example #4
@@ -367,7 +380,7 @@ void test_program(void){
     assert(program(p6));
     nlab_array* var_X = map_get_key_value(p6->variable_map, "$X");
     assert(var_X);
-    assert(var_X->array[0][0] == 10);
+    assert(nlab_array_get(var_X, 0, 0) == 10);
     program_builder_free(p6);
 
     
@@ -423,7 +436,7 @@ void test_program(void){
     assert(program(p8));
     assert(strlen(p8->error_msg) == 0);
     nlab_array* var_f = map_get_key_value(p8->variable_map, "$F");
-    assert(var_f->array[0][0] == 3628800);
+    assert(nlab_array_get(var_f, 0, 0) == 3628800);
     program_builder_free(p8);
     #endif
 
@@ -848,7 +861,7 @@ void test_set(){
     assert(set(p5));
     assert(map_contains_key(p5->variable_map, "$I"));
     nlab_array* variable = map_get_key_value(p5->variable_map, "$I");
-    assert(variable->array[0][0] == 5);
+    assert(nlab_array_get(variable, 0, 0) == 5);
     program_builder_free(p5);
     #endif
 
@@ -867,88 +880,88 @@ void test_set(){
     program_builder_add(p6, "B-OR");
     program_builder_add(p6, ";");
     nlab_array* var_B = nlab_array_create_ones(5,5);
-    var_B->array[0][0] = 0;
-    var_B->array[0][1] = 0;
-    var_B->array[0][2] = 0;
-    var_B->array[0][3] = 0;
-    var_B->array[0][4] = 0;
-    var_B->array[1][0] = 1;
-    var_B->array[1][1] = 2;
-    var_B->array[1][2] = 3;
-    var_B->array[1][3] = 2;
-    var_B->array[1][4] = 1;
-    var_B->array[2][0] = 1;
-    var_B->array[2][1] = 1;
-    var_B->array[2][2] = 2;
-    var_B->array[2][3] = 1;
-    var_B->array[2][4] = 1;
-    var_B->array[3][0] = 1;
-    var_B->array[3][1] = 2;
-    var_B->array[3][2] = 3;
-    var_B->array[3][3] = 2;
-    var_B->array[3][4] = 1;
-    var_B->array[4][0] = 0;
-    var_B->array[4][1] = 0;
-    var_B->array[4][2] = 0;
-    var_B->array[4][3] = 0;
-    var_B->array[4][4] = 0;
+    nlab_array_set(var_B, 0, 0, 0);
+    nlab_array_set(var_B, 0, 1, 0);
+    nlab_array_set(var_B, 0, 2, 0);
+    nlab_array_set(var_B, 0, 3, 0);
+    nlab_array_set(var_B, 0, 4, 0);
+    nlab_array_set(var_B, 1, 0, 1);
+    nlab_array_set(var_B, 1, 1, 2);
+    nlab_array_set(var_B, 1, 2, 3);
+    nlab_array_set(var_B, 1, 3, 2);
+    nlab_array_set(var_B, 1, 4, 1);
+    nlab_array_set(var_B, 2, 0, 1);
+    nlab_array_set(var_B, 2, 1, 1);
+    nlab_array_set(var_B, 2, 2, 2);
+    nlab_array_set(var_B, 2, 3, 1);
+    nlab_array_set(var_B, 2, 4, 1);
+    nlab_array_set(var_B, 3, 0, 1);
+    nlab_array_set(var_B, 3, 1, 2);
+    nlab_array_set(var_B, 3, 2, 3);
+    nlab_array_set(var_B, 3, 3, 2);
+    nlab_array_set(var_B, 3, 4, 1);
+    nlab_array_set(var_B, 4, 0, 0);
+    nlab_array_set(var_B, 4, 1, 0);
+    nlab_array_set(var_B, 4, 2, 0);
+    nlab_array_set(var_B, 4, 3, 0);
+    nlab_array_set(var_B, 4, 4, 0);
     nlab_array* var_D = nlab_array_create_ones(5,5);
-    var_D->array[0][0] = 0;
-    var_D->array[0][1] = 0;
-    var_D->array[0][2] = 0;
-    var_D->array[0][3] = 0;
-    var_D->array[0][4] = 0;
-    var_D->array[1][0] = 0;
-    var_D->array[1][1] = 0;
-    var_D->array[1][2] = 1;
-    var_D->array[1][3] = 0;
-    var_D->array[1][4] = 0;
-    var_D->array[2][0] = 0;
-    var_D->array[2][1] = 0;
-    var_D->array[2][2] = 0;
-    var_D->array[2][3] = 0;
-    var_D->array[2][4] = 0;
-    var_D->array[3][0] = 0;
-    var_D->array[3][1] = 0;
-    var_D->array[3][2] = 1;
-    var_D->array[3][3] = 0;
-    var_D->array[3][4] = 0;
-    var_D->array[4][0] = 0;
-    var_D->array[4][1] = 0;
-    var_D->array[4][2] = 0;
-    var_D->array[4][3] = 0;
-    var_D->array[4][4] = 0;
+    nlab_array_set(var_D, 0, 0, 0);
+    nlab_array_set(var_D, 0, 1, 0);
+    nlab_array_set(var_D, 0, 2, 0);
+    nlab_array_set(var_D, 0, 3, 0);
+    nlab_array_set(var_D, 0, 4, 0);
+    nlab_array_set(var_D, 1, 0, 0);
+    nlab_array_set(var_D, 1, 1, 0);
+    nlab_array_set(var_D, 1, 2, 1);
+    nlab_array_set(var_D, 1, 3, 0);
+    nlab_array_set(var_D, 1, 4, 0);
+    nlab_array_set(var_D, 2, 0, 0);
+    nlab_array_set(var_D, 2, 1, 0);
+    nlab_array_set(var_D, 2, 2, 0);
+    nlab_array_set(var_D, 2, 3, 0);
+    nlab_array_set(var_D, 2, 4, 0);
+    nlab_array_set(var_D, 3, 0, 0);
+    nlab_array_set(var_D, 3, 1, 0);
+    nlab_array_set(var_D, 3, 2, 1);
+    nlab_array_set(var_D, 3, 3, 0);
+    nlab_array_set(var_D, 3, 4, 0);
+    nlab_array_set(var_D, 4, 0, 0);
+    nlab_array_set(var_D, 4, 1, 0);
+    nlab_array_set(var_D, 4, 2, 0);
+    nlab_array_set(var_D, 4, 3, 0);
+    nlab_array_set(var_D, 4, 4, 0);
     map_add(p6->variable_map, "$B", var_B);
     map_add(p6->variable_map, "$D", var_D);
     assert(set(p6));
     assert(p6->polish_stack->size == 0);
     assert(map_contains_key(p6->variable_map, "$C"));
     nlab_array* result = map_get_key_value(p6->variable_map, "$C");
-    assert(result->array[0][0] == 0);
-    assert(result->array[0][1] == 0);
-    assert(result->array[0][2] == 0);
-    assert(result->array[0][3] == 0);
-    assert(result->array[0][4] == 0);
-    assert(result->array[1][0] == 0);
-    assert(result->array[1][1] == 1);
-    assert(result->array[1][2] == 1);
-    assert(result->array[1][3] == 1);
-    assert(result->array[1][4] == 0);
-    assert(result->array[2][0] == 0);
-    assert(result->array[2][1] == 0);
-    assert(result->array[2][2] == 1);
-    assert(result->array[2][3] == 0);
-    assert(result->array[2][4] == 0);
-    assert(result->array[3][0] == 0);
-    assert(result->array[3][1] == 1);
-    assert(result->array[3][2] == 1);
-    assert(result->array[3][3] == 1);
-    assert(result->array[3][4] == 0);
-    assert(result->array[4][0] == 0);
-    assert(result->array[4][1] == 0);
-    assert(result->array[4][2] == 0);
-    assert(result->array[4][3] == 0);
-    assert(result->array[4][4] == 0);
+    assert(nlab_array_get(result, 0, 0) == 0);
+    assert(nlab_array_get(result, 0, 1) == 0);
+    assert(nlab_array_get(result, 0, 2) == 0);
+    assert(nlab_array_get(result, 0, 3) == 0);
+    assert(nlab_array_get(result, 0, 4) == 0);
+    assert(nlab_array_get(result, 1, 0) == 0);
+    assert(nlab_array_get(result, 1, 1) == 1);
+    assert(nlab_array_get(result, 1, 2) == 1);
+    assert(nlab_array_get(result, 1, 3) == 1);
+    assert(nlab_array_get(result, 1, 4) == 0);
+    assert(nlab_array_get(result, 2, 0) == 0);
+    assert(nlab_array_get(result, 2, 1) == 0);
+    assert(nlab_array_get(result, 2, 2) == 1);
+    assert(nlab_array_get(result, 2, 3) == 0);
+    assert(nlab_array_get(result, 2, 4) == 0);
+    assert(nlab_array_get(result, 3, 0) == 0);
+    assert(nlab_array_get(result, 3, 1) == 1);
+    assert(nlab_array_get(result, 3, 2) == 1);
+    assert(nlab_array_get(result, 3, 3) == 1);
+    assert(nlab_array_get(result, 3, 4) == 0);
+    assert(nlab_array_get(result, 4, 0) == 0);
+    assert(nlab_array_get(result, 4, 1) == 0);
+    assert(nlab_array_get(result, 4, 2) == 0);
+    assert(nlab_array_get(result, 4, 3) == 0);
+    assert(nlab_array_get(result, 4, 4) == 0);
     nlab_array_free(var_B);
     nlab_array_free(var_D);
     program_builder_free(p6);
@@ -1130,6 +1143,19 @@ void test_unaryop(void){
     assert(!integer(prog));
     prog->current_token++;
     assert(!integer(prog));
+    assert(!unaryop(prog));
+
+    // test set #3 - operators are interned as they're read, by their table entry
+    assert(prog->token_codes[0].kind == token_unary && prog->token_codes[0].operation_type == unop_not);
+    assert(prog->token_codes[1].operation_type == unop_eightcount);
+    assert(prog->token_codes[2].kind == token_other);
+    assert(STRINGS_EQUAL(UNARY_OPERATORS[unop_eightcount].word, "U-EIGHTCOUNT"));
+    assert(UNARY_OPERATORS[unop_not].kernel == interp_u_not);
+    #ifdef EXTENSION
+    assert(_intern_token("U-LIFESTEP").operation_type == unop_lifestep);
+    #else
+    assert(_intern_token("U-LIFESTEP").kind == token_other);
+    #endif
 
     program_builder_free(prog);
 }
@@ -1151,6 +1177,19 @@ void test_binaryop(void){
     prog->current_token++;
     assert(!binaryop(prog));
 
+    // test set #3 - each operator has one table entry, and unknown words none
+    assert(prog->token_codes[1].kind == token_binary && prog->token_codes[1].operation_type == binop_equals);
+    assert(prog->token_codes[2].kind == token_other);
+    assert(_intern_token("U-NOT").kind == token_unary);
+    assert(_intern_token(NULL).kind == token_other);
+    assert(BINARY_OPERATORS[binop_times].kernel == interp_b_times);
+    #ifdef EXTENSION
+    assert(_intern_token("B-POWER").kind == token_binary);
+    assert(BINARY_OPERATORS[binop_dotproduct].kernel == extension_b_dotproduct);
+    #else
+    assert(BINARY_OPERATORS[binop_power].word == NULL);
+    #endif
+
     program_builder_free(prog);
 }
 
@@ -1235,9 +1274,9 @@ void test_create(void){
     nlab_array* var_a = map_get_key_value(prog7->variable_map, "$A");
     assert(var_a->rows == 5);
     assert(var_a->cols == 5);
-    assert(var_a->array[1][1] == 0);
-    assert(var_a->array[2][2] == 1);
-    assert(var_a->array[3][3] == 0);
+    assert(nlab_array_get(var_a, 1, 1) == 0);
+    assert(nlab_array_get(var_a, 2, 2) == 1);
+    assert(nlab_array_get(var_a, 3, 3) == 0);
     program_builder_free(prog7);
     #endif
 
@@ -1511,11 +1550,11 @@ void test_interp_create_read(void){
     nlab_array* copy1 = map_get_key_value(p1->variable_map, "$F");
     assert(copy1->rows == 5);
     assert(copy1->cols == 5);
-    assert(copy1->array[0][0] == 0);
-    assert(copy1->array[1][1] == 0);
-    assert(copy1->array[2][2] == 1);
-    assert(copy1->array[3][3] == 0);
-    assert(copy1->array[4][4] == 0);
+    assert(nlab_array_get(copy1, 0, 0) == 0);
+    assert(nlab_array_get(copy1, 1, 1) == 0);
+    assert(nlab_array_get(copy1, 2, 2) == 1);
+    assert(nlab_array_get(copy1, 3, 3) == 0);
+    assert(nlab_array_get(copy1, 4, 4) == 0);
 
     program_builder_free(p1);
 
@@ -1545,11 +1584,7 @@ void test_interp_create_read(void){
 
 void test_interp_set(void){
 
-    /* 
-        NOTE: the interp_set doesn't reach either interp_pushdown
-        functions, so push vars onto stack manually.
-    */
-
+    #ifdef INTERP
     // test #1 - set a variable.
     Program* p1 = program_builder_init();
     program_builder_add(p1, "SET");
@@ -1557,17 +1592,10 @@ void test_interp_set(void){
     program_builder_add(p1, ":=");
     program_builder_add(p1, "5");
     program_builder_add(p1, ";");
-    p1->current_token = 6;
-    nlab_array* arr1 = nlab_array_create_1d(5);
-    stack_push(p1->polish_stack, arr1);
-    assert(interp_set(p1));
-    assert(p1->polish_stack->size == 1);
-    nlab_array* result1 = stack_peek(p1->polish_stack);
-    assert(result1->array[0][0] == 5);
-    nlab_array_free(arr1);
+    assert(set(p1));
+    assert(p1->polish_stack->size == 0);
     assert(map_contains_key(p1->variable_map, "$I"));
-    assert(map_get_key_value(p1->variable_map, "$I")->array[0][0] == 5);
-
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$I"), 0, 0) == 5);
     program_builder_free(p1);
 
     // test #2 - set 5 3 B-ADD
@@ -1579,26 +1607,12 @@ void test_interp_set(void){
     program_builder_add(p2, "3");
     program_builder_add(p2, "B-ADD");
     program_builder_add(p2, ";");
-    p2->current_token = 6;
-    nlab_array* arr2 = nlab_array_create_1d(5);
-    nlab_array* arr3 = nlab_array_create_1d(3);
-    stack_push(p2->polish_stack, arr2);
-    stack_push(p2->polish_stack, arr3);
-    assert(p2->polish_stack->size == 2);
-    assert(interp_set(p2));
-    assert(p2->polish_stack->size == 1);
-    nlab_array* result2 = stack_peek(p2->polish_stack);
-    assert(result2->array[0][0] == 8);
-    nlab_array_free(arr2);
-    nlab_array_free(arr3);
-    assert(map_contains_key(p2->variable_map, "$I"));
-    assert(map_get_key_value(p2->variable_map, "$I")->array[0][0] == 8);
-
+    assert(set(p2));
+    assert(p2->polish_stack->size == 0);
+    assert(nlab_array_get(map_get_key_value(p2->variable_map, "$I"), 0, 0) == 8);
     program_builder_free(p2);
 
-
-    #ifdef INTERP
-    // test #2 - set an array using B-TIMES and interpret
+    // test #3 - set an array using B-TIMES and interpret
     Program* p3 = program_builder_init();
     program_builder_add(p3, "SET");
     program_builder_add(p3, "$I");
@@ -1607,133 +1621,58 @@ void test_interp_set(void){
     program_builder_add(p3, "$Y");
     program_builder_add(p3, "B-TIMES");
     program_builder_add(p3, ";");
-    p3->current_token = 6;
     nlab_array* arr4 = nlab_array_create_ones(3,3);
-    arr4->array[0][0] = 0;
-    arr4->array[0][1] = 1;
-    arr4->array[0][2] = 2;
-    arr4->array[1][0] = 3;
-    arr4->array[1][1] = 4;
-    arr4->array[1][2] = 5;
-    arr4->array[2][0] = 6;
-    arr4->array[2][1] = 7;
-    arr4->array[2][2] = 8;
     nlab_array* arr5 = nlab_array_create_ones(3,3);
-    arr5->array[0][0] = 8;
-    arr5->array[0][1] = 7;
-    arr5->array[0][2] = 6;
-    arr5->array[1][0] = 5;
-    arr5->array[1][1] = 4;
-    arr5->array[1][2] = 3;
-    arr5->array[2][0] = 2;
-    arr5->array[2][1] = 1;
-    arr5->array[2][2] = 0;
-    stack_push(p3->polish_stack, arr4);
-    stack_push(p3->polish_stack, arr5);
-    assert(p3->polish_stack->size == 2);
-    assert(interp_set(p3));
-    assert(p3->polish_stack->size == 1);
-    nlab_array* result3 = stack_peek(p3->polish_stack);
-    assert(result3->array[0][0] == 0);
-    assert(result3->array[0][1] == 7);
-    assert(result3->array[0][2] == 12);
-    assert(result3->array[1][0] == 15);
-    assert(result3->array[1][1] == 16);
-    assert(result3->array[1][2] == 15);
-    assert(result3->array[2][0] == 12);
-    assert(result3->array[2][1] == 7);
-    assert(result3->array[2][2] == 0);
-    assert(map_contains_key(p3->variable_map, "$I"));
-    assert(map_get_key_value(p3->variable_map, "$I")->array[0][0] == 0);
-    assert(map_get_key_value(p3->variable_map, "$I")->array[0][1] == 7);
-    assert(map_get_key_value(p3->variable_map, "$I")->array[0][2] == 12);
-    assert(map_get_key_value(p3->variable_map, "$I")->array[1][0] == 15);
-    assert(map_get_key_value(p3->variable_map, "$I")->array[1][1] == 16);
-
+    for(int i = 0; i < 9; i++){
+        nlab_array_set(arr4, i / 3, i % 3, i);
+        nlab_array_set(arr5, i / 3, i % 3, 8 - i);
+    }
+    map_add(p3->variable_map, "$X", arr4);
+    map_add(p3->variable_map, "$Y", arr5);
+    assert(set(p3));
+    assert(p3->polish_stack->size == 0);
+    nlab_array* result3 = map_get_key_value(p3->variable_map, "$I");
+    for(int i = 0; i < 9; i++){
+        assert(nlab_array_get(result3, i / 3, i % 3) == i * (8 - i));
+    }
     nlab_array_free(arr4);
     nlab_array_free(arr5);
     program_builder_free(p3);
-    #endif
-
-
-}
-
-void test_interp_get_var_context(void){
-
-    // test #1 - setting a variable to a scalar
-    Program* p1 = program_builder_init();
-    program_builder_add(p1, "SET");
-    program_builder_add(p1, "$A");
-    program_builder_add(p1, ":=");
-    program_builder_add(p1, "3");
-    program_builder_add(p1, ";");
-    p1->current_token = 6;
-    char* var1 = _interp_get_var_context(p1);
-    assert(var1);
-    assert(STRINGS_EQUAL(var1, "$A"));
-    program_builder_free(p1);
-
-    // test #2 - setting a vector
-    Program* p2 = program_builder_init();
-    program_builder_add(p2, "SET");
-    program_builder_add(p2, "$X");
-    program_builder_add(p2, ":=");
-    program_builder_add(p2, "ONES");
-    program_builder_add(p2, "5");
-    program_builder_add(p2, "3");
-    program_builder_add(p2, ";");
-    p2->current_token = 8;
-    char* var2 = _interp_get_var_context(p2);
-    assert(var2);
-    assert(STRINGS_EQUAL(var2, "$X"));
-    program_builder_free(p2);
-
-    // test #3 - setting a variable to a variable
-    Program* p3 = program_builder_init();
-    program_builder_add(p3, "SET");
-    program_builder_add(p3, "$I");
-    program_builder_add(p3, ":=");
-    program_builder_add(p3, "$J");
-    program_builder_add(p3, ";");
-    p3->current_token = 6;
-    char* var3 = _interp_get_var_context(p3);
-    assert(var3);
-    assert(STRINGS_EQUAL(var3, "$I"));
-    program_builder_free(p3);
 
-    // test #4 - setting a variable to an operation
+    // test #4 - the target is only written at the ";", so a later
+    // use of it in the same expression still sees the old value
     Program* p4 = program_builder_init();
     program_builder_add(p4, "SET");
-    program_builder_add(p4, "$X");
+    program_builder_add(p4, "$A");
     program_builder_add(p4, ":=");
-    program_builder_add(p4, "$Y");
-    program_builder_add(p4, "$Z");
-    program_builder_add(p4, "B-TIMES");
+    program_builder_add(p4, "$A");
+    program_builder_add(p4, "1");
+    program_builder_add(p4, "B-ADD");
+    program_builder_add(p4, "$A");
+    program_builder_add(p4, "B-ADD");
     program_builder_add(p4, ";");
-    p4->current_token = 8;
-    char* var4 = _interp_get_var_context(p4);
-    assert(var4);
-    assert(STRINGS_EQUAL(var4, "$X"));
+    nlab_array* arr6 = nlab_array_create_1d(1);
+    map_add(p4->variable_map, "$A", arr6);
+    assert(set(p4));
+    assert(nlab_array_get(map_get_key_value(p4->variable_map, "$A"), 0, 0) == 3);
+    nlab_array_free(arr6);
     program_builder_free(p4);
 
-    // test #5 - setting a variable to chained operations
+    // test #5 - an expression that doesn't reduce to one value leaves
+    // the target untouched, partial results included
     Program* p5 = program_builder_init();
     program_builder_add(p5, "SET");
-    program_builder_add(p5, "$X");
-    program_builder_add(p5, ":=");
     program_builder_add(p5, "$A");
-    program_builder_add(p5, "$B");
-    program_builder_add(p5, "B-TIMES");
-    program_builder_add(p5, "$C");
-    program_builder_add(p5, "B-OR");
+    program_builder_add(p5, ":=");
+    program_builder_add(p5, "1");
+    program_builder_add(p5, "2");
+    program_builder_add(p5, "B-ADD");
+    program_builder_add(p5, "3");
     program_builder_add(p5, ";");
-    p5->current_token = 10;
-    char* var5 = _interp_get_var_context(p5);
-    assert(var5);
-    assert(STRINGS_EQUAL(var5, "$X"));
+    assert(set(p5));
+    assert(!map_contains_key(p5->variable_map, "$A"));
     program_builder_free(p5);
-
-
+    #endif
 }
 
 void test_interp_u_not(void){
@@ -1741,18 +1680,18 @@ void test_interp_u_not(void){
     // test #1 - a single array [[0, 1],[1, 0]] is on the stack.
     Program* p1 = program_builder_init();
     nlab_array* arr1 = nlab_array_create_ones(2,2);
-    arr1->array[0][0] = 0;
-    arr1->array[1][1] = 0;
+    nlab_array_set(arr1, 0, 0, 0);
+    nlab_array_set(arr1, 1, 1, 0);
     stack_push(p1->polish_stack, arr1);
     assert(p1->polish_stack->size == 1);
 
     assert(interp_u_not(p1));
     nlab_array* unot = stack_peek(p1->polish_stack);
     assert(p1->polish_stack->size == 1);
-    assert(unot->array[0][0] == true);
-    assert(unot->array[0][1] == false);
-    assert(unot->array[1][0] == false);
-    assert(unot->array[1][1] == true);
+    assert(nlab_array_get(unot, 0, 0) == true);
+    assert(nlab_array_get(unot, 0, 1) == false);
+    assert(nlab_array_get(unot, 1, 0) == false);
+    assert(nlab_array_get(unot, 1, 1) == true);
 
     // test #2 - try and NULL pointers
     assert(!interp_u_not(NULL));
@@ -1760,20 +1699,20 @@ void test_interp_u_not(void){
     // test #3 - U-NOT on a non-boolean array
     Program* p2 = program_builder_init();
     nlab_array* arr2 = nlab_array_create_ones(2,2);
-    arr2->array[0][0] = 2;
-    arr2->array[0][1] = 4;
-    arr2->array[1][0] = 6;
-    arr2->array[1][1] = 8;
+    nlab_array_set(arr2, 0, 0, 2);
+    nlab_array_set(arr2, 0, 1, 4);
+    nlab_array_set(arr2, 1, 0, 6);
+    nlab_array_set(arr2, 1, 1, 8);
     stack_push(p2->polish_stack, arr2);
     assert(p2->polish_stack->size == 1);
 
     assert(interp_u_not(p2));
     nlab_array* unot2 = stack_peek(p2->polish_stack);
     assert(p2->polish_stack->size == 1);
-    assert(unot2->array[0][0] == 0);
-    assert(unot2->array[0][1] == 0);
-    assert(unot2->array[1][0] == 0);
-    assert(unot2->array[1][1] == 0);
+    assert(nlab_array_get(unot2, 0, 0) == 0);
+    assert(nlab_array_get(unot2, 0, 1) == 0);
+    assert(nlab_array_get(unot2, 1, 0) == 0);
+    assert(nlab_array_get(unot2, 1, 1) == 0);
 
     nlab_array_free(arr1);
     nlab_array_free(arr2);
@@ -1793,27 +1732,27 @@ void test_interp_u_eightcount(void){
     // [0 0 1]    [1 2 1]
     Program* p1 = program_builder_init();
     nlab_array* arr1 = nlab_array_create_ones(3,3);
-    arr1->array[0][1] = 0;
-    arr1->array[0][2] = 0;
-    arr1->array[1][0] = 0;
-    arr1->array[1][2] = 0;
-    arr1->array[2][0] = 0;
-    arr1->array[2][1] = 0;
+    nlab_array_set(arr1, 0, 1, 0);
+    nlab_array_set(arr1, 0, 2, 0);
+    nlab_array_set(arr1, 1, 0, 0);
+    nlab_array_set(arr1, 1, 2, 0);
+    nlab_array_set(arr1, 2, 0, 0);
+    nlab_array_set(arr1, 2, 1, 0);
     stack_push(p1->polish_stack, arr1);
     assert(p1->polish_stack->size == 1);
 
     assert(interp_u_eightcount(p1));
     assert(p1->polish_stack->size == 1);
     nlab_array* top = stack_peek(p1->polish_stack);
-    assert(top->array[0][0] == 1);
-    assert(top->array[0][1] == 2);
-    assert(top->array[0][2] == 1);
-    assert(top->array[1][0] == 2);
-    assert(top->array[1][1] == 2);
-    assert(top->array[1][2] == 2);
-    assert(top->array[2][0] == 1);
-    assert(top->array[2][1] == 2);
-    assert(top->array[2][2] == 1);
+    assert(nlab_array_get(top, 0, 0) == 1);
+    assert(nlab_array_get(top, 0, 1) == 2);
+    assert(nlab_array_get(top, 0, 2) == 1);
+    assert(nlab_array_get(top, 1, 0) == 2);
+    assert(nlab_array_get(top, 1, 1) == 2);
+    assert(nlab_array_get(top, 1, 2) == 2);
+    assert(nlab_array_get(top, 2, 0) == 1);
+    assert(nlab_array_get(top, 2, 1) == 2);
+    assert(nlab_array_get(top, 2, 2) == 1);
 
     // test #2 - no items on stack
     nlab_array* popped = stack_pop(p1->polish_stack);
@@ -1822,6 +1761,33 @@ void test_interp_u_eightcount(void){
     popped = NULL;
     nlab_array_free(arr1);
     program_builder_free(p1);
+
+    // test #3 - the running-sum kernel matches the direct count on single
+    // rows/columns, odd sizes and values other than 0/1, packed or not
+    unsigned int shapes[][2] = {{1, 1}, {1, 7}, {6, 1}, {2, 2}, {5, 70}, {9, 13}};
+    for(int s = 0; s < 6; s++){
+        nlab_array* arr3 = nlab_array_create_zeros(shapes[s][0], shapes[s][1]);
+        for(unsigned int y = 0; y < arr3->rows; y++){
+            for(unsigned int x = 0; x < arr3->cols; x++){
+                nlab_array_set(arr3, y, x, (x * 3 + y * 5) % 4 == 0 ? 1 : (int) ((x + y) % 3));
+            }
+        }
+        nlab_array* one3 = nlab_array_create_1d(1);
+        nlab_array* bool3 = _binop_scalar_vector(one3, arr3, binop_equals);
+        nlab_array* r3 = _eightcount(arr3);
+        nlab_array* rb3 = _eightcount(bool3);
+        for(unsigned int y = 0; y < arr3->rows; y++){
+            for(unsigned int x = 0; x < arr3->cols; x++){
+                assert(nlab_array_get(r3, y, x) == _calc_moore_neighbourhood(arr3, x, y));
+                assert(nlab_array_get(rb3, y, x) == _calc_moore_neighbourhood(arr3, x, y));
+            }
+        }
+        nlab_array_free(one3);
+        nlab_array_free(arr3);
+        nlab_array_free(bool3);
+        nlab_array_free(r3);
+        nlab_array_free(rb3);
+    }
 }
 
 void test_interp_b_and(void){
@@ -1836,7 +1802,7 @@ void test_interp_b_and(void){
     assert(interp_b_and(p1));
     assert(p1->polish_stack->size == 1);
     nlab_array* res1 = stack_peek(p1->polish_stack);
-    assert(res1->array[0][0] == 1);
+    assert(nlab_array_get(res1, 0, 0) == 1);
 
     nlab_array_free(arr1);
     nlab_array_free(arr2);
@@ -1855,7 +1821,7 @@ void test_interp_b_or(void){
     assert(interp_b_or(p1));
     assert(p1->polish_stack->size == 1);
     nlab_array* res1 = stack_peek(p1->polish_stack);
-    assert(res1->array[0][0] == 1);
+    assert(nlab_array_get(res1, 0, 0) == 1);
 
     nlab_array_free(arr1);
     nlab_array_free(arr2);
@@ -1866,25 +1832,25 @@ void test_interp_b_greater(void){
     Program* p1 = program_builder_init();
     // test #1 - test two arrays
     nlab_array* arr1 = nlab_array_create_ones(2,2);
-    arr1->array[0][0] = 4;
-    arr1->array[0][1] = 7;
-    arr1->array[1][0] = -1;
-    arr1->array[1][1] = 4;
+    nlab_array_set(arr1, 0, 0, 4);
+    nlab_array_set(arr1, 0, 1, 7);
+    nlab_array_set(arr1, 1, 0, -1);
+    nlab_array_set(arr1, 1, 1, 4);
     nlab_array* arr2 = nlab_array_create_ones(2,2);
-    arr2->array[0][0] = 0;
-    arr2->array[0][1] = 3;
-    arr2->array[1][0] = 5;
-    arr2->array[1][1] = 4;
+    nlab_array_set(arr2, 0, 0, 0);
+    nlab_array_set(arr2, 0, 1, 3);
+    nlab_array_set(arr2, 1, 0, 5);
+    nlab_array_set(arr2, 1, 1, 4);
     assert(stack_push(p1->polish_stack, arr1));
     assert(stack_push(p1->polish_stack, arr2));
     assert(p1->polish_stack->size == 2);
     assert(interp_b_greater(p1));
     assert(p1->polish_stack->size == 1);
     nlab_array* result1 = stack_peek(p1->polish_stack);
-    assert(result1->array[0][0] == 1);
-    assert(result1->array[0][1] == 1);
-    assert(result1->array[1][0] == 0);
-    assert(result1->array[1][1] == 0);
+    assert(nlab_array_get(result1, 0, 0) == 1);
+    assert(nlab_array_get(result1, 0, 1) == 1);
+    assert(nlab_array_get(result1, 1, 0) == 0);
+    assert(nlab_array_get(result1, 1, 1) == 0);
 
     nlab_array_free(arr1);
     nlab_array_free(arr2);
@@ -1895,25 +1861,25 @@ void test_interp_b_less(void){
     Program* p1 = program_builder_init();
     // test #1 - test two arrays
     nlab_array* arr1 = nlab_array_create_ones(2,2);
-    arr1->array[0][0] = 4;
-    arr1->array[0][1] = 7;
-    arr1->array[1][0] = -1;
-    arr1->array[1][1] = 4;
+    nlab_array_set(arr1, 0, 0, 4);
+    nlab_array_set(arr1, 0, 1, 7);
+    nlab_array_set(arr1, 1, 0, -1);
+    nlab_array_set(arr1, 1, 1, 4);
     nlab_array* arr2 = nlab_array_create_ones(2,2);
-    arr2->array[0][0] = 0;
-    arr2->array[0][1] = 3;
-    arr2->array[1][0] = 5;
-    arr2->array[1][1] = 4;
+    nlab_array_set(arr2, 0, 0, 0);
+    nlab_array_set(arr2, 0, 1, 3);
+    nlab_array_set(arr2, 1, 0, 5);
+    nlab_array_set(arr2, 1, 1, 4);
     assert(stack_push(p1->polish_stack, arr1));
     assert(stack_push(p1->polish_stack, arr2));
     assert(p1->polish_stack->size == 2);
     assert(interp_b_less(p1));
     assert(p1->polish_stack->size == 1);
     nlab_array* result1 = stack_peek(p1->polish_stack);
-    assert(result1->array[0][0] == 0);
-    assert(result1->array[0][1] == 0);
-    assert(result1->array[1][0] == 1);
-    assert(result1->array[1][1] == 0);
+    assert(nlab_array_get(result1, 0, 0) == 0);
+    assert(nlab_array_get(result1, 0, 1) == 0);
+    assert(nlab_array_get(result1, 1, 0) == 1);
+    assert(nlab_array_get(result1, 1, 1) == 0);
 
     nlab_array_free(arr1);
     nlab_array_free(arr2);
@@ -1933,7 +1899,7 @@ void test_interp_b_add(void){
     nlab_array* result = stack_peek(p1->polish_stack);
     for(int y = 0; y < 6; y++){
         for(int x = 0; x < 5; x++){
-            assert(result->array[y][x] == 3);
+            assert(nlab_array_get(result, y, x) == 3);
         }
     }
     program_builder_free(p1);
@@ -1950,7 +1916,7 @@ void test_interp_b_add(void){
     nlab_array* result2 = stack_peek(p2->polish_stack);
     for(int y = 0; y < 4; y++){
         for(int x = 0; x < 4; x++){
-            assert(result2->array[y][x] == 2);
+            assert(nlab_array_get(result2, y, x) == 2);
         }
     }
     program_builder_free(p2);
@@ -1988,7 +1954,7 @@ void test_interp_b_times(void){
     nlab_array* res1 = stack_peek(p1->polish_stack);
     for(int y = 0; y < 1; y++){
         for(int x = 0; x < 4; x++){
-            assert(res1->array[y][x] == 7);
+            assert(nlab_array_get(res1, y, x) == 7);
         }
     }
 
@@ -2001,27 +1967,27 @@ void test_interp_b_times(void){
     assert(interp_b_times(p1));
     assert(p1->polish_stack->size == 2);
     nlab_array* res2 = stack_peek(p1->polish_stack);
-    assert(res2->array[0][0] == 21);
+    assert(nlab_array_get(res2, 0, 0) == 21);
 
     // test #1 - TWOS TWOS => FOURS
     nlab_array* arr5 = nlab_array_create_ones(2,2);
-    arr5->array[0][0] = 2;
-    arr5->array[0][1] = 2;
-    arr5->array[1][0] = 2;
-    arr5->array[1][1] = 2;
+    nlab_array_set(arr5, 0, 0, 2);
+    nlab_array_set(arr5, 0, 1, 2);
+    nlab_array_set(arr5, 1, 0, 2);
+    nlab_array_set(arr5, 1, 1, 2);
     nlab_array* arr6 = nlab_array_create_ones(2,2);
-    arr6->array[0][0] = 2;
-    arr6->array[0][1] = 2;
-    arr6->array[1][0] = 2;
-    arr6->array[1][1] = 2;
+    nlab_array_set(arr6, 0, 0, 2);
+    nlab_array_set(arr6, 0, 1, 2);
+    nlab_array_set(arr6, 1, 0, 2);
+    nlab_array_set(arr6, 1, 1, 2);
     assert(stack_push(p1->polish_stack, arr5));
     assert(stack_push(p1->polish_stack, arr6));
     assert(interp_b_times(p1));
     nlab_array* res3 = stack_peek(p1->polish_stack);
-    assert(res3->array[0][0] == 4);
-    assert(res3->array[0][1] == 4);
-    assert(res3->array[1][0] == 4);
-    assert(res3->array[1][1] == 4);
+    assert(nlab_array_get(res3, 0, 0) == 4);
+    assert(nlab_array_get(res3, 0, 1) == 4);
+    assert(nlab_array_get(res3, 1, 0) == 4);
+    assert(nlab_array_get(res3, 1, 1) == 4);
 
     nlab_array_free(arr1);
     nlab_array_free(arr2);
@@ -2036,15 +2002,15 @@ void test_interp_b_equals(void){
     Program* p1 = program_builder_init();
 
     nlab_array* v1 = nlab_array_create_ones(2,4);
-    v1->array[0][0] = 2;
-    v1->array[0][1] = 2;
-    v1->array[1][0] = 4;
-    v1->array[1][1] = 4;
+    nlab_array_set(v1, 0, 0, 2);
+    nlab_array_set(v1, 0, 1, 2);
+    nlab_array_set(v1, 1, 0, 4);
+    nlab_array_set(v1, 1, 1, 4);
     nlab_array* v2 = nlab_array_create_ones(1,4);
-    v2->array[0][0] = 2;
-    v2->array[0][1] = 2;
-    v2->array[0][2] = 2;
-    v2->array[0][3] = 2;
+    nlab_array_set(v2, 0, 0, 2);
+    nlab_array_set(v2, 0, 1, 2);
+    nlab_array_set(v2, 0, 2, 2);
+    nlab_array_set(v2, 0, 3, 2);
     nlab_array* s1 = nlab_array_create_1d(2);
     nlab_array* s2 = nlab_array_create_1d(5);
 
@@ -2062,10 +2028,10 @@ void test_interp_b_equals(void){
     assert(interp_b_equals(p1));
     assert(p1->polish_stack->size == 1);
     nlab_array* res2 = stack_peek(p1->polish_stack);
-    assert(res2->array[0][0] == 1);
-    assert(res2->array[0][1] == 1);
-    assert(res2->array[1][0] == 0);
-    assert(res2->array[1][1] == 0);
+    assert(nlab_array_get(res2, 0, 0) == 1);
+    assert(nlab_array_get(res2, 0, 1) == 1);
+    assert(nlab_array_get(res2, 1, 0) == 0);
+    assert(nlab_array_get(res2, 1, 1) == 0);
     
     // test #3 - two scalars not equal
     assert(stack_push(p1->polish_stack, s1));
@@ -2074,7 +2040,7 @@ void test_interp_b_equals(void){
     assert(interp_b_equals(p1));
     assert(p1->polish_stack->size == 2);
     nlab_array* res3 = stack_peek(p1->polish_stack);
-    assert(res3->array[0][0] == 0);
+    assert(nlab_array_get(res3, 0, 0) == 0);
     
     nlab_array_free(v1);
     nlab_array_free(v2);
@@ -2089,6 +2055,806 @@ void test_interp_loop(void){
     // moved these tests into parsing test function test_loop();
 }
 
+void test_interp_arena(void){
+
+    #ifdef INTERP
+    // test #1 - once a LOOP's variables have their shapes, an iteration mallocs nothing
+    char* tokens[] = {"BEGIN", "{", "ONES", "40", "30", "$A", "SET", "$B", ":=", "0", ";",
+                      "LOOP", "$I", "50", "{",
+                      "SET", "$A", ":=", "$A", "$I", "B-ADD", "2", "B-TIMES", "$A", "B-ADD", ";",
+                      "SET", "$B", ":=", "$A", "U-NOT", "U-NOT", ";",
+                      "SET", "$A", ":=", "$A", "1", "B-TIMES", ";",
+                      "}", "}"};
+    Program* p1 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens) / sizeof(tokens[0]); i++){
+        program_builder_add(p1, tokens[i]);
+    }
+    assert(program(p1));
+    assert(p1->last_iteration_heap_allocs == 0);
+    assert(arena_num_chunk_allocs(p1->scratch_arena) == 1);
+    // stored results were moved out of the scratch arena, and are still right after it's reset
+    nlab_array* a = map_get_key_value(p1->variable_map, "$A");
+    assert(!nlab_array_in_arena(a, p1->scratch_arena));
+    assert(!nlab_array_in_arena(map_get_key_value(p1->variable_map, "$B"), p1->scratch_arena));
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$B"), 0, 0) == 1);
+    // A = 3A + 2I each time round, so the values overflow - check against the same arithmetic
+    int expected = 1;
+    for(int i = 1; i <= 50; i++){
+        expected = (int) ((unsigned int) expected * 3u + 2u * (unsigned int) i);
+    }
+    assert(nlab_array_get(a, 39, 29) == expected);
+    // literals are kept in the program arena
+    assert(arena_owns(p1->program_arena, bytecode_at(p1->bytecode, 1)->constant));
+    program_builder_free(p1);
+    #endif
+}
+
+// how many of the compiled instructions are op
+int _count_ops(Program* prog, opcode op){
+
+    int count = 0;
+
+    for(int i = 0; i < prog->bytecode->size; i++){
+        count += bytecode_at(prog->bytecode, i)->op == op;
+    }
+    return count;
+}
+
+void test_interp_hoist(void){
+
+    #ifdef INTERP
+    // test #1 - $B reads nothing either loop writes, so runs once; $D depends on
+    // $I, so runs once per entry of the inner loop; $C and $E change every time
+    char* tokens[] = {"BEGIN", "{", "ONES", "3", "3", "$A", "SET", "$C", ":=", "0", ";",
+                      "LOOP", "$I", "5", "{",
+                      "LOOP", "$J", "4", "{",
+                      "SET", "$B", ":=", "$A", "U-NOT", "$A", "B-OR", ";",
+                      "SET", "$C", ":=", "$C", "$B", "B-ADD", ";",
+                      "SET", "$D", ":=", "$I", "2", "B-TIMES", ";",
+                      "SET", "$E", ":=", "$C", "1", "B-ADD", ";",
+                      "}", "}", "}"};
+    Program* p1 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens) / sizeof(tokens[0]); i++){
+        program_builder_add(p1, tokens[i]);
+    }
+    assert(program(p1));
+    assert(_count_ops(p1, op_invariant) == 2);
+    int outer = -1, inner = -1;
+    for(int i = 0; i < p1->bytecode->size; i++){
+        if(bytecode_at(p1->bytecode, i)->op == op_loop_begin){
+            inner = outer == -1 ? inner : i;
+            outer = outer == -1 ? i : outer;
+        }
+    }
+    for(int i = 0; i < p1->bytecode->size; i++){
+        instruction* instr = bytecode_at(p1->bytecode, i);
+        if(instr->op == op_invariant){
+            // the marker skips to just past its SET's op_set_end
+            assert(bytecode_at(p1->bytecode, instr->jump - 1)->op == op_set_end);
+            if(bytecode_at(p1->bytecode, instr->jump - 1)->slot == map_get_keycode("$B")){
+                assert(instr->loop == outer && instr->operand2 == 1);
+            } else{
+                assert(instr->loop == inner && instr->operand2 == 5);
+            }
+        }
+    }
+    assert(bytecode_at(p1->bytecode, inner)->operand2 == 5);
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$C"), 2, 2) == 20);
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$E"), 0, 0) == 21);
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$D"), 0, 0) == 10);
+    program_builder_free(p1);
+
+    // test #2 - a SET that leaves values on the stack changes what later ones
+    // do, so nothing is hoisted after one
+    char* tokens2[] = {"BEGIN", "{", "SET", "$X", ":=", "1", "2", ";",
+                       "LOOP", "$I", "3", "{", "SET", "$B", ":=", "7", ";", "}", "}"};
+    Program* p2 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens2) / sizeof(tokens2[0]); i++){
+        program_builder_add(p2, tokens2[i]);
+    }
+    assert(program(p2));
+    assert(_count_ops(p2, op_invariant) == 0);
+    program_builder_free(p2);
+    #endif
+}
+
+void test_interp_cse(void){
+
+    #ifdef INTERP
+    // test #1 - both comparisons count $A's neighbours once, and the second
+    // time round the loop the cache starts empty again
+    char* tokens[] = {"BEGIN", "{", "READ", "\"arrays/lglider.arr\"", "$A",
+                      "LOOP", "$I", "2", "{",
+                      "SET", "$C", ":=", "$A", "U-EIGHTCOUNT", "3", "B-EQUALS",
+                      "$A", "U-EIGHTCOUNT", "2", "B-EQUALS", "B-OR", ";",
+                      "SET", "$D", ":=", "$I", "3", "B-ADD", "$I", "3", "B-ADD", "B-TIMES", ";",
+                      "}", "}"};
+    Program* p1 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens) / sizeof(tokens[0]); i++){
+        program_builder_add(p1, tokens[i]);
+    }
+    assert(program(p1));
+    assert(_count_ops(p1, op_cache_store) == 2);
+    assert(_count_ops(p1, op_cache_load) == 2);
+    assert(_count_ops(p1, op_unary) == 1);
+    assert(p1->cse_values->size == 0);
+    nlab_array* a = map_get_key_value(p1->variable_map, "$A");
+    nlab_array* c = map_get_key_value(p1->variable_map, "$C");
+    for(unsigned int y = 0; y < a->rows; y++){
+        for(unsigned int x = 0; x < a->cols; x++){
+            int neighbours = _calc_moore_neighbourhood(a, (int) x, (int) y);
+            assert(nlab_array_get(c, y, x) == (neighbours == 3 || neighbours == 2));
+        }
+    }
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$D"), 0, 0) == 25);
+    program_builder_free(p1);
+
+    // test #2 - only the largest repeat is replaced, not the repeats inside it
+    char* tokens2[] = {"BEGIN", "{", "ONES", "2", "70", "$A",
+                       "SET", "$B", ":=", "$A", "U-NOT", "U-NOT", "$A", "U-NOT", "U-NOT", "B-AND", ";", "}"};
+    Program* p2 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens2) / sizeof(tokens2[0]); i++){
+        program_builder_add(p2, tokens2[i]);
+    }
+    assert(program(p2));
+    assert(_count_ops(p2, op_cache_store) == 1);
+    assert(_count_ops(p2, op_cache_load) == 1);
+    assert(_count_ops(p2, op_push_var) == 1);
+    nlab_array* b = map_get_key_value(p2->variable_map, "$B");
+    assert(b->rows == 2 && b->cols == 70 && nlab_array_get(b, 1, 69) == 1);
+    program_builder_free(p2);
+    #endif
+}
+
+void test_interp_shapes(void){
+
+    #ifdef INTERP
+    // test #1 - a mismatch is reported before anything has run
+    char* tokens1[] = {"BEGIN", "{", "SET", "$X", ":=", "5", ";", "ONES", "2", "3", "$A", "ONES", "3", "2", "$B",
+                       "SET", "$C", ":=", "$A", "$B", "B-ADD", ";", "}"};
+    Program* p1 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens1) / sizeof(tokens1[0]); i++){
+        program_builder_add(p1, tokens1[i]);
+    }
+    assert(!program(p1));
+    assert(p1->error_state == error_interp);
+    assert(STRINGS_EQUAL(p1->error_msg, "B-ADD can't combine 2x3 and 3x2 arrays"));
+    assert(map_get_key_value(p1->variable_map, "$X") == NULL);
+    program_builder_free(p1);
+
+    // test #2 - ...including one only the second time round a loop
+    char* tokens2[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "ONES", "2", "2", "$B", "ONES", "1", "2", "$R",
+                       "LOOP", "$I", "3", "{", "SET", "$C", ":=", "$A", "$B", "B-ADD", ";",
+                       "SET", "$A", ":=", "$R", ";", "}", "}"};
+    Program* p2 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens2) / sizeof(tokens2[0]); i++){
+        program_builder_add(p2, tokens2[i]);
+    }
+    assert(!program(p2));
+    assert(STRINGS_EQUAL(p2->error_msg, "B-ADD can't combine 1x2 and 2x2 arrays"));
+    assert(map_get_key_value(p2->variable_map, "$C") == NULL);
+    program_builder_free(p2);
+
+    // test #3 - literal-only operators are folded into one literal
+    char* tokens3[] = {"BEGIN", "{", "SET", "$C", ":=", "2", "3", "B-ADD", "4", "B-TIMES", "U-NOT", "1", "B-OR", ";", "}"};
+    Program* p3 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens3) / sizeof(tokens3[0]); i++){
+        program_builder_add(p3, tokens3[i]);
+    }
+    assert(program(p3));
+    assert(_count_ops(p3, op_push_int) == 1);
+    assert(_count_ops(p3, op_binary) == 0 && _count_ops(p3, op_unary) == 0);
+    assert(nlab_array_get(map_get_key_value(p3->variable_map, "$C"), 0, 0) == 1);
+    program_builder_free(p3);
+
+    // test #4 - READ's shape comes from the file's header, and a missing file is left to the run
+    char* tokens4[] = {"BEGIN", "{", "READ", "\"arrays/lglider.arr\"", "$A", "ONES", "4", "4", "$B",
+                       "SET", "$C", ":=", "$A", "$B", "B-AND", ";", "}"};
+    Program* p4 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens4) / sizeof(tokens4[0]); i++){
+        program_builder_add(p4, tokens4[i]);
+    }
+    assert(!program(p4));
+    assert(STRINGS_EQUAL(p4->error_msg, "B-AND can't combine 5x5 and 4x4 arrays"));
+    assert(map_get_key_value(p4->variable_map, "$A") == NULL);
+    program_builder_free(p4);
+
+    char* tokens4b[] = {"BEGIN", "{", "READ", "\"arrays/missing.arr\"", "$A", "ONES", "4", "4", "$B",
+                        "SET", "$C", ":=", "$A", "$B", "B-AND", ";", "}"};
+    Program* p4b = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens4b) / sizeof(tokens4b[0]); i++){
+        program_builder_add(p4b, tokens4b[i]);
+    }
+    assert(!program(p4b));
+    assert(p4b->error_state == error_io);
+    assert(strncmp(p4b->error_msg, "unable to open file", strlen("unable to open file")) == 0);
+    program_builder_free(p4b);
+
+    #ifdef EXTENSION
+    // test #5 - the extension's operators have their own rules
+    char* tokens5[] = {"BEGIN", "{", "ONES", "2", "3", "$A", "SET", "$B", ":=", "$A", "$A", "U-TRANSPOSE", "B-DOTPRODUCT", ";",
+                       "SET", "$C", ":=", "$B", "U-TRACE", ";", "SET", "$D", ":=", "$A", "$A", "B-DOTPRODUCT", ";", "}"};
+    Program* p5 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens5) / sizeof(tokens5[0]); i++){
+        program_builder_add(p5, tokens5[i]);
+    }
+    assert(!program(p5));
+    assert(STRINGS_EQUAL(p5->error_msg, "B-DOTPRODUCT can't multiply 2x3 and 2x3 arrays"));
+    assert(map_get_key_value(p5->variable_map, "$B") == NULL);
+    program_builder_free(p5);
+    #endif
+
+    // test #6 - unbalanced SETs in nested LOOPs pile up more values than there's room for - unsure, not overrun
+    Program* p6 = program_builder_init();
+    p6->compile_only = true;
+    program_builder_add(p6, "BEGIN");
+    program_builder_add(p6, "{");
+    for(int depth = 0; depth < 3; depth++){
+        program_builder_add(p6, "LOOP");
+        program_builder_add(p6, depth == 0 ? "$I" : depth == 1 ? "$J" : "$K");
+        program_builder_add(p6, "4");
+        program_builder_add(p6, "{");
+    }
+    program_builder_add(p6, "SET");
+    program_builder_add(p6, "$A");
+    program_builder_add(p6, ":=");
+    for(int i = 0; i < 20; i++){
+        program_builder_add(p6, "1");
+    }
+    program_builder_add(p6, ";");
+    for(int depth = 0; depth < 4; depth++){
+        program_builder_add(p6, "}");
+    }
+    assert(program(p6));
+    assert(_interp_check_shapes(p6, 0) == shapes_unsure);
+    program_builder_free(p6);
+
+    // test #7 - a PRINT's variable is resolved when it's compiled, and checking leaves the bytecode as it was
+    Program* p7 = program_builder_init();
+    p7->compile_only = true;
+    program_builder_add(p7, "BEGIN");
+    program_builder_add(p7, "{");
+    program_builder_add(p7, "ONES");
+    program_builder_add(p7, "2");
+    program_builder_add(p7, "2");
+    program_builder_add(p7, "$C");
+    program_builder_add(p7, "PRINT");
+    program_builder_add(p7, "$C");
+    program_builder_add(p7, "}");
+    assert(program(p7));
+    assert(bytecode_at(p7->bytecode, 1)->op == op_print_var);
+    assert(bytecode_at(p7->bytecode, 1)->slot == map_get_keycode("$C"));
+    instruction before[2] = {*bytecode_at(p7->bytecode, 0), *bytecode_at(p7->bytecode, 1)};
+    assert(_interp_check_shapes(p7, 0) == shapes_ok);
+    assert(memcmp(before, p7->bytecode->code, sizeof(before)) == 0);
+    program_builder_free(p7);
+    // without the check having run at all
+    Program* p7b = program_builder_init();
+    p7b->compile_only = true;
+    program_builder_add(p7b, "PRINT");
+    program_builder_add(p7b, "$C");
+    assert(print(p7b));
+    assert(bytecode_at(p7b->bytecode, 0)->slot == map_get_keycode("$C"));
+    program_builder_free(p7b);
+    #endif
+}
+
+void test_interp_in_place(void){
+
+    #ifdef INTERP
+    // test #1 - an accumulating LOOP updates its array where it is, without allocating
+    char* tokens1[] = {"BEGIN", "{", "ONES", "200", "300", "$A", "SET", "$N", ":=", "0", ";",
+                       "LOOP", "$I", "20", "{", "SET", "$A", ":=", "$A", "2", "B-ADD", ";",
+                       "SET", "$N", ":=", "$N", "$I", "B-ADD", ";", "}", "}"};
+    Program* p1 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens1) / sizeof(tokens1[0]); i++){
+        program_builder_add(p1, tokens1[i]);
+    }
+    nlab_alloc_counts before1 = nlab_array_alloc_counts();
+    assert(program(p1));
+    assert(_count_ops(p1, op_in_place) == 2);
+    // the only arena allocations are the literals "0" and "2", made as the program is compiled
+    assert(nlab_array_alloc_counts().arena == before1.arena + 2);
+    assert(p1->last_iteration_heap_allocs == 0);
+    nlab_array* a = map_get_key_value(p1->variable_map, "$A");
+    assert(nlab_array_get(a, 0, 0) == 41 && nlab_array_get(a, 199, 299) == 41);
+    assert(NLAB_ROW(a, 0)[a->stride - 1] == 0);
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$N"), 0, 0) == 210);
+    program_builder_free(p1);
+
+    // test #2 - a buffer shared with another variable is copied first, and the target may be read twice
+    char* tokens2[] = {"BEGIN", "{", "ONES", "2", "3", "$A", "SET", "$B", ":=", "$A", ";",
+                       "SET", "$A", ":=", "$A", "$A", "B-ADD", "3", "B-TIMES", ";", "}"};
+    Program* p2 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens2) / sizeof(tokens2[0]); i++){
+        program_builder_add(p2, tokens2[i]);
+    }
+    assert(program(p2));
+    assert(_count_ops(p2, op_in_place) == 1 && _count_ops(p2, op_fused) == 1);
+    assert(nlab_array_get(map_get_key_value(p2->variable_map, "$A"), 1, 2) == 6);
+    assert(nlab_array_get(map_get_key_value(p2->variable_map, "$B"), 1, 2) == 1);
+    program_builder_free(p2);
+
+    // test #3 - bool results, other targets and changes of shape are stored as before
+    char* tokens3[] = {"BEGIN", "{", "ONES", "2", "3", "$A", "SET", "$S", ":=", "1", ";",
+                       "SET", "$C", ":=", "$A", "1", "B-LESS", ";", "SET", "$D", ":=", "$A", "1", "B-ADD", ";",
+                       "SET", "$S", ":=", "$S", "$A", "B-ADD", ";", "}"};
+    Program* p3 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens3) / sizeof(tokens3[0]); i++){
+        program_builder_add(p3, tokens3[i]);
+    }
+    assert(program(p3));
+    assert(_count_ops(p3, op_in_place) == 1);
+    nlab_array* s3 = map_get_key_value(p3->variable_map, "$S");
+    assert(s3->rows == 2 && s3->cols == 3 && nlab_array_get(s3, 1, 2) == 2);
+    assert(nlab_array_get(map_get_key_value(p3->variable_map, "$C"), 0, 0) == 0);
+    program_builder_free(p3);
+    #endif
+}
+
+void test_interp_move(void){
+
+    #ifdef INTERP
+    // test #1 - a ping-pong LOOP swaps its two buffers rather than copying one into the other
+    char* tokens1[] = {"BEGIN", "{", "READ", "\"arrays/lglider.arr\"", "$A",
+                       "LOOP", "$I", "3", "{", "SET", "$E", ":=", "$A", "U-NOT", ";", "SET", "$A", ":=", "$E", ";", "}", "}"};
+    Program* p1 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens1) / sizeof(tokens1[0]); i++){
+        program_builder_add(p1, tokens1[i]);
+    }
+    assert(program(p1));
+    assert(_count_ops(p1, op_move) == 1);
+    assert(p1->last_iteration_heap_allocs == 0);
+    nlab_array* a = map_get_key_value(p1->variable_map, "$A");
+    nlab_array* e = map_get_key_value(p1->variable_map, "$E");
+    assert(!nlab_array_is_shared(a) && !nlab_array_is_shared(e));
+    // lglider's middle row is 0 1 1 1 0, and A was negated three times
+    assert(nlab_array_get(a, 2, 0) == 1 && nlab_array_get(a, 2, 1) == 0);
+    program_builder_free(p1);
+
+    // test #2 - a source read later keeps its value, and an unset target is still just copied into
+    char* tokens2[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "SET", "$B", ":=", "$A", ";", "SET", "$C", ":=", "$A", ";",
+                       "PRINT", "$A", "SET", "$D", ":=", "$B", ";", "SET", "$B", ":=", "5", ";", "}"};
+    Program* p2 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens2) / sizeof(tokens2[0]); i++){
+        program_builder_add(p2, tokens2[i]);
+    }
+    assert(program(p2));
+    assert(_count_ops(p2, op_move) == 1);
+    assert(nlab_array_get(map_get_key_value(p2->variable_map, "$D"), 1, 1) == 1);
+    assert(nlab_array_get(map_get_key_value(p2->variable_map, "$B"), 0, 0) == 5);
+    program_builder_free(p2);
+
+    // test #3 - reads on the next pass of a LOOP count, and later passes swap
+    char* tokens3[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "LOOP", "$I", "2", "{",
+                       "SET", "$B", ":=", "$A", ";", "SET", "$C", ":=", "$A", ";", "SET", "$A", ":=", "$B", "1", "B-ADD", ";",
+                       "}", "}"};
+    Program* p3 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens3) / sizeof(tokens3[0]); i++){
+        program_builder_add(p3, tokens3[i]);
+    }
+    assert(program(p3));
+    assert(_count_ops(p3, op_move) == 1);
+    assert(bytecode_at(p3->bytecode, 2)->op == op_push_var && bytecode_at(p3->bytecode, 4)->op == op_move);
+    assert(nlab_array_get(map_get_key_value(p3->variable_map, "$A"), 0, 0) == 3);
+    assert(nlab_array_get(map_get_key_value(p3->variable_map, "$B"), 0, 0) == 2);
+    assert(nlab_array_get(map_get_key_value(p3->variable_map, "$C"), 1, 1) == 2);
+    program_builder_free(p3);
+    #endif
+}
+
+void test_interp_registers(void){
+
+    #ifdef INTERP
+    // test #1 - a SET left to the stack is run on registers, as many as its deepest point needs,
+    // and its operands are read where they are
+    char* tokens1[] = {"BEGIN", "{", "ONES", "3", "3", "$A", "SET", "$B", ":=", "$A", "U-EIGHTCOUNT", "3", "B-EQUALS", ";", "}"};
+    Program* p1 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens1) / sizeof(tokens1[0]); i++){
+        program_builder_add(p1, tokens1[i]);
+    }
+    assert(program(p1));
+    assert(_count_ops(p1, op_registers) == 1);
+    instruction* header = bytecode_at(p1->bytecode, 1);
+    assert(header->op == op_registers && header->operand == 2 && p1->num_registers >= 2);
+    assert(bytecode_at(p1->bytecode, header->jump)->op == op_set_end);
+    // a corner of a block of ones has 3 neighbours, and the middle 8
+    nlab_array* b = map_get_key_value(p1->variable_map, "$B");
+    assert(nlab_array_get(b, 0, 0) == 1 && nlab_array_get(b, 1, 1) == 0);
+    assert(!nlab_array_is_shared(map_get_key_value(p1->variable_map, "$A")));
+    program_builder_free(p1);
+
+    // test #2 - inside a LOOP the result is written over the target's buffer, so nothing's allocated after the first pass
+    char* tokens2[] = {"BEGIN", "{", "ONES", "3", "3", "$A", "LOOP", "$I", "3", "{",
+                       "SET", "$B", ":=", "$A", "U-EIGHTCOUNT", "$I", "B-ADD", ";", "}", "}"};
+    Program* p2 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens2) / sizeof(tokens2[0]); i++){
+        program_builder_add(p2, tokens2[i]);
+    }
+    assert(program(p2));
+    assert(_count_ops(p2, op_registers) == 1);
+    assert(p2->last_iteration_heap_allocs == 0);
+    b = map_get_key_value(p2->variable_map, "$B");
+    assert(nlab_array_get(b, 0, 0) == 6 && nlab_array_get(b, 1, 1) == 11);
+    program_builder_free(p2);
+
+    // test #3 - fused chains keep their own path, and a SET that can't be run on registers
+    // falls back to the stack, which reports the error
+    char* tokens3[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "SET", "$B", ":=", "$A", "1", "B-ADD", "2", "B-TIMES", ";",
+                       "SET", "$C", ":=", "$A", "$Z", "B-ADD", ";", "}"};
+    Program* p3 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens3) / sizeof(tokens3[0]); i++){
+        program_builder_add(p3, tokens3[i]);
+    }
+    assert(!program(p3));
+    assert(_count_ops(p3, op_registers) == 1 && _count_ops(p3, op_fused) == 1);
+    assert(nlab_array_get(map_get_key_value(p3->variable_map, "$B"), 1, 1) == 4);
+    assert(map_get_key_value(p3->variable_map, "$C") == NULL);
+    assert(p3->error_state == error_interp);
+    program_builder_free(p3);
+    #endif
+}
+
+void test_interp_release(void){
+
+    #ifdef INTERP
+    // test #1 - each variable is freed after the statement that last uses it, so nothing's left at the end
+    char* tokens1[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "SET", "$B", ":=", "$A", "1", "B-ADD", ";",
+                       "SET", "$C", ":=", "$B", "$B", "B-TIMES", ";", "PRINT", "$C", "}"};
+    nlab_alloc_counts before1 = nlab_array_alloc_counts();
+    Program* p1 = program_builder_init();
+    p1->release_dead_variables = true;
+    for(unsigned int i = 0; i < sizeof(tokens1) / sizeof(tokens1[0]); i++){
+        program_builder_add(p1, tokens1[i]);
+    }
+    assert(program(p1));
+    assert(_count_ops(p1, op_release) == 3);
+    int first_set = 0;
+    while(bytecode_at(p1->bytecode, first_set)->op != op_set_end){
+        first_set++;
+    }
+    assert(bytecode_at(p1->bytecode, first_set + 1)->op == op_release);
+    assert(bytecode_at(p1->bytecode, first_set + 1)->slot == map_get_keycode("$A"));
+    assert(map_get_key_value(p1->variable_map, "$A") == NULL);
+    assert(map_get_key_value(p1->variable_map, "$C") == NULL);
+    assert(nlab_array_alloc_counts().live_bytes == before1.live_bytes);
+    program_builder_free(p1);
+
+    // test #2 - in a LOOP, a variable the next pass reads before writing it is only released after the LOOP
+    char* tokens2[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "LOOP", "$I", "3", "{",
+                       "SET", "$B", ":=", "$A", "$I", "B-ADD", ";", "SET", "$A", ":=", "$B", "1", "B-ADD", ";", "}", "}"};
+    Program* p2 = program_builder_init();
+    p2->release_dead_variables = true;
+    for(unsigned int i = 0; i < sizeof(tokens2) / sizeof(tokens2[0]); i++){
+        program_builder_add(p2, tokens2[i]);
+    }
+    assert(program(p2));
+    // $A after $B's SET (as $A's SET writes it next), $B after $A's, and $A after the LOOP
+    assert(_count_ops(p2, op_release) == 3);
+    assert(bytecode_at(p2->bytecode, p2->bytecode->size - 2)->op == op_loop_end);
+    assert(bytecode_at(p2->bytecode, p2->bytecode->size - 1)->op == op_release);
+    assert(bytecode_at(p2->bytecode, p2->bytecode->size - 1)->slot == map_get_keycode("$A"));
+    assert(map_get_key_value(p2->variable_map, "$A") == NULL && map_get_key_value(p2->variable_map, "$B") == NULL);
+    program_builder_free(p2);
+
+    // test #3 - a SET skipped on later passes keeps its target for them
+    char* tokens3[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "LOOP", "$I", "3", "{",
+                       "SET", "$B", ":=", "$A", "U-NOT", ";", "SET", "$C", ":=", "$B", "$I", "B-ADD", ";", "}", "PRINT", "$C", "}"};
+    Program* p3 = program_builder_init();
+    p3->release_dead_variables = true;
+    for(unsigned int i = 0; i < sizeof(tokens3) / sizeof(tokens3[0]); i++){
+        program_builder_add(p3, tokens3[i]);
+    }
+    assert(program(p3));
+    assert(_count_ops(p3, op_invariant) == 1);
+    assert(map_get_key_value(p3->variable_map, "$B") == NULL && map_get_key_value(p3->variable_map, "$C") == NULL);
+    program_builder_free(p3);
+
+    // test #4 - left off, every variable is kept
+    Program* p4 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens1) / sizeof(tokens1[0]); i++){
+        program_builder_add(p4, tokens1[i]);
+    }
+    assert(program(p4));
+    assert(_count_ops(p4, op_release) == 0);
+    assert(nlab_array_get(map_get_key_value(p4->variable_map, "$C"), 1, 1) == 4);
+    program_builder_free(p4);
+
+    // test #5 - a release put in front of a LOOP leaves its op_invariant naming the op_loop_begin,
+    // so the invariant SET still runs on the first pass
+    char* tokens5[] = {"BEGIN", "{", "ONES", "2", "3", "$D", "ONES", "2", "3", "$E", "SET", "$G", ":=", "$D", "$E", "B-ADD", ";",
+                       "LOOP", "$J", "3", "{", "SET", "$D", ":=", "$G", ";", "SET", "$G", ":=", "0", ";", "PRINT", "$D", "}", "}"};
+    Program* p5 = program_builder_init();
+    p5->release_dead_variables = true;
+    for(unsigned int i = 0; i < sizeof(tokens5) / sizeof(tokens5[0]); i++){
+        program_builder_add(p5, tokens5[i]);
+    }
+    assert(program(p5));
+    assert(_count_ops(p5, op_invariant) == 1);
+    for(int i = 0; i < p5->bytecode->size; i++){
+        instruction* marker = bytecode_at(p5->bytecode, i);
+        if(marker->op == op_invariant){
+            assert(bytecode_at(p5->bytecode, marker->loop)->op == op_loop_begin);
+            assert(marker->operand2 == 1);
+        }
+    }
+    program_builder_free(p5);
+    #endif
+}
+
+void test_interp_dead_stores(void){
+
+    #ifdef INTERP
+    // test #1 - a SET overwritten before it's read, and one never read, are dropped
+    char* tokens1[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "SET", "$B", ":=", "$A", "1", "B-ADD", ";",
+                       "SET", "$B", ":=", "$A", "$A", "B-TIMES", ";", "SET", "$C", ":=", "$A", "U-NOT", ";",
+                       "PRINT", "$B", "}"};
+    Program* p1 = program_builder_init();
+    p1->remove_dead_stores = true;
+    for(unsigned int i = 0; i < sizeof(tokens1) / sizeof(tokens1[0]); i++){
+        program_builder_add(p1, tokens1[i]);
+    }
+    assert(program(p1));
+    assert(_count_ops(p1, op_set_end) == 1);
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$B"), 1, 1) == 1);
+    assert(map_get_key_value(p1->variable_map, "$C") == NULL);
+    program_builder_free(p1);
+
+    // test #2 - a SET only read by a dropped one goes too, and a LOOP left empty still counts
+    char* tokens2[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "SET", "$T", ":=", "$A", "2", "B-TIMES", ";",
+                       "LOOP", "$I", "3", "{", "SET", "$U", ":=", "$T", "$I", "B-ADD", ";", "}", "PRINT", "$A", "}"};
+    Program* p2 = program_builder_init();
+    p2->remove_dead_stores = true;
+    for(unsigned int i = 0; i < sizeof(tokens2) / sizeof(tokens2[0]); i++){
+        program_builder_add(p2, tokens2[i]);
+    }
+    assert(program(p2));
+    assert(_count_ops(p2, op_set_end) == 0);
+    assert(bytecode_at(p2->bytecode, 2)->op == op_loop_end && bytecode_at(p2->bytecode, 2)->jump == 2);
+    assert(bytecode_at(p2->bytecode, 1)->jump == 3);
+    assert(map_get_key_value(p2->variable_map, "$I") == NULL && map_get_key_value(p2->variable_map, "$T") == NULL);
+    program_builder_free(p2);
+
+    // test #3 - a SET skipped on later passes is dropped with its op_invariant
+    char* tokens3[] = {"BEGIN", "{", "ONES", "2", "2", "$A", "ONES", "2", "2", "$C", "LOOP", "$I", "3", "{",
+                       "SET", "$B", ":=", "$A", "U-NOT", ";", "SET", "$C", ":=", "$C", "$I", "B-ADD", ";", "}",
+                       "PRINT", "$C", "}"};
+    Program* p3 = program_builder_init();
+    p3->remove_dead_stores = true;
+    for(unsigned int i = 0; i < sizeof(tokens3) / sizeof(tokens3[0]); i++){
+        program_builder_add(p3, tokens3[i]);
+    }
+    assert(program(p3));
+    assert(_count_ops(p3, op_set_end) == 1 && _count_ops(p3, op_invariant) == 0);
+    assert(nlab_array_get(map_get_key_value(p3->variable_map, "$C"), 0, 0) == 7);
+    assert(map_get_key_value(p3->variable_map, "$B") == NULL);
+    program_builder_free(p3);
+
+    // test #4 - a SET the shape check couldn't follow is kept, so the run still fails on it
+    char* tokens4[] = {"BEGIN", "{", "SET", "$B", ":=", "$X", "1", "B-ADD", ";", "}"};
+    Program* p4 = program_builder_init();
+    p4->remove_dead_stores = true;
+    for(unsigned int i = 0; i < sizeof(tokens4) / sizeof(tokens4[0]); i++){
+        program_builder_add(p4, tokens4[i]);
+    }
+    assert(!program(p4));
+    assert(_count_ops(p4, op_set_end) == 1);
+    assert(p4->error_state == error_interp);
+    program_builder_free(p4);
+
+    // test #5 - left off, every SET is kept
+    Program* p5 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens1) / sizeof(tokens1[0]); i++){
+        program_builder_add(p5, tokens1[i]);
+    }
+    assert(program(p5));
+    assert(_count_ops(p5, op_set_end) == 3);
+    assert(nlab_array_get(map_get_key_value(p5->variable_map, "$C"), 0, 0) == 0);
+    program_builder_free(p5);
+    #endif
+}
+
+void test_interp_execute(void){
+
+    #ifdef INTERP
+    // test #1 - a LOOP body is compiled once, and run once per iteration
+    Program* p1 = program_builder_init();
+    program_builder_add(p1, "BEGIN");
+    program_builder_add(p1, "{");
+    program_builder_add(p1, "SET");
+    program_builder_add(p1, "$F");
+    program_builder_add(p1, ":=");
+    program_builder_add(p1, "1");
+    program_builder_add(p1, ";");
+    program_builder_add(p1, "LOOP");
+    program_builder_add(p1, "$I");
+    program_builder_add(p1, "5");
+    program_builder_add(p1, "{");
+    program_builder_add(p1, "SET");
+    program_builder_add(p1, "$F");
+    program_builder_add(p1, ":=");
+    program_builder_add(p1, "$F");
+    program_builder_add(p1, "$I");
+    program_builder_add(p1, "B-TIMES");
+    program_builder_add(p1, ";");
+    program_builder_add(p1, "}");
+    program_builder_add(p1, "}");
+    assert(program(p1));
+    assert(p1->compile_depth == 0);
+    // SET (push, end) + LOOP begin + SET (in place, push, push, op, end) + LOOP end
+    assert(p1->bytecode->size == 9);
+    assert(bytecode_at(p1->bytecode, 2)->op == op_loop_begin);
+    assert(bytecode_at(p1->bytecode, 2)->jump == 9);
+    assert(bytecode_at(p1->bytecode, 8)->op == op_loop_end);
+    assert(bytecode_at(p1->bytecode, 8)->jump == 3);
+    assert(bytecode_at(p1->bytecode, 3)->op == op_in_place);
+    assert(bytecode_at(p1->bytecode, 3)->jump == 7);
+    assert(bytecode_at(p1->bytecode, 6)->op == op_binary);
+    assert(bytecode_at(p1->bytecode, 6)->operand == binop_times);
+    // 5! and the loop counter is gone once the loop is done
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$F"), 0, 0) == 120);
+    assert(!map_contains_key(p1->variable_map, "$I"));
+    program_builder_free(p1);
+
+    // test #2 - instructions inside a program aren't run until it's all compiled,
+    // so a later parse error means nothing runs - not even the PRINTs before it
+    Program* p2 = program_builder_init();
+    program_builder_add(p2, "BEGIN");
+    program_builder_add(p2, "{");
+    program_builder_add(p2, "SET");
+    program_builder_add(p2, "$A");
+    program_builder_add(p2, ":=");
+    program_builder_add(p2, "1");
+    program_builder_add(p2, ";");
+    program_builder_add(p2, "PRINT");
+    program_builder_add(p2, "$A");
+    program_builder_add(p2, "PRINT");
+    program_builder_add(p2, "A");
+    program_builder_add(p2, "}");
+    assert(!program(p2));
+    assert(p2->error_state == error_parse);
+    assert(!map_contains_key(p2->variable_map, "$A"));
+    // the PRINT $A was compiled, and would have failed on the unset $A had it run
+    assert(bytecode_at(p2->bytecode, 2)->op == op_print_var);
+    program_builder_free(p2);
+
+    // test #3 - run-time errors report the token the instruction came from
+    Program* p3 = program_builder_init();
+    program_builder_add(p3, "BEGIN");
+    program_builder_add(p3, "{");
+    program_builder_add(p3, "SET");
+    program_builder_add(p3, "$A");
+    program_builder_add(p3, ":=");
+    program_builder_add(p3, "$Q");
+    program_builder_add(p3, ";");
+    program_builder_add(p3, "}");
+    assert(!program(p3));
+    assert(p3->error_state == error_interp);
+    assert(STRINGS_EQUAL(p3->error_msg, "illegal use of uninitialized variable 2: \'$Q\'"));
+    program_builder_free(p3);
+    #endif
+}
+
+void test_interp_fused(void){
+
+    #ifdef INTERP
+    nlab_array* a = nlab_array_create_zeros(5, 300);
+    nlab_array* b = nlab_array_create_zeros(5, 300);
+    nlab_array* c = nlab_array_create_zeros(4, 300);
+    nlab_array* two = nlab_array_create_1d(2);
+    nlab_array *t1, *t2, *t3;
+    for(int y = 0; y < 5; y++){
+        for(int x = 0; x < 300; x++){
+            nlab_array_set(a, y, x, (x * 7 + y) % 3 == 0);
+            nlab_array_set(b, y, x, (x * 5 + y * 3) % 9);
+        }
+    }
+
+    // test #1 - part of the Life rule becomes one fused chain, and gives the
+    // same result as running the operators one by one
+    Program* p1 = program_builder_init();
+    program_builder_add(p1, "SET");
+    program_builder_add(p1, "$C");
+    program_builder_add(p1, ":=");
+    program_builder_add(p1, "$B");
+    program_builder_add(p1, "2");
+    program_builder_add(p1, "B-EQUALS");
+    program_builder_add(p1, "$A");
+    program_builder_add(p1, "B-OR");
+    program_builder_add(p1, "$A");
+    program_builder_add(p1, "B-AND");
+    program_builder_add(p1, ";");
+    map_add(p1->variable_map, "$A", a);
+    map_add(p1->variable_map, "$B", b);
+    assert(set(p1));
+    assert(bytecode_at(p1->bytecode, 0)->op == op_fused);
+    assert(bytecode_at(p1->bytecode, 0)->jump == 8);
+    assert(bytecode_at(p1->bytecode, 0)->operand == 0);
+    t1 = _binop_scalar_vector(two, b, binop_equals);
+    t2 = _binop_vector_vector(t1, a, binop_or);
+    t3 = _binop_vector_vector(t2, a, binop_and);
+    nlab_array* r1 = map_get_key_value(p1->variable_map, "$C");
+    assert(r1->kind == nlab_bool);
+    for(int y = 0; y < 5; y++){
+        for(int x = 0; x < 300; x++){
+            assert(nlab_array_get(r1, y, x) == nlab_array_get(t3, y, x));
+        }
+    }
+    nlab_array_free(t1);
+    nlab_array_free(t2);
+    nlab_array_free(t3);
+    program_builder_free(p1);
+
+    // test #2 - a chain can start from a value already on the stack, and a
+    // scalar pushed first is still compared as vector OP scalar
+    Program* p2 = program_builder_init();
+    program_builder_add(p2, "SET");
+    program_builder_add(p2, "$C");
+    program_builder_add(p2, ":=");
+    program_builder_add(p2, "$A");
+    program_builder_add(p2, "U-EIGHTCOUNT");
+    program_builder_add(p2, "2");
+    program_builder_add(p2, "B-LESS");
+    program_builder_add(p2, "U-NOT");
+    program_builder_add(p2, "1");
+    program_builder_add(p2, "B-ADD");
+    program_builder_add(p2, ";");
+    map_add(p2->variable_map, "$A", a);
+    assert(set(p2));
+    assert(bytecode_at(p2->bytecode, 2)->op == op_fused);
+    assert(bytecode_at(p2->bytecode, 2)->operand == 1);
+    nlab_array* r2 = map_get_key_value(p2->variable_map, "$C");
+    assert(r2->kind == nlab_int);
+    for(int y = 0; y < 5; y++){
+        for(int x = 0; x < 300; x++){
+            assert(nlab_array_get(r2, y, x) == (_calc_moore_neighbourhood(a, x, y) >= 2) + 1);
+        }
+    }
+    program_builder_free(p2);
+
+    // test #3 - scalars only, so the chain's own instructions run (a variable, so it isn't folded)
+    Program* p3 = program_builder_init();
+    program_builder_add(p3, "SET");
+    program_builder_add(p3, "$C");
+    program_builder_add(p3, ":=");
+    program_builder_add(p3, "$S");
+    program_builder_add(p3, "3");
+    program_builder_add(p3, "B-ADD");
+    program_builder_add(p3, "4");
+    program_builder_add(p3, "B-TIMES");
+    program_builder_add(p3, ";");
+    nlab_array* s3 = nlab_array_create_1d(2);
+    map_add(p3->variable_map, "$S", s3);
+    nlab_array_free(s3);
+    assert(set(p3));
+    assert(bytecode_at(p3->bytecode, 0)->op == op_fused);
+    assert(nlab_array_get(map_get_key_value(p3->variable_map, "$C"), 0, 0) == 20);
+    program_builder_free(p3);
+
+    // test #4 - mismatched shapes still fail
+    Program* p4 = program_builder_init();
+    program_builder_add(p4, "SET");
+    program_builder_add(p4, "$D");
+    program_builder_add(p4, ":=");
+    program_builder_add(p4, "$A");
+    program_builder_add(p4, "1");
+    program_builder_add(p4, "B-ADD");
+    program_builder_add(p4, "$C");
+    program_builder_add(p4, "B-ADD");
+    program_builder_add(p4, ";");
+    map_add(p4->variable_map, "$A", a);
+    map_add(p4->variable_map, "$C", c);
+    assert(!set(p4));
+    assert(STRINGS_EQUAL(p4->error_msg, "unable to interpret expression during SET"));
+    program_builder_free(p4);
+
+    nlab_array_free(a);
+    nlab_array_free(b);
+    nlab_array_free(c);
+    nlab_array_free(two);
+    #endif
+}
+
 void test_binop_scalar_vector(void){
 
     // test #1 - ONES 5 B-ADD
@@ -2098,7 +2864,7 @@ void test_binop_scalar_vector(void){
     assert(r1);
     for(int y = 0; y < 3; y++){
         for(int x = 0; x < 4; x++){
-            assert(r1->array[y][x] == 6);
+            assert(nlab_array_get(r1, y, x) == 6);
         }
     }
 
@@ -2109,7 +2875,7 @@ void test_binop_scalar_vector(void){
     assert(r2);
     for(int y = 0; y < 2; y++){
         for(int x = 0; x < 2; x++){
-            assert(r2->array[y][x] == -2);
+            assert(nlab_array_get(r2, y, x) == -2);
         }
     }
 
@@ -2125,16 +2891,16 @@ void test_binop_scalar_vector(void){
 
     // test #5 - THIRTEENS 60 B-AND
     nlab_array* v5 = nlab_array_create_ones(2,2);
-    v5->array[0][0] = 13;
-    v5->array[0][1] = 13;
-    v5->array[1][0] = 13;
-    v5->array[1][1] = 13;
+    nlab_array_set(v5, 0, 0, 13);
+    nlab_array_set(v5, 0, 1, 13);
+    nlab_array_set(v5, 1, 0, 13);
+    nlab_array_set(v5, 1, 1, 13);
     nlab_array* s5 = nlab_array_create_1d(60);
     nlab_array* r5 = _binop_scalar_vector(s5, v5, binop_and);
     assert(r5);
     for(int y = 0; y < 2; y++){
         for(int x = 0; x < 2; x++){
-            assert(r5->array[y][x] == 1);
+            assert(nlab_array_get(r5, y, x) == 1);
         }
     }
 
@@ -2158,7 +2924,7 @@ void test_binop_vector_vector(void){
     assert(r1);
     for(int y = 0; y < 3; y++){
         for(int x = 0; x < 4; x++){
-            assert(r1->array[y][x] == 2);
+            assert(nlab_array_get(r1, y, x) == 2);
         }
     }
 
@@ -2180,21 +2946,21 @@ void test_binop_vector_vector(void){
 
     // test #5 - B-AND a vector
     nlab_array* v5 = nlab_array_create_ones(2,2);
-    v5->array[0][0] = 0;
-    v5->array[0][1] = 2;
-    v5->array[1][0] = 0;
-    v5->array[1][1] = -4;
+    nlab_array_set(v5, 0, 0, 0);
+    nlab_array_set(v5, 0, 1, 2);
+    nlab_array_set(v5, 1, 0, 0);
+    nlab_array_set(v5, 1, 1, -4);
     nlab_array* v6 = nlab_array_create_ones(2,2);
-    v6->array[0][0] = 0;
-    v6->array[0][1] = 2;
-    v6->array[1][0] = 9;
-    v6->array[1][1] = 0;
+    nlab_array_set(v6, 0, 0, 0);
+    nlab_array_set(v6, 0, 1, 2);
+    nlab_array_set(v6, 1, 0, 9);
+    nlab_array_set(v6, 1, 1, 0);
     nlab_array* r4 = _binop_vector_vector(v5, v6, binop_and);
     assert(r4);
-    assert(r4->array[0][0] == 0);
-    assert(r4->array[0][1] == 1);
-    assert(r4->array[1][0] == 0);
-    assert(r4->array[1][1] == 0);
+    assert(nlab_array_get(r4, 0, 0) == 0);
+    assert(nlab_array_get(r4, 0, 1) == 1);
+    assert(nlab_array_get(r4, 1, 0) == 0);
+    assert(nlab_array_get(r4, 1, 1) == 0);
 
     nlab_array_free(v1);
     nlab_array_free(v2);
@@ -2215,7 +2981,7 @@ void test_binop_scalar_scalar(void){
     assert(r1);
     assert(r1->rows == 1);
     assert(r1->cols == 1);
-    assert(r1->array[0][0] == 8);
+    assert(nlab_array_get(r1, 0, 0) == 8);
 
     // test #2 - ONES -2 B-TIMES
     nlab_array* s3 = nlab_array_create_1d(3);
@@ -2224,7 +2990,7 @@ void test_binop_scalar_scalar(void){
     assert(r2);
     assert(r2->rows == 1);
     assert(r2->cols == 1);
-    assert(r2->array[0][0] == 15);
+    assert(nlab_array_get(r2, 0, 0) == 15);
 
     // test #3 - test some NULL values
     nlab_array* r3 = _binop_scalar_scalar(s1, NULL, binop_times);
@@ -2241,7 +3007,7 @@ void test_binop_scalar_scalar(void){
     nlab_array* s6 = nlab_array_create_1d(1);
     nlab_array* r4 = _binop_scalar_scalar(s5, s6, binop_and);
     assert(r4);
-    assert(r4->array[0][0] == 1);
+    assert(nlab_array_get(r4, 0, 0) == 1);
 
     nlab_array_free(s1);
     nlab_array_free(s2);
@@ -2254,20 +3020,103 @@ void test_binop_scalar_scalar(void){
     nlab_array_free(r4);
 }
 
+void test_binop_bool(void){
+
+    // 3x70 spans two words per row, so row padding bits get exercised too
+    unsigned int rows = 3, cols = 70;
+    binary_op ops[] = {binop_and, binop_or, binop_greater, binop_less, binop_add, binop_times, binop_equals};
+    short num_ops = 7;
+
+    // test #1 - logical results of int arrays are packed, arithmetic ones aren't
+    nlab_array* a = nlab_array_create_zeros(rows, cols);
+    nlab_array* b = nlab_array_create_zeros(rows, cols);
+    for(unsigned int y = 0; y < rows; y++){
+        for(unsigned int x = 0; x < cols; x++){
+            nlab_array_set(a, y, x, (x * 7 + y) % 3 == 0);
+            nlab_array_set(b, y, x, (x * 5 + y) % 2 == 0);
+        }
+    }
+    nlab_array* one = nlab_array_create_1d(1);
+    nlab_array* packed_a = _binop_scalar_vector(one, a, binop_equals);
+    assert(packed_a->kind == nlab_bool);
+    nlab_array* packed_b = _binop_vector_vector(b, b, binop_and);
+    assert(packed_b->kind == nlab_bool);
+    nlab_array* sum = _binop_vector_vector(a, b, binop_add);
+    assert(sum->kind == nlab_int);
+
+    // test #2 - every operator gives the same answer on packed and unpacked operands
+    nlab_array* scalars[3];
+    for(int v = 0; v < 3; v++){
+        scalars[v] = nlab_array_create_1d(v);
+    }
+    for(short op = 0; op < num_ops; op++){
+        nlab_array* expect_vv = _binop_vector_vector(a, b, ops[op]);
+        nlab_array* packed_vv = _binop_vector_vector(packed_a, packed_b, ops[op]);
+        nlab_array* mixed_vv = _binop_vector_vector(packed_a, b, ops[op]);
+        for(unsigned int y = 0; y < rows; y++){
+            for(unsigned int x = 0; x < cols; x++){
+                assert(nlab_array_get(expect_vv, y, x) == nlab_array_get(packed_vv, y, x));
+                assert(nlab_array_get(expect_vv, y, x) == nlab_array_get(mixed_vv, y, x));
+            }
+        }
+        for(int v = 0; v < 3; v++){
+            nlab_array* expect_sv = _binop_scalar_vector(scalars[v], a, ops[op]);
+            nlab_array* packed_sv = _binop_scalar_vector(scalars[v], packed_a, ops[op]);
+            for(unsigned int y = 0; y < rows; y++){
+                for(unsigned int x = 0; x < cols; x++){
+                    assert(nlab_array_get(expect_sv, y, x) == nlab_array_get(packed_sv, y, x));
+                }
+            }
+            nlab_array_free(expect_sv);
+            nlab_array_free(packed_sv);
+        }
+        nlab_array_free(expect_vv);
+        nlab_array_free(packed_vv);
+        nlab_array_free(mixed_vv);
+    }
+
+    // test #3 - U-NOT on a packed array flips every cell, but leaves the row padding clear
+    nlab_array* not_a = _unop_not(packed_a);
+    assert(not_a->kind == nlab_bool);
+    for(unsigned int y = 0; y < rows; y++){
+        for(unsigned int x = 0; x < cols; x++){
+            assert(nlab_array_get(not_a, y, x) == !nlab_array_get(a, y, x));
+        }
+        assert((NLAB_BITS_ROW(not_a, y)[1] >> (cols - NLAB_BITS_PER_WORD)) == 0);
+    }
+
+    // test #4 - writing a non-boolean value into a packed array widens it
+    nlab_array_set(not_a, 0, 0, 7);
+    assert(not_a->kind == nlab_int);
+    assert(nlab_array_get(not_a, 0, 0) == 7);
+    assert(nlab_array_get(not_a, 2, 69) == !nlab_array_get(a, 2, 69));
+
+    for(int v = 0; v < 3; v++){
+        nlab_array_free(scalars[v]);
+    }
+    nlab_array_free(one);
+    nlab_array_free(a);
+    nlab_array_free(b);
+    nlab_array_free(packed_a);
+    nlab_array_free(packed_b);
+    nlab_array_free(sum);
+    nlab_array_free(not_a);
+}
+
 #ifdef EXTENSION
 void test_extension_u_trace(){
     
     // test #1 - an example from Wiki 
     nlab_array* matrix1 = nlab_array_create_ones(3,3);
-    matrix1->array[0][0] = 5;
-    matrix1->array[0][1] = 3;
-    matrix1->array[0][2] = 5;
-    matrix1->array[1][0] = 4;
-    matrix1->array[1][1] = 1;
-    matrix1->array[1][2] = 2;
-    matrix1->array[2][0] = 3;
-    matrix1->array[2][1] = 8;
-    matrix1->array[2][2] = 7;
+    nlab_array_set(matrix1, 0, 0, 5);
+    nlab_array_set(matrix1, 0, 1, 3);
+    nlab_array_set(matrix1, 0, 2, 5);
+    nlab_array_set(matrix1, 1, 0, 4);
+    nlab_array_set(matrix1, 1, 1, 1);
+    nlab_array_set(matrix1, 1, 2, 2);
+    nlab_array_set(matrix1, 2, 0, 3);
+    nlab_array_set(matrix1, 2, 1, 8);
+    nlab_array_set(matrix1, 2, 2, 7);
     Program* p1 = program_builder_init();
     stack_push(p1->polish_stack, matrix1);
     assert(extension_u_trace(p1));
@@ -2275,18 +3124,18 @@ void test_extension_u_trace(){
     assert(result);
     assert(result->rows = 1);
     assert(result->cols = 1);
-    assert(result->array[0][0] == 13);
+    assert(nlab_array_get(result, 0, 0) == 13);
     nlab_array_free(matrix1);
     program_builder_free(p1);
 
     // test #2 - not NxN
     nlab_array* matrix2 = nlab_array_create_ones(2,3);
-    matrix2->array[0][0] = 5;
-    matrix2->array[0][1] = 3;
-    matrix2->array[0][2] = 5;
-    matrix2->array[1][0] = 4;
-    matrix2->array[1][1] = 1;
-    matrix2->array[1][2] = 2;
+    nlab_array_set(matrix2, 0, 0, 5);
+    nlab_array_set(matrix2, 0, 1, 3);
+    nlab_array_set(matrix2, 0, 2, 5);
+    nlab_array_set(matrix2, 1, 0, 4);
+    nlab_array_set(matrix2, 1, 1, 1);
+    nlab_array_set(matrix2, 1, 2, 2);
     Program* p2 = program_builder_init();
     stack_push(p2->polish_stack, matrix2);
     assert(!extension_u_trace(p2));
@@ -2302,12 +3151,12 @@ void test_extension_u_transpose(void){
 
     // test #1 - an example from Wiki 
     nlab_array* matrix1 = nlab_array_create_ones(2,3);
-    matrix1->array[0][0] = 1;
-    matrix1->array[0][1] = 2;
-    matrix1->array[0][2] = 3;
-    matrix1->array[1][0] = 0;
-    matrix1->array[1][1] = 2;
-    matrix1->array[1][2] = 7;
+    nlab_array_set(matrix1, 0, 0, 1);
+    nlab_array_set(matrix1, 0, 1, 2);
+    nlab_array_set(matrix1, 0, 2, 3);
+    nlab_array_set(matrix1, 1, 0, 0);
+    nlab_array_set(matrix1, 1, 1, 2);
+    nlab_array_set(matrix1, 1, 2, 7);
     Program* p1 = program_builder_init();
     stack_push(p1->polish_stack, matrix1);
     assert(extension_u_transpose(p1));
@@ -2315,35 +3164,56 @@ void test_extension_u_transpose(void){
     assert(result);
     assert(result->rows = 3);
     assert(result->cols = 2);
-    assert(result->array[0][0] == 1);
-    assert(result->array[0][1] == 0);
-    assert(result->array[1][0] == 2);
-    assert(result->array[1][1] == 2);
-    assert(result->array[2][0] == 3);
-    assert(result->array[2][1] == 7);
+    assert(nlab_array_get(result, 0, 0) == 1);
+    assert(nlab_array_get(result, 0, 1) == 0);
+    assert(nlab_array_get(result, 1, 0) == 2);
+    assert(nlab_array_get(result, 1, 1) == 2);
+    assert(nlab_array_get(result, 2, 0) == 3);
+    assert(nlab_array_get(result, 2, 1) == 7);
     nlab_array_free(matrix1);
     program_builder_free(p1);
 
     // test #2 - a NULL prog
     assert(!extension_u_transpose(NULL));
+
+    // test #3 - the result is a view on the same buffer, laid out only when an operator needs it
+    nlab_array* matrix3 = nlab_array_create_ones(2,3);
+    nlab_array_set(matrix3, 1, 2, 5);
+    Program* p3 = program_builder_init();
+    stack_push(p3->polish_stack, matrix3);
+    assert(extension_u_transpose(p3));
+    nlab_array* result3 = stack_peek(p3->polish_stack);
+    assert(nlab_array_is_view(result3));
+    assert(result3->data == matrix3->data);
+    nlab_array* one3 = nlab_array_create_1d(1);
+    stack_push(p3->polish_stack, one3);
+    assert(interp_b_add(p3));
+    result3 = stack_peek(p3->polish_stack);
+    assert(!nlab_array_is_view(result3));
+    assert(result3->rows == 3 && result3->cols == 2);
+    assert(nlab_array_get(result3, 2, 1) == 6);
+    assert(nlab_array_get(result3, 0, 1) == 2);
+    nlab_array_free(matrix3);
+    nlab_array_free(one3);
+    program_builder_free(p3);
 }
 
 void test_extension_u_submatrix(void){
 
     // test #1 - an example from Wiki 
     nlab_array* matrix1 = nlab_array_create_ones(3,4);
-    matrix1->array[0][0] = 1;
-    matrix1->array[0][1] = 2;
-    matrix1->array[0][2] = 3;
-    matrix1->array[0][3] = 4;
-    matrix1->array[1][0] = 5;
-    matrix1->array[1][1] = 6;
-    matrix1->array[1][2] = 7;
-    matrix1->array[1][3] = 8;
-    matrix1->array[2][0] = 9;
-    matrix1->array[2][1] = 10;
-    matrix1->array[2][2] = 11;
-    matrix1->array[2][3] = 12;
+    nlab_array_set(matrix1, 0, 0, 1);
+    nlab_array_set(matrix1, 0, 1, 2);
+    nlab_array_set(matrix1, 0, 2, 3);
+    nlab_array_set(matrix1, 0, 3, 4);
+    nlab_array_set(matrix1, 1, 0, 5);
+    nlab_array_set(matrix1, 1, 1, 6);
+    nlab_array_set(matrix1, 1, 2, 7);
+    nlab_array_set(matrix1, 1, 3, 8);
+    nlab_array_set(matrix1, 2, 0, 9);
+    nlab_array_set(matrix1, 2, 1, 10);
+    nlab_array_set(matrix1, 2, 2, 11);
+    nlab_array_set(matrix1, 2, 3, 12);
     nlab_array* rows = nlab_array_create_1d(3);
     nlab_array* cols = nlab_array_create_1d(2);
     Program* p1 = program_builder_init();
@@ -2355,12 +3225,12 @@ void test_extension_u_submatrix(void){
     assert(result);
     assert(result->rows = 2);
     assert(result->cols = 3);
-    assert(result->array[0][0] == 1);
-    assert(result->array[0][1] == 3);
-    assert(result->array[0][2] == 4);
-    assert(result->array[1][0] == 5);
-    assert(result->array[1][1] == 7);
-    assert(result->array[1][2] == 8);
+    assert(nlab_array_get(result, 0, 0) == 1);
+    assert(nlab_array_get(result, 0, 1) == 3);
+    assert(nlab_array_get(result, 0, 2) == 4);
+    assert(nlab_array_get(result, 1, 0) == 5);
+    assert(nlab_array_get(result, 1, 1) == 7);
+    assert(nlab_array_get(result, 1, 2) == 8);
     nlab_array_free(rows);
     nlab_array_free(cols);
     nlab_array_free(matrix1);
@@ -2371,10 +3241,10 @@ void test_extension_u_submatrix(void){
 
     // test #3 - range of rows is greater than matrix
     nlab_array* matrix2 = nlab_array_create_ones(2,2);
-    matrix2->array[0][0] = 0;
-    matrix2->array[0][1] = 1;
-    matrix2->array[1][0] = 0;
-    matrix2->array[1][1] = 1;
+    nlab_array_set(matrix2, 0, 0, 0);
+    nlab_array_set(matrix2, 0, 1, 1);
+    nlab_array_set(matrix2, 1, 0, 0);
+    nlab_array_set(matrix2, 1, 1, 1);
     nlab_array* rows2 = nlab_array_create_1d(3);
     nlab_array* cols2 = nlab_array_create_1d(2);
     Program* p2 = program_builder_init();
@@ -2389,10 +3259,10 @@ void test_extension_u_submatrix(void){
 
     // test #4 - range of cols is greater than matrix
     nlab_array* matrix3 = nlab_array_create_ones(2,2);
-    matrix3->array[0][0] = 0;
-    matrix3->array[0][1] = 1;
-    matrix3->array[1][0] = 0;
-    matrix3->array[1][1] = 1;
+    nlab_array_set(matrix3, 0, 0, 0);
+    nlab_array_set(matrix3, 0, 1, 1);
+    nlab_array_set(matrix3, 1, 0, 0);
+    nlab_array_set(matrix3, 1, 1, 1);
     nlab_array* two = nlab_array_create_1d(2);
     nlab_array* three = nlab_array_create_1d(3);
     Program* p3 = program_builder_init();
@@ -2408,10 +3278,10 @@ void test_extension_u_submatrix(void){
     // test #5 - whilst our code is zero-based, these array dim numbers
     // start at 1!
     nlab_array* matrix5 = nlab_array_create_ones(2,2);
-    matrix5->array[0][0] = 0;
-    matrix5->array[0][1] = 1;
-    matrix5->array[1][0] = 0;
-    matrix5->array[1][1] = 1;
+    nlab_array_set(matrix5, 0, 0, 0);
+    nlab_array_set(matrix5, 0, 1, 1);
+    nlab_array_set(matrix5, 1, 0, 0);
+    nlab_array_set(matrix5, 1, 1, 1);
     nlab_array* zero = nlab_array_create_1d(0);
     Program* p5 = program_builder_init();
     stack_push(p5->polish_stack, zero);
@@ -2422,25 +3292,124 @@ void test_extension_u_submatrix(void){
     nlab_array_free(matrix5);
     program_builder_free(p5);
 
+    // test #6 - the submatrix of a transpose is still a view on the original buffer
+    nlab_array* matrix6 = nlab_array_create_zeros(3,3);
+    for(unsigned int y = 0; y < 3; y++){
+        for(unsigned int x = 0; x < 3; x++){
+            nlab_array_set(matrix6, y, x, (int) (y * 3 + x));
+        }
+    }
+    nlab_array* one6 = nlab_array_create_1d(1);
+    Program* p6 = program_builder_init();
+    stack_push(p6->polish_stack, one6);
+    stack_push(p6->polish_stack, one6);
+    stack_push(p6->polish_stack, matrix6);
+    assert(extension_u_transpose(p6));
+    assert(extension_u_submatrix(p6));
+    nlab_array* result6 = stack_peek(p6->polish_stack);
+    assert(result6->data == matrix6->data);
+    assert(result6->rows == 2 && result6->cols == 2);
+    assert(nlab_array_get(result6, 0, 0) == 4);
+    assert(nlab_array_get(result6, 0, 1) == 7);
+    assert(nlab_array_get(result6, 1, 0) == 5);
+    assert(nlab_array_get(result6, 1, 1) == 8);
+    nlab_array_free(matrix6);
+    nlab_array_free(one6);
+    program_builder_free(p6);
+
+}
+
+void test_extension_u_lifestep(void){
+
+    // test #1 - one generation matches the B3/S23 rule from examples/lifeb3s23.nlb,
+    // across word boundaries and on every edge, from an int or a packed board
+    nlab_array* board = nlab_array_create_zeros(9, 150);
+    for(unsigned int y = 0; y < 9; y++){
+        for(unsigned int x = 0; x < 150; x++){
+            nlab_array_set(board, y, x, (x * x + y * 7 + x * y) % 5 < 2);
+        }
+    }
+    nlab_array* one = nlab_array_create_1d(1);
+    nlab_array* packed = _binop_scalar_vector(one, board, binop_equals);
+    Program* p1 = program_builder_init();
+    stack_push(p1->polish_stack, board);
+    assert(extension_u_lifestep(p1));
+    nlab_array* from_int = stack_peek(p1->polish_stack);
+    nlab_array* from_packed = _lifestep(packed, LIFE_BIRTH_B3, LIFE_SURVIVE_S23);
+    assert(from_int->kind == nlab_bool);
+    for(unsigned int y = 0; y < 9; y++){
+        for(unsigned int x = 0; x < 150; x++){
+            int count = _calc_moore_neighbourhood(board, x, y);
+            int expected = nlab_array_get(board, y, x) ? (count == 2 || count == 3) : count == 3;
+            assert(nlab_array_get(from_int, y, x) == expected);
+            assert(nlab_array_get(from_packed, y, x) == expected);
+        }
+    }
+    // padding past the last column stays clear
+    assert((NLAB_BITS_ROW(from_int, 4)[2] >> (150 - 128)) == 0);
+
+    // test #2 - other rules through the masks, e.g. B36/S23 (HighLife) and
+    // birth with no neighbours at all
+    nlab_array* highlife = _lifestep(packed, (1u << 3) | (1u << 6), LIFE_SURVIVE_S23);
+    nlab_array* b0 = _lifestep(packed, 1u, 0);
+    for(unsigned int y = 0; y < 9; y++){
+        for(unsigned int x = 0; x < 150; x++){
+            int count = _calc_moore_neighbourhood(board, x, y);
+            int alive = nlab_array_get(board, y, x);
+            assert(nlab_array_get(highlife, y, x) == (alive ? (count == 2 || count == 3) : (count == 3 || count == 6)));
+            assert(nlab_array_get(b0, y, x) == (!alive && count == 0));
+        }
+    }
+
+    // test #3 - nothing on the stack
+    Program* p3 = program_builder_init();
+    assert(!extension_u_lifestep(p3));
+    program_builder_free(p3);
+
+    // test #4 - a board that isn't 0/1: only 1s are alive, so 2s and -1s step as dead cells
+    nlab_array* mixed = nlab_array_copy(board);
+    for(unsigned int y = 0; y < 9; y++){
+        for(unsigned int x = 0; x < 150; x++){
+            if(nlab_array_get(mixed, y, x) == 0 && (x + y) % 3 != 0){
+                nlab_array_set(mixed, y, x, (x + y) % 3 == 1 ? 2 : -1);
+            }
+        }
+    }
+    nlab_array* from_mixed = _lifestep(mixed, LIFE_BIRTH_B3, LIFE_SURVIVE_S23);
+    for(unsigned int y = 0; y < 9; y++){
+        for(unsigned int x = 0; x < 150; x++){
+            assert(nlab_array_get(from_mixed, y, x) == nlab_array_get(from_int, y, x));
+        }
+    }
+    nlab_array_free(mixed);
+    nlab_array_free(from_mixed);
+
+    nlab_array_free(board);
+    nlab_array_free(one);
+    nlab_array_free(packed);
+    nlab_array_free(from_packed);
+    nlab_array_free(highlife);
+    nlab_array_free(b0);
+    program_builder_free(p1);
 }
 
 void test_extension_b_dotproduct(void){
 
     // test #1 - valid dot-product
     nlab_array* matrix1 = nlab_array_create_ones(2,3);
-    matrix1->array[0][0] = 1;
-    matrix1->array[0][1] = 2;
-    matrix1->array[0][2] = 3;
-    matrix1->array[1][0] = 4;
-    matrix1->array[1][1] = 5;
-    matrix1->array[1][2] = 6;
+    nlab_array_set(matrix1, 0, 0, 1);
+    nlab_array_set(matrix1, 0, 1, 2);
+    nlab_array_set(matrix1, 0, 2, 3);
+    nlab_array_set(matrix1, 1, 0, 4);
+    nlab_array_set(matrix1, 1, 1, 5);
+    nlab_array_set(matrix1, 1, 2, 6);
     nlab_array* matrix2 = nlab_array_create_ones(3,2);
-    matrix2->array[0][0] = 10;
-    matrix2->array[0][1] = 11;
-    matrix2->array[1][0] = 20;
-    matrix2->array[1][1] = 21;
-    matrix2->array[2][0] = 30;
-    matrix2->array[2][1] = 31;
+    nlab_array_set(matrix2, 0, 0, 10);
+    nlab_array_set(matrix2, 0, 1, 11);
+    nlab_array_set(matrix2, 1, 0, 20);
+    nlab_array_set(matrix2, 1, 1, 21);
+    nlab_array_set(matrix2, 2, 0, 30);
+    nlab_array_set(matrix2, 2, 1, 31);
     Program* p1 = program_builder_init();
     stack_push(p1->polish_stack, matrix1);
     stack_push(p1->polish_stack, matrix2);
@@ -2450,10 +3419,10 @@ void test_extension_b_dotproduct(void){
     assert(p1->polish_stack->size == 1);
     assert(result1->rows == 2);
     assert(result1->cols == 2);
-    assert(result1->array[0][0] == 140);
-    assert(result1->array[0][1] == 146);
-    assert(result1->array[1][0] == 320);
-    assert(result1->array[1][1] == 335);
+    assert(nlab_array_get(result1, 0, 0) == 140);
+    assert(nlab_array_get(result1, 0, 1) == 146);
+    assert(nlab_array_get(result1, 1, 0) == 320);
+    assert(nlab_array_get(result1, 1, 1) == 335);
     nlab_array_free(matrix1);
     nlab_array_free(matrix2);
     program_builder_free(p1);
@@ -2461,17 +3430,17 @@ void test_extension_b_dotproduct(void){
     // test #2 - another valid dot-product that result
     // in a 1x1 array
     nlab_array* matrix3 = nlab_array_create_ones(1,5);
-    matrix3->array[0][0] = 5;
-    matrix3->array[0][1] = 4;
-    matrix3->array[0][2] = 3;
-    matrix3->array[0][3] = 2;
-    matrix3->array[0][4] = 1;
+    nlab_array_set(matrix3, 0, 0, 5);
+    nlab_array_set(matrix3, 0, 1, 4);
+    nlab_array_set(matrix3, 0, 2, 3);
+    nlab_array_set(matrix3, 0, 3, 2);
+    nlab_array_set(matrix3, 0, 4, 1);
     nlab_array* matrix4 = nlab_array_create_ones(5,1);
-    matrix4->array[0][0] = 5;
-    matrix4->array[1][0] = 4;
-    matrix4->array[2][0] = 3;
-    matrix4->array[3][0] = 2;
-    matrix4->array[4][0] = 1;
+    nlab_array_set(matrix4, 0, 0, 5);
+    nlab_array_set(matrix4, 1, 0, 4);
+    nlab_array_set(matrix4, 2, 0, 3);
+    nlab_array_set(matrix4, 3, 0, 2);
+    nlab_array_set(matrix4, 4, 0, 1);
     Program* p2 = program_builder_init();
     stack_push(p2->polish_stack, matrix3);
     stack_push(p2->polish_stack, matrix4);
@@ -2481,34 +3450,34 @@ void test_extension_b_dotproduct(void){
     assert(p2->polish_stack->size == 1);
     assert(result2->rows == 1);
     assert(result2->cols == 1);
-    assert(result2->array[0][0] == 55);
+    assert(nlab_array_get(result2, 0, 0) == 55);
     nlab_array_free(matrix3);
     nlab_array_free(matrix4);
     program_builder_free(p2);
 
     // test #3 - an exam where the dims aren't symmetrical
     nlab_array* matrix5 = nlab_array_create_ones(2,4);
-    matrix5->array[0][0] = 3;
-    matrix5->array[0][1] = 2;
-    matrix5->array[0][2] = 1;
-    matrix5->array[0][3] = 5;
-    matrix5->array[1][0] = 9;
-    matrix5->array[1][1] = 1;
-    matrix5->array[1][2] = 3;
-    matrix5->array[1][3] = 0;
+    nlab_array_set(matrix5, 0, 0, 3);
+    nlab_array_set(matrix5, 0, 1, 2);
+    nlab_array_set(matrix5, 0, 2, 1);
+    nlab_array_set(matrix5, 0, 3, 5);
+    nlab_array_set(matrix5, 1, 0, 9);
+    nlab_array_set(matrix5, 1, 1, 1);
+    nlab_array_set(matrix5, 1, 2, 3);
+    nlab_array_set(matrix5, 1, 3, 0);
     nlab_array* matrix6 = nlab_array_create_ones(4,3);
-    matrix6->array[0][0] = 2;
-    matrix6->array[0][1] = 9;
-    matrix6->array[0][2] = 0;
-    matrix6->array[1][0] = 1;
-    matrix6->array[1][1] = 3;
-    matrix6->array[1][2] = 5;
-    matrix6->array[2][0] = 2;
-    matrix6->array[2][1] = 4;
-    matrix6->array[2][2] = 7;
-    matrix6->array[3][0] = 8;
-    matrix6->array[3][1] = 1;
-    matrix6->array[3][2] = 5;
+    nlab_array_set(matrix6, 0, 0, 2);
+    nlab_array_set(matrix6, 0, 1, 9);
+    nlab_array_set(matrix6, 0, 2, 0);
+    nlab_array_set(matrix6, 1, 0, 1);
+    nlab_array_set(matrix6, 1, 1, 3);
+    nlab_array_set(matrix6, 1, 2, 5);
+    nlab_array_set(matrix6, 2, 0, 2);
+    nlab_array_set(matrix6, 2, 1, 4);
+    nlab_array_set(matrix6, 2, 2, 7);
+    nlab_array_set(matrix6, 3, 0, 8);
+    nlab_array_set(matrix6, 3, 1, 1);
+    nlab_array_set(matrix6, 3, 2, 5);
     Program* p3 = program_builder_init();
     stack_push(p3->polish_stack, matrix5);
     stack_push(p3->polish_stack, matrix6);
@@ -2518,12 +3487,12 @@ void test_extension_b_dotproduct(void){
     assert(p3->polish_stack->size == 1);
     assert(result3->rows == 2);
     assert(result3->cols == 3);
-    assert(result3->array[0][0] == 50);
-    assert(result3->array[0][1] == 42);
-    assert(result3->array[0][2] == 42);
-    assert(result3->array[1][0] == 25);
-    assert(result3->array[1][1] == 96);
-    assert(result3->array[1][2] == 26);
+    assert(nlab_array_get(result3, 0, 0) == 50);
+    assert(nlab_array_get(result3, 0, 1) == 42);
+    assert(nlab_array_get(result3, 0, 2) == 42);
+    assert(nlab_array_get(result3, 1, 0) == 25);
+    assert(nlab_array_get(result3, 1, 1) == 96);
+    assert(nlab_array_get(result3, 1, 2) == 26);
     nlab_array_free(matrix5);
     nlab_array_free(matrix6);
     program_builder_free(p3);
@@ -2535,8 +3504,8 @@ void test_extension_b_dotproduct(void){
 
     // test #5 - only one item on stack
     nlab_array* matrix7 = nlab_array_create_ones(1,2);
-    matrix7->array[0][0] = 3;
-    matrix7->array[0][1] = 2;
+    nlab_array_set(matrix7, 0, 0, 3);
+    nlab_array_set(matrix7, 0, 1, 2);
     Program* p5 = program_builder_init();
     stack_push(p5->polish_stack, matrix7);
     assert(!extension_b_dotproduct(p5));
@@ -2549,20 +3518,20 @@ void test_extension_b_power(void){
     // test #1 - [1,2][3,4]^2 = [7,10][15,22]
     Program* p1 = program_builder_init();
     nlab_array* matrix1 = nlab_array_create_ones(2,2);
-    matrix1->array[0][0] = 1;
-    matrix1->array[0][1] = 2;
-    matrix1->array[1][0] = 3;
-    matrix1->array[1][1] = 4;
+    nlab_array_set(matrix1, 0, 0, 1);
+    nlab_array_set(matrix1, 0, 1, 2);
+    nlab_array_set(matrix1, 1, 0, 3);
+    nlab_array_set(matrix1, 1, 1, 4);
     nlab_array* power2 = nlab_array_create_1d(2);
     stack_push(p1->polish_stack, matrix1);
     stack_push(p1->polish_stack, power2);
     assert(extension_b_power(p1));
     nlab_array* result1 = stack_peek(p1->polish_stack);
     assert(result1);
-    assert(result1->array[0][0] == 7);
-    assert(result1->array[0][1] == 10);
-    assert(result1->array[1][0] == 15);
-    assert(result1->array[1][1] == 22);
+    assert(nlab_array_get(result1, 0, 0) == 7);
+    assert(nlab_array_get(result1, 0, 1) == 10);
+    assert(nlab_array_get(result1, 1, 0) == 15);
+    assert(nlab_array_get(result1, 1, 1) == 22);
     nlab_array_free(matrix1);
     nlab_array_free(power2);
     program_builder_free(p1);
@@ -2570,20 +3539,20 @@ void test_extension_b_power(void){
     // test #2 - [1,2][3,4]^3 = [37,54,81,118]
     Program* p2 = program_builder_init();
     nlab_array* matrix2 = nlab_array_create_ones(2,2);
-    matrix2->array[0][0] = 1;
-    matrix2->array[0][1] = 2;
-    matrix2->array[1][0] = 3;
-    matrix2->array[1][1] = 4;
+    nlab_array_set(matrix2, 0, 0, 1);
+    nlab_array_set(matrix2, 0, 1, 2);
+    nlab_array_set(matrix2, 1, 0, 3);
+    nlab_array_set(matrix2, 1, 1, 4);
     nlab_array* power3 = nlab_array_create_1d(3);
     stack_push(p2->polish_stack, matrix2);
     stack_push(p2->polish_stack, power3);
     assert(extension_b_power(p2));
     nlab_array* result2 = stack_peek(p2->polish_stack);
     assert(result2);
-    assert(result2->array[0][0] == 37);
-    assert(result2->array[0][1] == 54);
-    assert(result2->array[1][0] == 81);
-    assert(result2->array[1][1] == 118);
+    assert(nlab_array_get(result2, 0, 0) == 37);
+    assert(nlab_array_get(result2, 0, 1) == 54);
+    assert(nlab_array_get(result2, 1, 0) == 81);
+    assert(nlab_array_get(result2, 1, 1) == 118);
     nlab_array_free(matrix2);
     nlab_array_free(power3);
     program_builder_free(p2);
@@ -2591,10 +3560,10 @@ void test_extension_b_power(void){
     // test #3 - a non sqr matrix cannot be powered
     Program* p3 = program_builder_init();
     nlab_array* matrix3 = nlab_array_create_ones(2,3);
-    matrix3->array[0][0] = 1;
-    matrix3->array[0][1] = 2;
-    matrix3->array[1][0] = 3;
-    matrix3->array[1][1] = 4;
+    nlab_array_set(matrix3, 0, 0, 1);
+    nlab_array_set(matrix3, 0, 1, 2);
+    nlab_array_set(matrix3, 1, 0, 3);
+    nlab_array_set(matrix3, 1, 1, 4);
     nlab_array* power4 = nlab_array_create_1d(4);
     stack_push(p3->polish_stack, matrix3);
     stack_push(p3->polish_stack, power4);
@@ -2606,20 +3575,20 @@ void test_extension_b_power(void){
     // test #4 - M^1 should return the same 
     Program* p4 = program_builder_init();
     nlab_array* matrix4 = nlab_array_create_ones(2,2);
-    matrix4->array[0][0] = 1;
-    matrix4->array[0][1] = 2;
-    matrix4->array[1][0] = 3;
-    matrix4->array[1][1] = 4;
+    nlab_array_set(matrix4, 0, 0, 1);
+    nlab_array_set(matrix4, 0, 1, 2);
+    nlab_array_set(matrix4, 1, 0, 3);
+    nlab_array_set(matrix4, 1, 1, 4);
     nlab_array* power1 = nlab_array_create_1d(1);
     stack_push(p4->polish_stack, matrix4);
     stack_push(p4->polish_stack, power1);
     assert(extension_b_power(p4));
     nlab_array* result4 = stack_peek(p4->polish_stack);
     assert(result4);
-    assert(result4->array[0][0] == 1);
-    assert(result4->array[0][1] == 2);
-    assert(result4->array[1][0] == 3);
-    assert(result4->array[1][1] == 4);
+    assert(nlab_array_get(result4, 0, 0) == 1);
+    assert(nlab_array_get(result4, 0, 1) == 2);
+    assert(nlab_array_get(result4, 1, 0) == 3);
+    assert(nlab_array_get(result4, 1, 1) == 4);
     nlab_array_free(matrix4);
     nlab_array_free(power1);
     program_builder_free(p4);
@@ -2627,10 +3596,10 @@ void test_extension_b_power(void){
     // test #5 -  M and n in wrong order
     Program* p5 = program_builder_init();
     nlab_array* matrix5 = nlab_array_create_ones(2,2);
-    matrix5->array[0][0] = 1;
-    matrix5->array[0][1] = 2;
-    matrix5->array[1][0] = 3;
-    matrix5->array[1][1] = 4;
+    nlab_array_set(matrix5, 0, 0, 1);
+    nlab_array_set(matrix5, 0, 1, 2);
+    nlab_array_set(matrix5, 1, 0, 3);
+    nlab_array_set(matrix5, 1, 1, 4);
     nlab_array* n = nlab_array_create_1d(1);
     stack_push(p5->polish_stack, n);
     stack_push(p5->polish_stack, matrix5);
@@ -2639,7 +3608,202 @@ void test_extension_b_power(void){
     nlab_array_free(n);
     program_builder_free(p5);
 
+    // test #6 - powers above 10 are fine, and wrap like B-DOTPRODUCT: [1,1][1,0]^60 holds F(60)
+    Program* p6 = program_builder_init();
+    nlab_array* fib6 = nlab_array_create_ones(2,2);
+    nlab_array_set(fib6, 1, 1, 0);
+    nlab_array* power60 = nlab_array_create_1d(60);
+    stack_push(p6->polish_stack, fib6);
+    stack_push(p6->polish_stack, power60);
+    assert(extension_b_power(p6));
+    assert(p6->polish_stack->size == 1);
+    nlab_array* result6 = stack_peek(p6->polish_stack);
+    // F(60) = 1548008755920, whose low 32 bits are 1820529360
+    assert(nlab_array_get(result6, 0, 1) == 1820529360);
+    nlab_array_free(fib6);
+    nlab_array_free(power60);
+    program_builder_free(p6);
+
+    // test #7 - M^0 is the identity
+    Program* p7 = program_builder_init();
+    nlab_array* matrix7 = nlab_array_create_ones(3,3);
+    nlab_array* power0 = nlab_array_create_1d(0);
+    stack_push(p7->polish_stack, matrix7);
+    stack_push(p7->polish_stack, power0);
+    assert(extension_b_power(p7));
+    nlab_array* result7 = stack_peek(p7->polish_stack);
+    for(unsigned int y = 0; y < 3; y++){
+        for(unsigned int x = 0; x < 3; x++){
+            assert(nlab_array_get(result7, y, x) == (y == x));
+        }
+    }
+    nlab_array_free(matrix7);
+    nlab_array_free(power0);
+    program_builder_free(p7);
+
+    // test #8 - modular powers: F(90) mod 1000000007, and J^999999 = 3^999998 J for the 3x3 J of ones
+    nlab_array* fib8 = nlab_array_create_ones(2,2);
+    nlab_array_set(fib8, 1, 1, 0);
+    nlab_array* result8 = _matrix_power(fib8, 90, 1000000007);
+    assert(nlab_array_get(result8, 0, 1) == 210345902);
+    nlab_array* ones8 = nlab_array_create_ones(3,3);
+    nlab_array* result8b = _matrix_power(ones8, 999999, 1000000007);
+    for(unsigned int y = 0; y < 3; y++){
+        for(unsigned int x = 0; x < 3; x++){
+            assert(nlab_array_get(result8b, y, x) == 7215046);
+        }
+    }
+    nlab_array_free(fib8);
+    nlab_array_free(result8);
+    nlab_array_free(ones8);
+    nlab_array_free(result8b);
+
+
+}
+
+void test_extension_until_stable(void){
+
+    // test #1 - the LOOP stops at the first pass that leaves $A as it found it: $A goes 1..5, then 5 again
+    char* tokens1[] = {"BEGIN", "{", "SET", "$N", ":=", "0", ";", "SET", "$A", ":=", "1", ";",
+                       "LOOP", "$I", "100", "UNTIL-STABLE", "$A", "{",
+                       "SET", "$A", ":=", "$A", "$A", "5", "B-LESS", "B-ADD", ";", "SET", "$N", ":=", "$N", "1", "B-ADD", ";",
+                       "}", "}"};
+    Program* p1 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens1) / sizeof(tokens1[0]); i++){
+        program_builder_add(p1, tokens1[i]);
+    }
+    assert(program(p1));
+    assert(_count_ops(p1, op_until_stable) == 1);
+    assert(bytecode_at(p1->bytecode, p1->bytecode->size - 2)->op == op_until_stable);
+    assert(bytecode_at(p1->bytecode, p1->bytecode->size - 2)->operand == 1 << map_get_keycode("$A"));
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$A"), 0, 0) == 5);
+    assert(nlab_array_get(map_get_key_value(p1->variable_map, "$N"), 0, 0) == 5);
+    assert(map_get_key_value(p1->variable_map, "$I") == NULL);
+    // the copies it compared with are let go once the LOOP is done
+    assert(bytecode_at(p1->bytecode, p1->bytecode->size - 2)->copies == NULL);
+    program_builder_free(p1);
+
+    // test #2 - a SET only the check reads isn't dropped as dead: $B is 0, 1, 1
+    char* tokens2[] = {"BEGIN", "{", "SET", "$N", ":=", "0", ";", "SET", "$A", ":=", "1", ";",
+                       "LOOP", "$I", "100", "UNTIL-STABLE", "$B", "{",
+                       "SET", "$A", ":=", "$A", "1", "B-ADD", ";", "SET", "$B", ":=", "$A", "2", "B-GREATER", ";",
+                       "SET", "$N", ":=", "$N", "1", "B-ADD", ";", "}", "}"};
+    Program* p2 = program_builder_init();
+    p2->remove_dead_stores = true;
+    for(unsigned int i = 0; i < sizeof(tokens2) / sizeof(tokens2[0]); i++){
+        program_builder_add(p2, tokens2[i]);
+    }
+    assert(program(p2));
+    assert(_count_ops(p2, op_set_end) == 5);
+    assert(nlab_array_get(map_get_key_value(p2->variable_map, "$N"), 0, 0) == 3);
+    program_builder_free(p2);
+
+    // test #3 - with several variables, it waits for all of them: $A settles on pass 5, $B on pass 8
+    char* tokens3[] = {"BEGIN", "{", "SET", "$N", ":=", "0", ";", "SET", "$A", ":=", "1", ";", "SET", "$B", ":=", "1", ";",
+                       "LOOP", "$I", "100", "UNTIL-STABLE", "$A", "$B", "{",
+                       "SET", "$A", ":=", "$A", "$A", "5", "B-LESS", "B-ADD", ";", "SET", "$B", ":=", "$B", "$B", "8", "B-LESS", "B-ADD", ";",
+                       "SET", "$N", ":=", "$N", "1", "B-ADD", ";", "}", "}"};
+    Program* p3 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens3) / sizeof(tokens3[0]); i++){
+        program_builder_add(p3, tokens3[i]);
+    }
+    assert(program(p3));
+    assert(nlab_array_get(map_get_key_value(p3->variable_map, "$N"), 0, 0) == 8);
+    program_builder_free(p3);
+
+    // test #4 - a Life block stops on the second pass, and a blinker, which never repeats
+    // from one pass to the next, runs to the limit
+    char* tokens4[] = {"BEGIN", "{", "SET", "$N", ":=", "0", ";", "LOOP", "$I", "9", "UNTIL-STABLE", "$A", "{",
+                       "SET", "$A", ":=", "$A", "U-LIFESTEP", ";", "SET", "$N", ":=", "$N", "1", "B-ADD", ";", "}", "}"};
+    nlab_array* block = nlab_array_create_zeros(6, 70);
+    nlab_array* blinker = nlab_array_create_zeros(6, 70);
+    for(unsigned int i = 0; i < 4; i++){
+        nlab_array_set(block, 2 + i / 2, 63 + i % 2, 1);
+    }
+    for(unsigned int x = 62; x < 65; x++){
+        nlab_array_set(blinker, 2, x, 1);
+    }
+    Program* p4 = program_builder_init();
+    map_add_by_code(p4->variable_map, map_get_keycode("$A"), block);
+    for(unsigned int i = 0; i < sizeof(tokens4) / sizeof(tokens4[0]); i++){
+        program_builder_add(p4, tokens4[i]);
+    }
+    assert(program(p4));
+    assert(nlab_array_get(map_get_key_value(p4->variable_map, "$N"), 0, 0) == 2);
+    assert(nlab_array_get(map_get_key_value(p4->variable_map, "$A"), 3, 64) == 1);
+    program_builder_free(p4);
+    Program* p4b = program_builder_init();
+    map_add_by_code(p4b->variable_map, map_get_keycode("$A"), blinker);
+    for(unsigned int i = 0; i < sizeof(tokens4) / sizeof(tokens4[0]); i++){
+        program_builder_add(p4b, tokens4[i]);
+    }
+    assert(program(p4b));
+    assert(nlab_array_get(map_get_key_value(p4b->variable_map, "$N"), 0, 0) == 9);
+    // an odd number of generations leaves it upright
+    assert(nlab_array_get(map_get_key_value(p4b->variable_map, "$A"), 1, 63) == 1);
+    assert(nlab_array_get(map_get_key_value(p4b->variable_map, "$A"), 2, 62) == 0);
+    program_builder_free(p4b);
+    nlab_array_free(block);
+    nlab_array_free(blinker);
+
+    // test #5 - each time the LOOP is entered it starts over, rather than comparing with the last time:
+    // from 4, $A is 5 after the first pass, which is also where it was left
+    char* tokens5[] = {"BEGIN", "{", "SET", "$N", ":=", "0", ";", "LOOP", "$J", "3", "{", "SET", "$A", ":=", "4", ";",
+                       "LOOP", "$I", "100", "UNTIL-STABLE", "$A", "{",
+                       "SET", "$A", ":=", "$A", "$A", "5", "B-LESS", "B-ADD", ";", "SET", "$N", ":=", "$N", "1", "B-ADD", ";",
+                       "}", "}", "}"};
+    Program* p5 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens5) / sizeof(tokens5[0]); i++){
+        program_builder_add(p5, tokens5[i]);
+    }
+    assert(program(p5));
+    assert(nlab_array_get(map_get_key_value(p5->variable_map, "$N"), 0, 0) == 6);
+    program_builder_free(p5);
+
+    // test #6 - UNTIL-STABLE needs at least one variable
+    char* tokens6[] = {"BEGIN", "{", "LOOP", "$I", "5", "UNTIL-STABLE", "{", "}", "}"};
+    Program* p6 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens6) / sizeof(tokens6[0]); i++){
+        program_builder_add(p6, tokens6[i]);
+    }
+    assert(!program(p6));
+    assert(p6->error_state == error_parse);
+    program_builder_free(p6);
+    // test #7 - a release put in front of the LOOP leaves the check naming its op_loop_begin, so it still stops
+    char* tokens7[] = {"BEGIN", "{", "ONES", "2", "3", "$D", "SET", "$A", ":=", "$D", "2", "B-TIMES", ";",
+                       "LOOP", "$I", "50", "UNTIL-STABLE", "$A", "{", "SET", "$A", ":=", "$A", "1", "B-GREATER", ";", "}", "}"};
+    Program* p7 = program_builder_init();
+    p7->release_dead_variables = true;
+    for(unsigned int i = 0; i < sizeof(tokens7) / sizeof(tokens7[0]); i++){
+        program_builder_add(p7, tokens7[i]);
+    }
+    assert(program(p7));
+    assert(_count_ops(p7, op_release) > 0);
+    for(int i = 0; i < p7->bytecode->size; i++){
+        instruction* check = bytecode_at(p7->bytecode, i);
+        if(check->op == op_until_stable){
+            assert(bytecode_at(p7->bytecode, check->loop)->op == op_loop_begin);
+            assert(check->operand2 == 1);
+        }
+    }
+    program_builder_free(p7);
 
+    // test #8 - a board written over with the same values every pass is still stable: $A is
+    // rewritten as is every pass, and $B only changes on pass 2, so pass 3 is the first stable one
+    char* tokens8[] = {"BEGIN", "{", "SET", "$N", ":=", "0", ";", "ONES", "3", "70", "$A", "ONES", "3", "70", "$B",
+                       "LOOP", "$I", "100", "UNTIL-STABLE", "$A", "$B", "{",
+                       "SET", "$A", ":=", "$A", "1", "B-TIMES", ";",
+                       "SET", "$B", ":=", "$B", "$I", "2", "B-EQUALS", "B-ADD", ";",
+                       "SET", "$N", ":=", "$N", "1", "B-ADD", ";", "}", "}"};
+    Program* p8 = program_builder_init();
+    for(unsigned int i = 0; i < sizeof(tokens8) / sizeof(tokens8[0]); i++){
+        program_builder_add(p8, tokens8[i]);
+    }
+    assert(program(p8));
+    assert(nlab_array_get(map_get_key_value(p8->variable_map, "$N"), 0, 0) == 3);
+    assert(nlab_array_get(map_get_key_value(p8->variable_map, "$A"), 2, 69) == 1);
+    assert(nlab_array_get(map_get_key_value(p8->variable_map, "$B"), 2, 69) == 2);
+    program_builder_free(p8);
 }
 
 #endif
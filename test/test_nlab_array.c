@@ -4,11 +4,11 @@ void test_nlab_array(void){
 
     // test #1 - happy test
     nlab_array* arr1 = nlab_array_create_1d(3);
-    assert(arr1->array[0][0] == 3);
+    assert(nlab_array_get(arr1, 0, 0) == 3);
 
     // test #2 -zero is also a valid variable
     nlab_array* arr2 = nlab_array_create_1d(0);
-    assert(arr2->array[0][0] == 0);
+    assert(nlab_array_get(arr2, 0, 0) == 0);
 
     // test #3 - valid array of ones for CREATE instruction
     nlab_array* arr3 = nlab_array_create_ones(3, 4);
@@ -16,7 +16,7 @@ void test_nlab_array(void){
     assert(arr3->cols = 4);
     for(unsigned int y = 0; y < arr3->rows; y++){
         for(unsigned int x = 0; x < arr3->cols; x++){
-            assert(arr3->array[y][x] == 1);
+            assert(nlab_array_get(arr3, y, x) == 1);
         }
     }
 
@@ -28,7 +28,7 @@ void test_nlab_array(void){
     nlab_array* arr5 = nlab_array_copy(arr1);
     assert(arr5->rows == arr1->rows);
     assert(arr5->cols == arr1->cols);
-    assert(arr5->array[0][0] == arr1->array[0][0]);
+    assert(nlab_array_get(arr5, 0, 0) == nlab_array_get(arr1, 0, 0));
 
     // test #6 - copy a ONES array (multi-dim array)
     nlab_array* arr6 = nlab_array_copy(arr3);
@@ -36,7 +36,7 @@ void test_nlab_array(void){
     assert(arr6->cols == arr3->cols);
     for(unsigned int y = 0; y < arr6->rows; y++){
         for(unsigned int x = 0; x < arr6->cols; x++){
-            assert(arr6->array[y][x] == arr3->array[y][x]);
+            assert(nlab_array_get(arr6, y, x) == nlab_array_get(arr3, y, x));
         }
     }
 
@@ -44,8 +44,201 @@ void test_nlab_array(void){
     nlab_array* arr7 = nlab_array_copy(NULL);
     assert(arr7 == NULL);
 
+    // test #8 - one contiguous, aligned buffer with each row starting on a cache line
+    nlab_array* arr8 = nlab_array_create_ones(3, 20);
+    assert(arr8->stride >= arr8->cols);
+    assert(arr8->stride % NLAB_INTS_PER_LINE == 0);
+    assert((uintptr_t) arr8->data % NLAB_ALIGNMENT == 0);
+    nlab_array_set(arr8, 2, 19, 7);
+    assert(arr8->data[2 * arr8->stride + 19] == 7);
+    assert(&NLAB_ROW(arr8, 1)[0] == arr8->data + arr8->stride);
+
+    // test #9 - copies share the buffer until one of them is written to
+    nlab_array* arr9 = nlab_array_copy(arr8);
+    assert(arr9->data == arr8->data);
+    assert(arr8->block->refcount == 2);
+    assert(nlab_array_is_shared(arr9));
+    nlab_array_set(arr9, 0, 0, 5);
+    assert(arr9->data != arr8->data);
+    assert(!nlab_array_is_shared(arr8));
+    assert(nlab_array_get(arr9, 0, 0) == 5);
+    assert(nlab_array_get(arr8, 0, 0) == 1);
+    assert(nlab_array_get(arr9, 2, 19) == 7);
+
+    // test #10 - a clone never shares
+    nlab_array* arr10 = nlab_array_clone(arr8);
+    assert(arr10->data != arr8->data);
+    assert(!nlab_array_is_shared(arr10));
+    assert(nlab_array_get(arr10, 2, 19) == 7);
+
+    // test #11 - a transposed view shares the buffer, and reads the same elements
+    nlab_array* arr11 = nlab_array_create_zeros(70, 45);
+    for(unsigned int y = 0; y < 70; y++){
+        for(unsigned int x = 0; x < 45; x++){
+            nlab_array_set(arr11, y, x, (int) (y * 100 + x));
+        }
+    }
+    nlab_array* view11 = nlab_array_transpose_view(arr11);
+    assert(nlab_array_is_view(view11));
+    assert(view11->data == arr11->data);
+    assert(view11->rows == 45 && view11->cols == 70);
+    assert(nlab_array_get(view11, 44, 69) == 6944);
+    assert(nlab_array_get(view11, 3, 2) == 203);
+    // transposing again gives the original walk back
+    nlab_array* view11b = nlab_array_transpose_view(view11);
+    assert(view11b->stride == arr11->stride && view11b->col_stride == 1);
+    assert(nlab_array_get(view11b, 2, 3) == 203);
+
+    // test #12 - submatrix views skip a row and a column, and compose with transposes
+    nlab_array* view12 = nlab_array_submatrix_view(view11, 1, 2);
+    assert(view12->rows == 44 && view12->cols == 69);
+    assert(view12->data == arr11->data);
+    for(unsigned int y = 0; y < view12->rows; y++){
+        for(unsigned int x = 0; x < view12->cols; x++){
+            unsigned int src_y = x + (x >= 2), src_x = y + (y >= 1);
+            assert(nlab_array_get(view12, y, x) == (int) (src_y * 100 + src_x));
+        }
+    }
+    assert(nlab_array_submatrix_view(view12, 44, 0) == NULL);
+    assert(nlab_array_submatrix_view(arr1, 0, 0) == NULL);
+    // a second skip in the same view isn't possible, so it's laid out first
+    nlab_array* view12b = nlab_array_submatrix_view(view12, 0, 0);
+    assert(view12b->data != arr11->data);
+    assert(nlab_array_get(view12b, 0, 0) == nlab_array_get(view12, 1, 1));
+
+    // test #13 - materialising (or writing) lays a view out, and leaves its source alone
+    nlab_array* arr13 = nlab_array_copy(view12);
+    nlab_array_materialize(arr13);
+    assert(!nlab_array_is_view(arr13));
+    assert(arr13->data != arr11->data);
+    assert(arr13->stride % NLAB_INTS_PER_LINE == 0);
+    for(unsigned int y = 0; y < arr13->rows; y++){
+        for(unsigned int x = 0; x < arr13->cols; x++){
+            assert(NLAB_ROW(arr13, y)[x] == nlab_array_get(view12, y, x));
+        }
+    }
+    nlab_array_set(view11, 0, 0, -1);
+    assert(!nlab_array_is_view(view11));
+    assert(nlab_array_get(view11, 0, 0) == -1);
+    assert(nlab_array_get(arr11, 0, 0) == 0);
+    assert(nlab_array_get(view11, 44, 69) == 6944);
+
+    // test #14 - a freed heap buffer is handed back, unzeroed, for the next array of its shape
+    nlab_array_pool_drain();
+    nlab_array* arr14 = nlab_array_create_uninit(5, 7);
+    int* data14 = arr14->data;
+    data14[3] = 42;
+    nlab_array_free(arr14);
+    nlab_alloc_counts before14 = nlab_array_alloc_counts();
+    nlab_array* arr14b = nlab_array_create_uninit(5, 7);
+    assert(arr14b->data == data14 && arr14b->data[3] == 42);
+    assert(nlab_array_alloc_counts().pool_hits == before14.pool_hits + 1);
+    assert(nlab_array_alloc_counts().heap == before14.heap);
+    // other shapes (or kinds) are misses
+    nlab_array* arr14c = nlab_array_create_uninit(7, 5);
+    nlab_array* arr14d = nlab_array_create_bool(5, 7);
+    assert(nlab_array_alloc_counts().pool_misses == before14.pool_misses + 2);
+    // buffers only go back once the last sharer lets go
+    nlab_array* copy14 = nlab_array_copy(arr14b);
+    nlab_array_free(arr14b);
+    nlab_array* arr14e = nlab_array_create_ones(5, 7);
+    assert(arr14e->data != data14);
+    assert(nlab_array_get(copy14, 0, 0) == copy14->data[0]);
+    nlab_array_free(copy14);
+    nlab_array_free(arr14c);
+    nlab_array_free(arr14d);
+    nlab_array_free(arr14e);
+    // more sizes than classes - older ones give way
+    for(unsigned int size = 1; size <= NLAB_POOL_CLASSES + 4; size++){
+        nlab_array_free(nlab_array_create_zeros(size, 100));
+    }
+    nlab_array_pool_drain();
+
+    // test #15 - 1x1 arrays are held inline, with no buffer, however they're made
+    nlab_alloc_counts before15 = nlab_array_alloc_counts();
+    nlab_array* arr15 = nlab_array_create_1d(9);
+    nlab_array* ones15 = nlab_array_create_ones(1, 1);
+    assert(arr15->block == NULL && arr15->data == &arr15->scalar);
+    assert(nlab_array_get(ones15, 0, 0) == 1);
+    nlab_array* copy15 = nlab_array_copy(arr15);
+    assert(copy15->data == &copy15->scalar);
+    nlab_array_set(copy15, 0, 0, 4);
+    assert(nlab_array_get(arr15, 0, 0) == 9);
+    // assigning into a scalar just overwrites it
+    assert(nlab_array_assign(arr15, copy15));
+    assert(nlab_array_get(arr15, 0, 0) == 4);
+    // only the three handles were allocated - no buffer was looked for
+    assert(nlab_array_alloc_counts().heap - before15.heap <= 3);
+    assert(nlab_array_alloc_counts().pool_hits == before15.pool_hits);
+    assert(nlab_array_alloc_counts().pool_misses == before15.pool_misses);
+    // the bit-packed results of comparisons aren't inlined
+    nlab_array* bool15 = nlab_array_create_bool(1, 1);
+    assert(!bool15->is_inline && bool15->block != NULL);
+    nlab_array_free(arr15);
+    nlab_array_free(ones15);
+    nlab_array_free(copy15);
+    nlab_array_free(bool15);
+
+    // test #16 - heap buffers' bytes are counted while in use, and the most there have been kept
+    nlab_alloc_counts before16 = nlab_array_alloc_counts();
+    nlab_array* arr16 = nlab_array_create_zeros(40, 40);
+    nlab_alloc_counts during16 = nlab_array_alloc_counts();
+    assert(during16.live_bytes >= before16.live_bytes + 40 * 40 * sizeof(int));
+    assert(during16.peak_live_bytes >= during16.live_bytes && during16.peak_held_bytes >= during16.held_bytes);
+    nlab_array_free(arr16);
+    // back in the pool - no longer in use, but still held
+    assert(nlab_array_alloc_counts().live_bytes == before16.live_bytes);
+    assert(nlab_array_alloc_counts().held_bytes == during16.held_bytes);
+    assert(nlab_array_alloc_counts().peak_live_bytes == during16.peak_live_bytes);
+
+    // test #17 - equal arrays are equal whether laid out, viewed or packed
+    nlab_array* arr17 = nlab_array_create_zeros(3, 70);
+    for(unsigned int i = 0; i < 3 * 70; i++){
+        nlab_array_set(arr17, i / 70, i % 70, (int) i);
+    }
+    nlab_array* copy17 = nlab_array_clone(arr17);
+    assert(nlab_array_equal(copy17, arr17));
+    nlab_array_set(copy17, 2, 69, 0);
+    assert(!nlab_array_equal(copy17, arr17));
+    nlab_array_set(copy17, 2, 69, 2 * 70 + 69);
+    assert(nlab_array_equal(copy17, arr17));
+    nlab_array* view17 = nlab_array_transpose_view(arr17);
+    nlab_array* view17b = nlab_array_transpose_view(view17);
+    assert(nlab_array_equal(view17b, arr17) && !nlab_array_equal(view17, arr17));
+    nlab_array* bool17 = nlab_array_create_bool(3, 70);
+    nlab_array* bool17b = nlab_array_create_bool(3, 70);
+    assert(nlab_array_equal(bool17, bool17b));
+    nlab_array_set(bool17b, 1, 65, 1);
+    assert(!nlab_array_equal(bool17, bool17b));
+    // the same values, packed or not
+    nlab_array* int17 = nlab_array_to_int(bool17b);
+    assert(nlab_array_equal(int17, bool17b) && !nlab_array_equal(int17, bool17));
+    // a shared buffer is equal until one side is written, which gives it its own
+    nlab_array* shared17 = nlab_array_copy(arr17);
+    assert(nlab_array_equal(shared17, arr17));
+    nlab_array_set(shared17, 0, 0, 1);
+    assert(!nlab_array_equal(shared17, arr17) && nlab_array_get(arr17, 0, 0) == 0);
+    assert(nlab_array_equal(NULL, NULL) && !nlab_array_equal(arr17, NULL));
+    nlab_array_free(arr17);
+    nlab_array_free(copy17);
+    nlab_array_free(view17);
+    nlab_array_free(view17b);
+    nlab_array_free(bool17);
+    nlab_array_free(bool17b);
+    nlab_array_free(int17);
+    nlab_array_free(shared17);
+
+    nlab_array_free(arr11);
+    nlab_array_free(view11);
+    nlab_array_free(view11b);
+    nlab_array_free(view12);
+    nlab_array_free(view12b);
+    nlab_array_free(arr13);
     nlab_array_free(arr1);
     nlab_array_free(arr2);
+    nlab_array_free(arr8);
+    nlab_array_free(arr9);
+    nlab_array_free(arr10);
     nlab_array_free(arr3);
     nlab_array_free(arr5);
     nlab_array_free(arr6);
@@ -0,0 +1,172 @@
+#include "../src/nlabc/specific.h"
+
+void test_nlabc(void){
+
+    #ifdef INTERP
+    // test #1 - with compile_only set, a program is compiled but nothing runs
+    char* tokens[] = {"BEGIN", "{", "PRINT", "\"x?=\"", "ONES", "2", "3", "$A",
+                      "LOOP", "$I", "4", "{", "SET", "$A", ":=", "$A", "$I", "B-ADD", ";", "}", "}"};
+    Program* p1 = program_builder_init();
+    p1->compile_only = true;
+    for(unsigned int i = 0; i < sizeof(tokens) / sizeof(tokens[0]); i++){
+        program_builder_add(p1, tokens[i]);
+    }
+    assert(program(p1));
+    assert(p1->bytecode->size > 0);
+    assert(map_get_key_value(p1->variable_map, "$A") == NULL);
+
+    // test #2 - the instructions loaded back run as the interpreter would have run them
+    instruction code[MAX_NUM_OF_TOKENS];
+    int literals[MAX_NUM_OF_TOKENS];
+    for(int i = 0; i < p1->bytecode->size; i++){
+        code[i] = *bytecode_at(p1->bytecode, i);
+        literals[i] = code[i].op == op_push_int ? nlab_array_get(code[i].constant, 0, 0) : 0;
+    }
+    Program* p2 = nlabc_load(p1->tokens, p1->num_of_tokens, code, literals, p1->bytecode->size);
+    assert(p2->bytecode->size == p1->bytecode->size);
+    assert(bytecode_at(p2->bytecode, 0)->constant == NULL);
+    assert(interp_execute(p2, 0));
+    assert(nlab_array_get(map_get_key_value(p2->variable_map, "$A"), 1, 2) == 11);
+    program_builder_free(p2);
+
+    // test #3 - the program written out jumps back for the LOOP, and prints the string as it stands
+    FILE* fp = tmpfile();
+    char line[MAX_STRING_LENGTH];
+    bool has_run = false, has_print = false, has_loop = false, has_scalar = false;
+    nlabc_emit(p1, true, "test.nlb", fp);
+    rewind(fp);
+    while(fgets(line, MAX_STRING_LENGTH, fp) != NULL){
+        has_run = has_run || strstr(line, "bool nlabc_run(Program* prog)") != NULL;
+        has_print = has_print || strstr(line, "printf(\"%s\\n\", \"x\\?=\");") != NULL;
+        has_loop = has_loop || strstr(line, "goto L") != NULL;
+        has_scalar = has_scalar || strstr(line, "nlabc_store_scalar(prog, ") != NULL;
+    }
+    fclose(fp);
+    assert(has_run && has_print && has_loop && has_scalar);
+    program_builder_free(p1);
+
+    // test #4 - a program that doesn't compile is written out as its error
+    Program* p4 = program_builder_init();
+    p4->compile_only = true;
+    program_builder_add(p4, "BEGIN");
+    program_builder_add(p4, "{");
+    program_builder_add(p4, "PRINT");
+    assert(!program(p4));
+    fp = tmpfile();
+    bool has_error = false;
+    has_run = false;
+    nlabc_emit(p4, false, "test.nlb", fp);
+    rewind(fp);
+    while(fgets(line, MAX_STRING_LENGTH, fp) != NULL){
+        has_run = has_run || strstr(line, "nlabc_run") != NULL;
+        has_error = has_error || strstr(line, "prog->error_state = error_parse;") != NULL;
+    }
+    fclose(fp);
+    assert(!has_run && has_error);
+    program_builder_free(p4);
+
+    // test #5 - a scalar SET reads only 1x1 variables, and writes over a 1x1 target or replaces it
+    Program* p5 = program_builder_init();
+    short a = map_get_keycode("$A");
+    nlab_array** slot = map_slot_by_code(p5->variable_map, a);
+    int value = 0;
+    assert(!nlabc_scalar(*slot, &value));
+    nlabc_store_scalar(p5, a, -7);
+    assert(nlabc_scalar(*slot, &value) && value == -7);
+    nlabc_store_scalar(p5, a, 9);
+    assert(nlab_array_get(map_get_key_value(p5->variable_map, "$A"), 0, 0) == 9);
+    nlab_array* ones = nlab_array_create_ones(2, 2);
+    map_add_by_code(p5->variable_map, a, ones);
+    nlab_array_free(ones);
+    assert(!nlabc_scalar(*slot, &value));
+    nlabc_store_scalar(p5, a, 3);
+    assert(nlabc_scalar(*slot, &value) && value == 3);
+    program_builder_free(p5);
+
+    // test #6 - a loop's rows are read as ints, and bool results packed back with no bits past the last column
+    nlab_array* bits = nlab_array_create_bool(2, 70);
+    nlab_array* ints = nlab_array_create_ones(2, 70);
+    int values[FUSED_BLOCK], buffer[FUSED_BLOCK];
+    for(int i = 0; i < 70; i++){
+        values[i] = i % 3 == 0;
+    }
+    nlabc_pack(bits, 1, 0, 70, values);
+    assert(nlabc_row(bits, 1, 0, 70, buffer) == buffer);
+    assert(memcmp(buffer, values, sizeof(int) * 70) == 0);
+    assert(NLAB_BITS_ROW(bits, 1)[1] >> 6 == 0);
+    assert(nlab_array_get(bits, 0, 0) == 0 && nlab_array_get(bits, 1, 69) == 1);
+    assert(nlabc_row(ints, 1, 64, 6, buffer) == NLAB_ROW(ints, 1) + 64);
+    assert(nlabc_fits(ints, 2, 70) && !nlabc_fits(ints, 70, 2));
+
+    // test #7 - a loop only writes over a target of its own kind and shape that no other value shares
+    assert(nlabc_target(ints, 2, 70, nlab_int) == ints);
+    assert(nlabc_target(ints, 2, 70, nlab_bool) == NULL);
+    assert(nlabc_target(ints, 2, 69, nlab_int) == NULL);
+    nlab_array* shared = nlab_array_copy(ints);
+    assert(nlabc_target(ints, 2, 70, nlab_int) == NULL);
+    nlab_array_free(shared);
+    assert(nlabc_target(ints, 2, 70, nlab_int) == ints);
+    nlab_array* inline_int = nlab_array_create_1d(4);
+    assert(nlabc_target(inline_int, 1, 1, nlab_int) == NULL);
+    assert(nlabc_target(NULL, 2, 70, nlab_int) == NULL);
+    nlab_array_free(inline_int);
+    nlab_array_free(bits);
+    nlab_array_free(ints);
+
+    // test #8 - a LOOP's counter counts up to its last pass, then stops
+    Program* p8 = program_builder_init();
+    short i8 = map_get_keycode("$I");
+    nlabc_start_counter(p8, i8);
+    assert(nlab_array_get(map_get_key_value(p8->variable_map, "$I"), 0, 0) == 1);
+    assert(nlabc_count(*map_slot_by_code(p8->variable_map, i8), 2));
+    assert(nlab_array_get(map_get_key_value(p8->variable_map, "$I"), 0, 0) == 2);
+    assert(!nlabc_count(*map_slot_by_code(p8->variable_map, i8), 2));
+    assert(!nlabc_count(NULL, 2));
+    program_builder_free(p8);
+
+    // test #9 - a SET of arrays is compiled to a function: its kernel called directly, and an
+    // elementwise chain as one loop, with a scalar on the left of an array taken as the right operand
+    char* life[] = {"BEGIN", "{", "ONES", "3", "3", "$A", "SET", "$B", ":=", "$A", "U-EIGHTCOUNT", ";",
+                    "SET", "$C", ":=", "3", "$B", "B-GREATER", "$A", "B-AND", ";", "SET", "$D", ":=", "$C", ";",
+                    "PRINT", "$C", "PRINT", "$D", "}"};
+    Program* p9 = program_builder_init();
+    p9->compile_only = true;
+    for(unsigned int i = 0; i < sizeof(life) / sizeof(life[0]); i++){
+        program_builder_add(p9, life[i]);
+    }
+    assert(program(p9));
+    nlabc_expression* expr = _nlabc_new_expression();
+    int set_end = -1, sets = 0;
+    for(int i = 0; i < p9->bytecode->size; i++){
+        if(bytecode_at(p9->bytecode, i)->op == op_set_end){
+            sets++;
+            if(sets == 2){
+                set_end = i;
+            }
+        }
+    }
+    assert(set_end != -1);
+    assert(_nlabc_build_expression(p9, _interp_set_start(p9, set_end), set_end, expr));
+    assert(expr->nodes[expr->num_nodes - 1].kind == nlabc_loop);
+    char element[NLABC_MAX_EXPRESSION] = "";
+    assert(_nlabc_element(expr, expr->num_nodes - 1, element));
+    assert(strstr(element, "((r1[x]) > (s0))") != NULL);
+    free(expr);
+
+    fp = tmpfile();
+    bool has_kernel = false, has_loop_set = false, has_target = false, has_call = false;
+    nlabc_emit(p9, true, "life.nlb", fp);
+    rewind(fp);
+    while(fgets(line, MAX_STRING_LENGTH, fp) != NULL){
+        has_kernel = has_kernel || strstr(line, "= _apply_eightcount(operands, 1)) == NULL") != NULL;
+        has_loop_set = has_loop_set || strstr(line, "B-GREATER B-AND, in one loop") != NULL;
+        has_target = has_target || strstr(line, "target = nlabc_target(*nlabc_C, rows, cols, nlab_bool)") != NULL;
+        has_call = has_call || strstr(line, "&& nlabc_set_") != NULL;
+        // a SET without an operator is left to the interpreter
+        assert(strstr(line, "SET $D") == NULL);
+    }
+    fclose(fp);
+    assert(has_kernel && has_loop_set && has_target && has_call);
+    program_builder_free(p9);
+    #endif
+}
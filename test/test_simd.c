@@ -0,0 +1,70 @@
+#include "../src/nlab.h"
+
+void test_simd(void){
+
+    int a[200], b[200], out[200], expected[200];
+    uint64_t bits[4], expected_bits[4];
+    simd_level level = simd_get_level();
+    simd_op ops[] = {simd_and, simd_or, simd_greater, simd_less, simd_equals};
+
+    // mix of negatives, zeros and equal pairs
+    for(int i = 0; i < 200; i++){
+        a[i] = (i * 7) % 11 - 5;
+        b[i] = (i * 3) % 7 - 3;
+    }
+
+    // assert every level matches the portable kernels, whatever the length
+    // (so both whole vectors and the tail are covered)
+    for(int l = simd_scalar; l <= (int) level; l++){
+        for(size_t n = 0; n < 200; n += 13){
+            for(simd_op op = simd_add; op <= simd_times; op++){
+                _simd_arith_scalar(op, expected, a, b, 0, n);
+                _simd_arith_level(l, op, out, a, b, 0, n);
+                assert(memcmp(out, expected, sizeof(int) * n) == 0);
+
+                _simd_arith_scalar(op, expected, a, NULL, -3, n);
+                _simd_arith_level(l, op, out, a, NULL, -3, n);
+                assert(memcmp(out, expected, sizeof(int) * n) == 0);
+            }
+
+            _simd_compare_scalar(simd_greater, bits, a, b, 0, n);
+            memset(out, 0xff, sizeof(out));
+            _simd_unpack_level(l, out, bits, n);
+            _simd_unpack_scalar(expected, bits, n);
+            assert(memcmp(out, expected, sizeof(int) * n) == 0);
+
+            for(int o = 0; o < 5; o++){
+                memset(bits, 0xff, sizeof(bits));
+                _simd_compare_level(l, ops[o], bits, a, b, 0, n);
+                _simd_compare_scalar(ops[o], expected_bits, a, b, 0, n);
+                for(size_t w = 0; w < (n + 63) / 64; w++){
+                    assert(bits[w] == expected_bits[w]);
+                }
+
+                for(int value = -1; value <= 1; value++){
+                    _simd_compare_level(l, ops[o], bits, a, NULL, value, n);
+                    _simd_compare_scalar(ops[o], expected_bits, a, NULL, value, n);
+                    for(size_t w = 0; w < (n + 63) / 64; w++){
+                        assert(bits[w] == expected_bits[w]);
+                    }
+                }
+            }
+        }
+    }
+
+    // assert the portable kernels themselves, and that unused bits are cleared
+    _simd_arith_scalar(simd_times, out, a, b, 0, 3);
+    assert(out[0] == a[0] * b[0] && out[2] == a[2] * b[2]);
+    memset(bits, 0xff, sizeof(bits));
+    simd_compare(simd_less, bits, a, b, 0, 3);
+    assert(bits[0] == (uint64_t) ((a[0] < b[0]) | (a[1] < b[1]) << 1 | (a[2] < b[2]) << 2));
+    simd_not(bits, a, 70);
+    for(int i = 0; i < 70; i++){
+        assert((int) ((bits[i / 64] >> (i % 64)) & 1u) == (a[i] == 0));
+    }
+    assert((bits[1] >> 6) == 0);
+    simd_unpack(out, bits, 70);
+    for(int i = 0; i < 70; i++){
+        assert(out[i] == (a[i] == 0));
+    }
+}
@@ -7,9 +7,9 @@ void test_stack(void){
     // assert pushing valid int arrays onto stack
     nlab_array* two = nlab_array_create_1d(2);
     assert(stack_push(s, two));
-    assert(s->a[s->size-1].array[0][0] == 2);
+    assert(nlab_array_get(&s->a[s->size-1], 0, 0) == 2);
     nlab_array* peek2 = stack_peek(s);
-    assert(peek2->array[0][0] == 2);
+    assert(nlab_array_get(peek2, 0, 0) == 2);
     assert(s->size == 1);
 
     // assert cannot push NULL stack frame
@@ -18,26 +18,26 @@ void test_stack(void){
     // assert pushing stack frame 3 on top of 2 and then pop
     nlab_array* three = nlab_array_create_1d(3);
     assert(stack_push(s, three));
-    assert(s->a[s->size-1].array[0][0] == 3);
+    assert(nlab_array_get(&s->a[s->size-1], 0, 0) == 3);
     assert(s->size == 2);
     assert(s->capacity == 16);
-    assert(stack_peek(s)->array[0][0] == 3);
+    assert(nlab_array_get(stack_peek(s), 0, 0) == 3);
 
     nlab_array* pop3 = NULL;
     pop3 = stack_pop(s);
     assert(pop3 != NULL);
-    assert(pop3->array[0][0] == 3);
+    assert(nlab_array_get(pop3, 0, 0) == 3);
 
 
     // assert top frame is 2 as expected after popping 3
     nlab_array* peek2_2 = NULL;
     peek2_2 = stack_peek(s);
-    assert(peek2_2->array[0][0] == 2);
+    assert(nlab_array_get(peek2_2, 0, 0) == 2);
 
     // assert false returned when popping empty stack
     nlab_array* pop2 = NULL;
     pop2 = stack_pop(s);
-    assert(pop2->array[0][0] == 2);
+    assert(nlab_array_get(pop2, 0, 0) == 2);
     nlab_array* pop_null = stack_pop(s);
     assert(pop_null == NULL);
 
@@ -48,9 +48,29 @@ void test_stack(void){
     assert(stack_push(s, five));
 
 
+    // scalars are held inline, so the slot has its own copy
+    assert(stack_peek(s)->data != five->data);
+    assert(stack_peek(s)->data == &stack_peek(s)->scalar);
+    assert(nlab_array_get(stack_peek(s), 0, 0) == 5);
+
+    // ... and stay readable when the stack grows under them
+    for(unsigned int i = 0; i < 3 * FIXEDSIZE; i++){
+        assert(stack_push(s, five));
+    }
+    assert(nlab_array_get(&s->a[0], 0, 0) == 4);
+    assert(s->a[0].data == &s->a[0].scalar);
+
+    // assert pushing shares a larger buffer rather than copying it
+    nlab_array* ones = nlab_array_create_ones(2, 2);
+    assert(stack_push(s, ones));
+    assert(stack_peek(s)->data == ones->data);
+    assert(ones->block->refcount == 2);
+    assert(stack_free(s));
+    assert(ones->block->refcount == 1);
+
+    nlab_array_free(ones);
     nlab_array_free(two);
     nlab_array_free(three);
     nlab_array_free(four);
     nlab_array_free(five);
-    assert(stack_free(s));
 }